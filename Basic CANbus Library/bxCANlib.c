@@ -17,8 +17,12 @@
   [..]
     This section provides functions allowing to:
     (+) Initialize TxHeader.
-    (+) Configuration CAN FIFO filter (now only for Fifo0).
+    (+) Configuration CAN FIFO filter.
+    (+) Disabling a filter bank.
     (+) Finding empty mailbox for sending message.
+    (+) Sending message from both interrupt and while loop.
+    (+) Handling every message loaded in a mailbox.
+    (+) Aborting pending message by StdId.
     (+) Copying TxHeader, RxHeader, arrayData[8].
   */
 	
@@ -63,6 +67,49 @@ void CAN_Fifo0_Filter_Config(CAN_HandleTypeDef *hcan, CAN_FilterTypeDef *canfilt
 	HAL_CAN_ConfigFilter(hcan, canfilter);
 }
 
+/**
+  * @brief 		Configuration Rx FIFO1 Filter.
+	* @param		hcan		  			Pointer to the CAN_HandleTypeDef structure.
+	* @param		canfilter				Pointer to the CAN_FilterTypeDef structure.
+	* @param		FilterBank			CAN FilerBank (F103 among 0-13).
+	* @param		Filter_Id				CAN Filer ID.
+	* @param		Filter_Id_Mask	CAN Filer ID Mask.
+  */
+void CAN_Fifo1_Filter_Config(CAN_HandleTypeDef *hcan, CAN_FilterTypeDef *canfilter, uint32_t FilterBank, 
+																uint32_t Filter_Id, uint32_t Filter_Id_Mask)
+{
+	canfilter->FilterActivation 		= CAN_FILTER_ENABLE;
+	canfilter->FilterBank 					= FilterBank;
+	canfilter->FilterFIFOAssignment = CAN_RX_FIFO1;
+	canfilter->FilterIdHigh 				= Filter_Id<<5;
+	canfilter->FilterIdLow					= 0x0000;
+	canfilter->FilterMaskIdHigh			= Filter_Id_Mask<<5;
+	canfilter->FilterMaskIdLow			=	0x0000;
+	canfilter->FilterMode						= CAN_FILTERMODE_IDMASK;
+	canfilter->FilterScale					=	CAN_FILTERSCALE_32BIT;
+	canfilter->SlaveStartFilterBank	= 0;
+	
+	HAL_CAN_ConfigFilter(hcan, canfilter);
+}
+
+/**
+  * @brief 		Disable a Rx FIFO0 Filter bank.
+	* @param		hcan		  			Pointer to the CAN_HandleTypeDef structure.
+	* @param		FilterBank			CAN FilerBank (F103 among 0-13).
+  */
+void CAN_Fifo0_Filter_Disable(CAN_HandleTypeDef *hcan, uint32_t FilterBank)
+{
+	CAN_FilterTypeDef canfilter = {0};
+	
+	canfilter.FilterActivation 			= CAN_FILTER_DISABLE;
+	canfilter.FilterBank 						= FilterBank;
+	canfilter.FilterFIFOAssignment 	= CAN_RX_FIFO0;
+	canfilter.FilterMode						= CAN_FILTERMODE_IDMASK;
+	canfilter.FilterScale						=	CAN_FILTERSCALE_32BIT;
+	
+	HAL_CAN_ConfigFilter(hcan, &canfilter);
+}
+
 /**
   * @brief 		Finding empty mailbox.
 	* @return		empty mailbox or no mailbox
@@ -78,6 +125,66 @@ uint32_t get_Empty_Mailbox(void)
 	return HAL_BUSY;
 }
 
+/**
+  * @brief 		Add a message to a free mailbox with interrupt locked.
+	* @note			HAL_CAN_AddTxMessage is not reentrant, use this function
+	*						when messages are sent from both interrupt and while loop.
+	* @param		hcan			Pointer to the CAN_HandleTypeDef structure.
+	* @param		TxHeader	Pointer to the CAN_TxHeaderTypeDef structure.
+	* @param		Data			Data array to send.
+	* @param		Mailbox		Pointer to store the used mailbox.
+	* @return		HAL status
+  */
+HAL_StatusTypeDef CAN_Transmit(CAN_HandleTypeDef *hcan, CAN_TxHeaderTypeDef *TxHeader, uint8_t *Data, uint32_t *Mailbox)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	HAL_StatusTypeDef status = HAL_CAN_AddTxMessage(hcan, TxHeader, Data, Mailbox);
+	if (status == HAL_OK)
+		CAN_Transmit_Handle(TxHeader, Data, *Mailbox);
+	__set_PRIMASK(primask);
+	return status;
+}
+
+/**
+  * @brief 		Transmit Handle function.
+	* @note 		Called by CAN_Transmit with interrupt locked for every message
+	*						loaded in a mailbox, place traffic statistic in this.
+	* @param		TxHeader	Pointer to the CAN_TxHeaderTypeDef structure.
+	* @param		Data			Data array loaded.
+	* @param		Mailbox		Mailbox loaded (CAN_TX_MAILBOXx).
+  */
+__weak void CAN_Transmit_Handle(CAN_TxHeaderTypeDef *TxHeader, uint8_t *Data, uint32_t Mailbox)
+{
+	
+}
+
+/**
+  * @brief 		Abort pending messages with a StdId.
+	* @note			A message which is being transmitted still finishes on the bus.
+	* @param		hcan			Pointer to the CAN_HandleTypeDef structure.
+	* @param		StdId			Standard ID of messages to abort.
+	* @return		Number of aborted mailboxes
+  */
+uint8_t CAN_Abort_Pending_StdId(CAN_HandleTypeDef *hcan, uint32_t StdId)
+{
+	uint8_t count = 0;
+	for (uint8_t i = 0; i < 3; i++)
+	{
+		uint32_t TxMailbox = CAN_TX_MAILBOX0 << i;
+		uint32_t TIR = hcan->Instance->sTxMailBox[i].TIR;
+		
+		if (!HAL_CAN_IsTxMessagePending(hcan, TxMailbox) || (TIR & CAN_TI0R_IDE))
+			continue;
+		if (((TIR & CAN_TI0R_STID) >> CAN_TI0R_STID_Pos) != StdId)
+			continue;
+		
+		HAL_CAN_AbortTxRequest(hcan, TxMailbox);
+		count++;
+	}
+	return count;
+}
+
 /**
   * @brief 		Copy TxHeader from a TxHeader.
 	* @param		TxHeader					A pointer to store the copy data.
@@ -125,6 +232,203 @@ void CAN_Data_Copy(uint8_t *Data, uint8_t *Data_Sample)
 	Data[7] = Data_Sample[7];
 }
 
+/** @brief    Basic CANbus function for bit timing
+  ==============================================================================
+										##### CANbus Bit Timing Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Computing prescaler, BS1, BS2 and SJW for a bit rate and sample point.
+    (+) Changing bit rate at runtime.
+    (+) Reading the current bit rate.
+    (+) Detecting bus bit rate in silent mode.
+	[..]
+		A bit is 1 + BS1 + BS2 time quanta (8 to 25 for bxCAN), the sample point
+		is (1 + BS1) / (1 + BS1 + BS2). At 36 MHz APB1 and 87.5 % target the
+		calculator gives 18 TQ / 88.9 % from 125 kbit/s to 1 Mbit/s.
+  */
+
+/**
+  * @brief 		Compute bit timing.
+	* @param		pclk					CAN peripheral clock (APB1) in Hz.
+	* @param		bitrate				Bit rate in bit/s.
+	* @param		sample_point	Target sample point in per mille (875 is CiA recommendation).
+	* @param		timing				Pointer to store the bit timing.
+	* @note			Exact bit rate only. The most time quanta (finer resynchronisation)
+	*						within CAN_SAMPLE_TOLERANCE wins, else the closest sample point.
+	* @return		HAL_OK, HAL_ERROR if bit rate can not be reached exactly
+  */
+HAL_StatusTypeDef CAN_BitTiming_Calc(uint32_t pclk, uint32_t bitrate, uint16_t sample_point, CAN_BitTiming_TypeDef *timing)
+{
+	uint32_t best_error = 0xFFFFFFFF;
+	
+	if (bitrate == 0 || sample_point == 0 || sample_point >= 1000)
+		return HAL_ERROR;
+	
+	for (uint32_t tq = 25; tq >= 8; tq--)
+	{
+		if (pclk % (bitrate * tq))
+			continue;
+		uint32_t prescaler = pclk / (bitrate * tq);
+		if (prescaler == 0 || prescaler > 1024)
+			continue;
+		
+		//Sample point at the end of BS1, BS2 from 1 to 8 TQ
+		uint32_t bs1 = (sample_point * tq + 500) / 1000 - 1;
+		if (bs1 > 16)
+			bs1 = 16;
+		uint32_t bs2 = tq - 1 - bs1;
+		if (bs2 < 1)
+		{
+			bs2 = 1;
+			bs1 = tq - 2;
+		}
+		if (bs2 > 8 || bs1 < 1 || bs1 > 16)
+			continue;
+		
+		uint32_t achieved = (1 + bs1) * 1000 / tq;
+		uint32_t error = (achieved > sample_point) ? achieved - sample_point : sample_point - achieved;
+		if (error >= best_error)
+			continue;
+		
+		best_error = error;
+		timing->Prescaler 		= prescaler;
+		timing->TimeSeg1 			= (bs1 - 1) << CAN_BTR_TS1_Pos;
+		timing->TimeSeg2 			= (bs2 - 1) << CAN_BTR_TS2_Pos;
+		timing->SyncJumpWidth	= ((bs2 < 4 ? bs2 : 4) - 1) << CAN_BTR_SJW_Pos;
+		timing->sample_point	= achieved;
+		
+		//Time quanta are tried from the most
+		if (error <= CAN_SAMPLE_TOLERANCE)
+			break;
+	}
+	
+	return (best_error == 0xFFFFFFFF) ? HAL_ERROR : HAL_OK;
+}
+
+/**
+  * @brief 		Change bit rate.
+	* @param		hcan					Pointer to the CAN_HandleTypeDef structure.
+	* @param		bitrate				Bit rate in bit/s.
+	* @param		sample_point	Target sample point in per mille.
+	* @note			CAN is stopped and restarted, filters and notifications are kept,
+	*						pending mailboxes are sent with the new bit rate.
+	* @return		HAL status, bit rate is not changed on error
+  */
+HAL_StatusTypeDef CAN_Set_Bitrate(CAN_HandleTypeDef *hcan, uint32_t bitrate, uint16_t sample_point)
+{
+	CAN_BitTiming_TypeDef timing;
+	if (CAN_BitTiming_Calc(HAL_RCC_GetPCLK1Freq(), bitrate, sample_point, &timing) != HAL_OK)
+		return HAL_ERROR;
+	
+	uint8_t started = (hcan->State == HAL_CAN_STATE_LISTENING);
+	if (started)
+		HAL_CAN_Stop(hcan);
+	
+	hcan->Init.Prescaler 			= timing.Prescaler;
+	hcan->Init.SyncJumpWidth 	= timing.SyncJumpWidth;
+	hcan->Init.TimeSeg1 			= timing.TimeSeg1;
+	hcan->Init.TimeSeg2 			= timing.TimeSeg2;
+	HAL_StatusTypeDef status 	= HAL_CAN_Init(hcan);
+	
+	if (started && status == HAL_OK)
+		status = HAL_CAN_Start(hcan);
+	return status;
+}
+
+/**
+  * @brief 		Get current bit rate.
+	* @param		hcan					Pointer to the CAN_HandleTypeDef structure.
+	* @return		Bit rate in bit/s
+  */
+uint32_t CAN_Get_Bitrate(CAN_HandleTypeDef *hcan)
+{
+	uint32_t tq = 1 + ((hcan->Init.TimeSeg1 >> CAN_BTR_TS1_Pos) + 1) + ((hcan->Init.TimeSeg2 >> CAN_BTR_TS2_Pos) + 1);
+	return HAL_RCC_GetPCLK1Freq() / (hcan->Init.Prescaler * tq);
+}
+
+/**
+  * @brief 		Listen to the bus with the current bit timing.
+	* @param		hcan					Pointer to the CAN_HandleTypeDef structure, started in silent mode.
+	* @param		dwell_ms			Listening time.
+	* @return		CAN_DETECT_FRAMES frames received without error (1) or not (0)
+  */
+static uint8_t CAN_Bitrate_Listen(CAN_HandleTypeDef *hcan, uint32_t dwell_ms)
+{
+	CAN_RxHeaderTypeDef RxHeader;
+	uint8_t 						data[8];
+	uint8_t 						frames = 0;
+	uint32_t 						start = HAL_GetTick();
+	uint32_t 						rec = hcan->Instance->ESR & CAN_ESR_REC;
+	
+	//LEC = 7 is never set by hardware, any update means a frame or an error
+	hcan->Instance->ESR = CAN_ESR_LEC;
+	
+	while ((HAL_GetTick() - start) < dwell_ms)
+	{
+		uint32_t esr = hcan->Instance->ESR;
+		uint32_t lec = esr & CAN_ESR_LEC;
+		
+		//Wrong bit rate gives stuff, form or CRC error
+		if ((lec != CAN_ESR_LEC && lec != 0) || (esr & CAN_ESR_REC) > rec)
+			return 0;
+		
+		while (HAL_CAN_GetRxFifoFillLevel(hcan, CAN_RX_FIFO0))
+		{
+			HAL_CAN_GetRxMessage(hcan, CAN_RX_FIFO0, &RxHeader, data);
+			frames++;
+		}
+		if (frames >= CAN_DETECT_FRAMES)
+			return 1;
+	}
+	return 0;
+}
+
+/**
+  * @brief 		Detect bus bit rate.
+	* @param		hcan					Pointer to the CAN_HandleTypeDef structure, not started.
+	* @param		bitrate				Candidate bit rate array in bit/s, most likely first.
+	* @param		num						Number of candidates.
+	* @param		sample_point	Sample point in per mille.
+	* @param		dwell_ms			Listening time for each candidate.
+	* @param		timeout_ms		Detection time bound, candidates are cycled until then.
+	* @note			Call before activating Rx notification. Every frame is accepted
+	*						during detection with CAN_DETECT_FILTER_BANK, then this bank
+	*						is disabled again. Silent mode never sends ACK or error frame,
+	*						so a wrong candidate does not disturb the bus. CAN is left stopped
+	*						in hcan->Init.Mode with the detected timing, frames received
+	*						meanwhile are dropped.
+	* @return		Detected bit rate, 0 if nothing is received before timeout
+  */
+uint32_t CAN_Bitrate_Detect(CAN_HandleTypeDef *hcan, const uint32_t *bitrate, uint8_t num, uint16_t sample_point,
+														uint32_t dwell_ms, uint32_t timeout_ms)
+{
+	CAN_FilterTypeDef canfilter;
+	uint32_t mode 	= hcan->Init.Mode;
+	uint32_t start 	= HAL_GetTick();
+	uint32_t found 	= 0;
+	
+	if (num == 0)
+		return 0;
+	
+	CAN_Fifo0_Filter_Config(hcan, &canfilter, CAN_DETECT_FILTER_BANK, 0, 0);
+	hcan->Init.Mode = CAN_MODE_SILENT;
+	for (uint8_t i = 0; !found && (HAL_GetTick() - start) < timeout_ms; i = (i + 1) % num)
+	{
+		if (CAN_Set_Bitrate(hcan, bitrate[i], sample_point) != HAL_OK || HAL_CAN_Start(hcan) != HAL_OK)
+			continue;
+		if (CAN_Bitrate_Listen(hcan, dwell_ms))
+			found = bitrate[i];
+		HAL_CAN_Stop(hcan);
+	}
+	
+	//Back to the application mode, timing of the last candidate is kept
+	CAN_Fifo0_Filter_Disable(hcan, CAN_DETECT_FILTER_BANK);
+	hcan->Init.Mode = mode;
+	HAL_CAN_Init(hcan);
+	return found;
+}
+
 /** @brief    Basic CANbus function for creating queue
   ==============================================================================
 										##### CANbus Queue Functions #####
@@ -334,7 +638,12 @@ int CAN_DeRxQueue(CAN_RxQueue *queue)
   if (CAN_RxQueue_isEmpty(queue))
       return -1;
 	queue->front = (queue->front + 1)%queue->capacity;
+	
+	//Rx interrupt enqueues at the same time
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
 	queue->used--;
+	__set_PRIMASK(primask);
 	return 0;
 }
 
@@ -25,13 +25,35 @@ typedef struct
 
 /**
   * @brief  RxMessage struct
+	* @param	cycle		Receive time in core clock cycle, set by the receiver if it needs it
   */
 typedef struct
 {
 	CAN_RxHeaderTypeDef RxHeader;
 	uint8_t 						rxdata[8];
+	uint32_t						cycle;
 }CAN_RxMessage;
 
+/**
+  * @brief  Bit timing configuration value
+  */
+#define CAN_SAMPLE_TOLERANCE	20		//Accepted sample point error in per mille
+#define CAN_DETECT_FRAMES			2			//Error free frames to lock a bit rate
+#define CAN_DETECT_FILTER_BANK	13		//Accept all filter used during detection
+
+/**
+  * @brief  Bit timing struct, value in HAL format (CAN_SJW_xTQ, CAN_BS1_xTQ, CAN_BS2_xTQ)
+	* @param	sample_point	Achieved sample point in per mille
+  */
+typedef struct
+{
+	uint32_t	Prescaler;
+	uint32_t	SyncJumpWidth;
+	uint32_t	TimeSeg1;
+	uint32_t	TimeSeg2;
+	uint16_t	sample_point;
+}CAN_BitTiming_TypeDef;
+
 /**
   * @brief  TxQueue struct
   */
@@ -61,8 +83,22 @@ typedef struct
 /* Initialization and basic support functions  ********************************/
 void CAN_TxHeader_Init(CAN_TxHeaderTypeDef *TxHeader, uint32_t StdId, uint32_t DLC);
 uint32_t get_Empty_Mailbox(void);
+HAL_StatusTypeDef CAN_Transmit(CAN_HandleTypeDef *hcan, CAN_TxHeaderTypeDef *TxHeader, uint8_t *Data, uint32_t *Mailbox);
+void CAN_Transmit_Handle(CAN_TxHeaderTypeDef *TxHeader, uint8_t *Data, uint32_t Mailbox);
+uint8_t CAN_Abort_Pending_StdId(CAN_HandleTypeDef *hcan, uint32_t StdId);
 void CAN_Fifo0_Filter_Config(CAN_HandleTypeDef *hcan, CAN_FilterTypeDef *canfilter, uint32_t FilterBank, 
 																uint32_t Filter_Id, uint32_t Filter_Id_Mask);
+void CAN_Fifo1_Filter_Config(CAN_HandleTypeDef *hcan, CAN_FilterTypeDef *canfilter, uint32_t FilterBank, 
+																uint32_t Filter_Id, uint32_t Filter_Id_Mask);
+void CAN_Fifo0_Filter_Disable(CAN_HandleTypeDef *hcan, uint32_t FilterBank);
+
+
+/* Bit timing functions  ******************************************************/
+HAL_StatusTypeDef CAN_BitTiming_Calc(uint32_t pclk, uint32_t bitrate, uint16_t sample_point, CAN_BitTiming_TypeDef *timing);
+HAL_StatusTypeDef CAN_Set_Bitrate(CAN_HandleTypeDef *hcan, uint32_t bitrate, uint16_t sample_point);
+uint32_t CAN_Get_Bitrate(CAN_HandleTypeDef *hcan);
+uint32_t CAN_Bitrate_Detect(CAN_HandleTypeDef *hcan, const uint32_t *bitrate, uint8_t num, uint16_t sample_point,
+														uint32_t dwell_ms, uint32_t timeout_ms);
 
 
 /* Copy data functions  *******************************************************/
@@ -24,11 +24,37 @@
 #include "CANSlavelib.h"
 #include "IMU.h"
 #include "EncoderPosition.h"
+#include "Timebase.h"
+#include "StreamScheduler.h"
+#include "FlashConfig.h"
+#include "LoopProfiler.h"
+#include "IrqProfiler.h"
+#include "TaskScheduler.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
 /* USER CODE BEGIN PTD */
-
+/**
+  * @brief  Task ID, read with DIAG_PAGE_PROFILE and DIAG_PAGE_TASK
+  */
+typedef enum
+{
+	LOOP_TASK_LED,
+	LOOP_TASK_CMD,
+	LOOP_TASK_ENC_X,
+	LOOP_TASK_ENC_Y,
+	LOOP_TASK_IMU_ZERO,
+	LOOP_TASK_IMU_PROCESS,
+	LOOP_TASK_ENC_TX,
+	LOOP_TASK_IMU_TX,
+	LOOP_TASK_REFB,
+	LOOP_TASK_BUS,
+	LOOP_TASK_BITRATE,
+	LOOP_TASK_NODE,
+	LOOP_TASK_TRANSFER,
+	LOOP_TASK_IRQ,
+	LOOP_TASK_NUM
+}Loop_Task_TypeDef;
 /* USER CODE END PTD */
 
 /* Private define ------------------------------------------------------------*/
@@ -46,6 +72,7 @@ CAN_HandleTypeDef hcan;
 
 TIM_HandleTypeDef htim2;
 TIM_HandleTypeDef htim3;
+TIM_HandleTypeDef htim4;
 
 UART_HandleTypeDef huart1;
 
@@ -60,6 +87,7 @@ static void MX_GPIO_Init(void);
 static void MX_CAN_Init(void);
 static void MX_TIM2_Init(void);
 static void MX_TIM3_Init(void);
+static void MX_TIM4_Init(void);
 static void MX_USART1_UART_Init(void);
 /* USER CODE BEGIN PFP */
 
@@ -74,7 +102,7 @@ uint8_t 					IMU_Raw_Data[6];
 uint8_t						IMU_Data_in;
 Angle_ReadTypeDef angle;
 
-CAN_FilterTypeDef canfilter;
+Flash_Config_TypeDef config;
 Sensor_HandleTypedef IMU;
 Sensor_HandleTypedef Encoder;
 
@@ -82,20 +110,96 @@ void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
 {
 	Encoder_Zpulse_Dectect(&encoderx, GPIO_Pin);
 	Encoder_Zpulse_Dectect(&encodery, GPIO_Pin);
+	if (GPIO_Pin == ZX_PIN)
+		Task_Signal(LOOP_TASK_ENC_X);
+	if (GPIO_Pin == ZY_PIN)
+		Task_Signal(LOOP_TASK_ENC_Y);
 }
 
 void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
 {
 	if (huart->Instance == huart1.Instance)
 	{	
-		IMU_Data_In(IMU_Data_in);
+		if (IMU_Data_In(IMU_Data_in))
+			Task_Signal(LOOP_TASK_IMU_PROCESS);
 		HAL_UART_Receive_IT(&huart1, &IMU_Data_in, 1);
 	}
 }
 
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+	Timebase_Overflow_Handle(htim);
+}
+
+void HAL_TIM_OC_DelayElapsedCallback(TIM_HandleTypeDef *htim)
+{
+	Stream_Alarm_Handle(htim);
+	if (htim->Instance == htim4.Instance)
+	{
+		//Position is refreshed before the stream frame, shorter deadline runs first
+		Task_Signal(LOOP_TASK_ENC_X);
+		Task_Signal(LOOP_TASK_ENC_Y);
+		Task_Signal(LOOP_TASK_ENC_TX);
+		Task_Signal(LOOP_TASK_IMU_TX);
+	}
+}
+
 void HAL_CAN_RxFifo0MsgPendingCallback(CAN_HandleTypeDef *hcan)
 {
 	CAN_Slave_FIFO0_RxMessage(hcan);
+	Task_Signal(LOOP_TASK_CMD);
+}
+
+void HAL_CAN_RxFifo1MsgPendingCallback(CAN_HandleTypeDef *hcan)
+{
+	CAN_Bus_Stat_FIFO1_Handle(hcan);
+}
+
+void CAN_Transmit_Handle(CAN_TxHeaderTypeDef *TxHeader, uint8_t *Data, uint32_t Mailbox)
+{
+	CAN_Bus_Stat_Tx(TxHeader, Data);
+	CAN_Latency_Tx(TxHeader, Mailbox);
+}
+
+void HAL_CAN_TxMailbox0CompleteCallback(CAN_HandleTypeDef *hcan)
+{
+	CAN_Latency_Tx_Complete(CAN_TX_MAILBOX0);
+	Task_Signal(LOOP_TASK_REFB);
+	Task_Signal(LOOP_TASK_TRANSFER);
+}
+
+void HAL_CAN_TxMailbox1CompleteCallback(CAN_HandleTypeDef *hcan)
+{
+	CAN_Latency_Tx_Complete(CAN_TX_MAILBOX1);
+	Task_Signal(LOOP_TASK_REFB);
+	Task_Signal(LOOP_TASK_TRANSFER);
+}
+
+void HAL_CAN_TxMailbox2CompleteCallback(CAN_HandleTypeDef *hcan)
+{
+	CAN_Latency_Tx_Complete(CAN_TX_MAILBOX2);
+	Task_Signal(LOOP_TASK_REFB);
+	Task_Signal(LOOP_TASK_TRANSFER);
+}
+
+void HAL_CAN_TxMailbox0AbortCallback(CAN_HandleTypeDef *hcan)
+{
+	CAN_Latency_Tx_Abort(CAN_TX_MAILBOX0);
+}
+
+void HAL_CAN_TxMailbox1AbortCallback(CAN_HandleTypeDef *hcan)
+{
+	CAN_Latency_Tx_Abort(CAN_TX_MAILBOX1);
+}
+
+void HAL_CAN_TxMailbox2AbortCallback(CAN_HandleTypeDef *hcan)
+{
+	CAN_Latency_Tx_Abort(CAN_TX_MAILBOX2);
+}
+
+void HAL_CAN_ErrorCallback(CAN_HandleTypeDef *hcan)
+{
+	CAN_Slave_Error_Handle(hcan);
 }
 
 void CAN_Sensor_Start_Handle(void)
@@ -121,7 +225,102 @@ void CAN_Encoder_Assign_Handle(void)
 	CAN_Assign_Encoder(&hcan, Encoder, &encoderx, &encodery);
 }
 
-uint32_t time;
+void CAN_Sensor_Sync_Handle(void)
+{
+	CAN_Sync_Encoder_Transmit(&hcan, &Encoder, Encoder_Latch_Position(&encoderx), Encoder_Latch_Position(&encodery));
+	CAN_Sync_IMU_Transmit(&hcan, &IMU, IMU_Raw_Data);
+}
+
+void CAN_Bulk_Rx_Handle(void)
+{
+	Task_Signal(LOOP_TASK_TRANSFER);
+}
+
+void CAN_Sensor_Restore_Handle(void)
+{
+	CAN_Restore_Encoder(&encoderx, &encodery);
+}
+
+void CAN_Param_Apply_Handle(uint8_t index)
+{
+	Encoder_Config(&encoderx, CAN_Param_Get_U32(PARAM_ENC_RES), CAN_Param_Get_Float(PARAM_WHEEL_DIAM));
+	Encoder_Config(&encodery, CAN_Param_Get_U32(PARAM_ENC_RES), CAN_Param_Get_Float(PARAM_WHEEL_DIAM));
+	Stream_Set_Phase(&IMU.stream, CAN_Param_Get_U32(PARAM_IMU_PHASE));
+	Stream_Set_Phase(&Encoder.stream, CAN_Param_Get_U32(PARAM_ENC_PHASE));
+}
+
+static void Led_Task(void)
+{
+	HAL_GPIO_TogglePin(GPIOC, GPIO_PIN_13);
+}
+
+static void Cmd_Task(void)
+{
+	CAN_Slave_FIFO0_Recieve_Cmd_Handle(&hcan);
+}
+
+static void Encoder_X_Task(void)
+{
+	Encoder_Position_Handle(&encoderx);
+}
+
+static void Encoder_Y_Task(void)
+{
+	Encoder_Position_Handle(&encodery);
+}
+
+static void IMU_Zero_Task(void)
+{
+	IMU_Reset_Zero(&huart1);
+}
+
+static void IMU_Process_Task(void)
+{
+	IMU_Data_Process(&angle, IMU_Raw_Data);
+	
+	//Refresh the frame polled by RTR with the new sample
+	Task_Signal(LOOP_TASK_IMU_TX);
+}
+
+static void Encoder_Tx_Task(void)
+{
+	CAN_Encoder_Data_Transmit(&hcan, &Encoder, encoderx.position, encodery.position);
+}
+
+static void IMU_Tx_Task(void)
+{
+	CAN_IMU_Data_Transmit(&hcan, &IMU, IMU_Raw_Data);
+}
+
+static void ReFb_Task(void)
+{
+	CAN_Slave_FIFO0_ReFb_Handle(&hcan);
+}
+
+static void Bus_Task(void)
+{
+	CAN_Slave_Bus_Handle(&hcan);
+}
+
+static void Bitrate_Task(void)
+{
+	CAN_Slave_Bitrate_Handle(&hcan);
+}
+
+static void Node_Task(void)
+{
+	CAN_Slave_Node_Handle(&hcan);
+}
+
+static void Transfer_Task(void)
+{
+	CAN_Slave_Transfer_Handle();
+}
+
+static void Irq_Task(void)
+{
+	Irq_Profiler_Update();
+}
 
 /* USER CODE END 0 */
 
@@ -157,17 +356,52 @@ int main(void)
   MX_CAN_Init();
   MX_TIM2_Init();
   MX_TIM3_Init();
+  MX_TIM4_Init();
   MX_USART1_UART_Init();
   /* USER CODE BEGIN 2 */
-	Encoder_Init(&encoderx, &htim2, 1000, ZX_PIN);
-	Encoder_Init(&encodery, &htim3, 1000, ZY_PIN);
+	Encoder_Init(&encoderx, &htim2, ENCODER_RESOLUTION, ZX_PIN);
+	Encoder_Init(&encodery, &htim3, ENCODER_RESOLUTION, ZY_PIN);
+	Timebase_Init(&htim4);
+	Stream_Scheduler_Init(&htim4);
+	CAN_Bus_Monitor_Init(&hcan);
 	
+	Flash_Config_Load(&config);
+	CAN_Slave_Node_Init(&hcan, config.node_id);
+	CAN_Slave_Bitrate_Init(&hcan);
 	HAL_CAN_Start(&hcan);
-	HAL_CAN_ActivateNotification(&hcan, CAN_IT_RX_FIFO0_MSG_PENDING);
-	CAN_Fifo0_Filter_Config(&hcan, &canfilter, 10, 0, 0);
+	HAL_CAN_ActivateNotification(&hcan, CAN_IT_RX_FIFO0_MSG_PENDING | CAN_IT_BUSOFF | CAN_IT_ERROR);
+	CAN_Bus_Stat_Init(&hcan);
+	CAN_Latency_Init(&hcan);
+	Loop_Profiler_Init();
+	Irq_Profiler_Init();
+	CAN_Slave_Node_Claim(&hcan, &config);
+	
+	//A stream left out of the scheduler would never be released
+	if (CAN_Sensor_Init(&IMU, IMU_ID) != HAL_OK || CAN_Sensor_Init(&Encoder, ENC_ID) != HAL_OK ||
+			CAN_Sensor_Stream_Config(&Encoder, STREAM_PRIORITY_HIGH, 0) != HAL_OK ||
+			CAN_Sensor_Stream_Config(&IMU, STREAM_PRIORITY_NORMAL, 0) != HAL_OK)
+		Error_Handler();
+	
+	//Encoder scale and stream phase come from runtime parameters
+	CAN_Slave_Param_Init(&config);
+	CAN_Slave_Auto_Start(&config);
 	
-	CAN_Sensor_Init(&IMU, IMU_ID);
-	CAN_Sensor_Init(&Encoder, ENC_ID);
+	//Command and feedback first, periodic run also retries what an event left over
+	Task_Scheduler_Init();
+	Task_Create(LOOP_TASK_CMD, Cmd_Task, 1000, 1000, TASK_PRIORITY_HIGH);
+	Task_Create(LOOP_TASK_REFB, ReFb_Task, 1000, 1000, TASK_PRIORITY_HIGH);
+	Task_Create(LOOP_TASK_ENC_X, Encoder_X_Task, 1000, 250, TASK_PRIORITY_NORMAL);
+	Task_Create(LOOP_TASK_ENC_Y, Encoder_Y_Task, 1000, 250, TASK_PRIORITY_NORMAL);
+	Task_Create(LOOP_TASK_ENC_TX, Encoder_Tx_Task, 1000, 500, TASK_PRIORITY_NORMAL);
+	Task_Create(LOOP_TASK_IMU_TX, IMU_Tx_Task, 1000, 500, TASK_PRIORITY_NORMAL);
+	Task_Create(LOOP_TASK_IMU_PROCESS, IMU_Process_Task, 0, 500, TASK_PRIORITY_NORMAL);
+	Task_Create(LOOP_TASK_BUS, Bus_Task, 1000, 2000, TASK_PRIORITY_LOW);
+	Task_Create(LOOP_TASK_TRANSFER, Transfer_Task, 1000, 2000, TASK_PRIORITY_LOW);
+	Task_Create(LOOP_TASK_BITRATE, Bitrate_Task, 1000, 5000, TASK_PRIORITY_IDLE);
+	Task_Create(LOOP_TASK_NODE, Node_Task, 10000, 10000, TASK_PRIORITY_IDLE);
+	Task_Create(LOOP_TASK_IMU_ZERO, IMU_Zero_Task, 10000, TASK_NO_DEADLINE, TASK_PRIORITY_IDLE);
+	Task_Create(LOOP_TASK_LED, Led_Task, 200000, 50000, TASK_PRIORITY_IDLE);
+	Task_Create(LOOP_TASK_IRQ, Irq_Task, 100000, TASK_NO_DEADLINE, TASK_PRIORITY_IDLE);
 	//H AL_UART_Receive_IT(&huart1, &IMU_Data_in, 1);
 	//CAN_Sensor_ErrorFb(&hcan, Encoder);
 	//CAN_Sensor_ErrorFb(&hcan, IMU);
@@ -180,28 +414,9 @@ int main(void)
     /* USER CODE END WHILE */
 
     /* USER CODE BEGIN 3 */
-		
-		if ((HAL_GetTick() - time) > 200)
-		{
-			HAL_GPIO_TogglePin(GPIOC, GPIO_PIN_13);
-			time = HAL_GetTick();
-		}
-		
-		CAN_Slave_FIFO0_Recieve_Cmd_Handle(&hcan);
-			
-		
-		
-		
-		
-		Encoder_Position_Handle(&encoderx, 50.0);
-		Encoder_Position_Handle(&encodery, 50.0);
-		IMU_Reset_Zero(&huart1);
-		IMU_Data_Process(&angle, IMU_Raw_Data);
-		
-		CAN_Encoder_Data_Transmit(&hcan, &Encoder, encoderx.position, encodery.position);
-		CAN_IMU_Data_Transmit(&hcan, &IMU, IMU_Raw_Data);
-		
-		CAN_Slave_FIFO0_ReFb_Handle(&hcan);
+		//Loop period is the time between two passes running a task, idle passes are not marked
+		if (Task_Scheduler_Run())
+			Loop_Profiler_Mark();
   }
   /* USER CODE END 3 */
 }
@@ -261,13 +476,13 @@ static void MX_CAN_Init(void)
 
   /* USER CODE END CAN_Init 1 */
   hcan.Instance = CAN1;
-  hcan.Init.Prescaler = 18;
+  hcan.Init.Prescaler = 4;
   hcan.Init.Mode = CAN_MODE_NORMAL;
-  hcan.Init.SyncJumpWidth = CAN_SJW_1TQ;
-  hcan.Init.TimeSeg1 = CAN_BS1_2TQ;
-  hcan.Init.TimeSeg2 = CAN_BS2_1TQ;
+  hcan.Init.SyncJumpWidth = CAN_SJW_2TQ;
+  hcan.Init.TimeSeg1 = CAN_BS1_15TQ;
+  hcan.Init.TimeSeg2 = CAN_BS2_2TQ;
   hcan.Init.TimeTriggeredMode = DISABLE;
-  hcan.Init.AutoBusOff = DISABLE;
+  hcan.Init.AutoBusOff = ENABLE;
   hcan.Init.AutoWakeUp = DISABLE;
   hcan.Init.AutoRetransmission = ENABLE;
   hcan.Init.ReceiveFifoLocked = DISABLE;
@@ -380,6 +595,51 @@ static void MX_TIM3_Init(void)
 
 }
 
+/**
+  * @brief TIM4 Initialization Function
+  * @param None
+  * @retval None
+  */
+static void MX_TIM4_Init(void)
+{
+
+  /* USER CODE BEGIN TIM4_Init 0 */
+
+  /* USER CODE END TIM4_Init 0 */
+
+  TIM_ClockConfigTypeDef sClockSourceConfig = {0};
+  TIM_MasterConfigTypeDef sMasterConfig = {0};
+
+  /* USER CODE BEGIN TIM4_Init 1 */
+
+  /* USER CODE END TIM4_Init 1 */
+  htim4.Instance = TIM4;
+  htim4.Init.Prescaler = 71;
+  htim4.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim4.Init.Period = 65535;
+  htim4.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+  htim4.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+  if (HAL_TIM_Base_Init(&htim4) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  sClockSourceConfig.ClockSource = TIM_CLOCKSOURCE_INTERNAL;
+  if (HAL_TIM_ConfigClockSource(&htim4, &sClockSourceConfig) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  sMasterConfig.MasterOutputTrigger = TIM_TRGO_RESET;
+  sMasterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+  if (HAL_TIMEx_MasterConfigSynchronization(&htim4, &sMasterConfig) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  /* USER CODE BEGIN TIM4_Init 2 */
+
+  /* USER CODE END TIM4_Init 2 */
+
+}
+
 /**
   * @brief USART1 Initialization Function
   * @param None
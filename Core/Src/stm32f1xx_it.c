@@ -22,11 +22,25 @@
 #include "stm32f1xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "CANBusMonitor.h"
+#include "IrqProfiler.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
 /* USER CODE BEGIN TD */
-
+typedef enum
+{
+	IRQ_SYSTICK = 0,
+	IRQ_EXTI3,
+	IRQ_EXTI4,
+	IRQ_CAN_TX,
+	IRQ_CAN_RX0,
+	IRQ_CAN_RX1,
+	IRQ_CAN_SCE,
+	IRQ_TIM4,
+	IRQ_USART1,
+	IRQ_NUM,
+}Irq_Id_TypeDef;
 /* USER CODE END TD */
 
 /* Private define ------------------------------------------------------------*/
@@ -56,6 +70,7 @@
 
 /* External variables --------------------------------------------------------*/
 extern CAN_HandleTypeDef hcan;
+extern TIM_HandleTypeDef htim4;
 extern UART_HandleTypeDef huart1;
 /* USER CODE BEGIN EV */
 
@@ -184,11 +199,12 @@ void PendSV_Handler(void)
 void SysTick_Handler(void)
 {
   /* USER CODE BEGIN SysTick_IRQn 0 */
+	IRQ_PROFILE_ENTER(IRQ_SYSTICK);
 
   /* USER CODE END SysTick_IRQn 0 */
   HAL_IncTick();
   /* USER CODE BEGIN SysTick_IRQn 1 */
-
+	IRQ_PROFILE_EXIT(IRQ_SYSTICK);
   /* USER CODE END SysTick_IRQn 1 */
 }
 
@@ -205,11 +221,12 @@ void SysTick_Handler(void)
 void EXTI3_IRQHandler(void)
 {
   /* USER CODE BEGIN EXTI3_IRQn 0 */
+	IRQ_PROFILE_ENTER(IRQ_EXTI3);
 
   /* USER CODE END EXTI3_IRQn 0 */
   HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_3);
   /* USER CODE BEGIN EXTI3_IRQn 1 */
-
+	IRQ_PROFILE_EXIT(IRQ_EXTI3);
   /* USER CODE END EXTI3_IRQn 1 */
 }
 
@@ -219,25 +236,43 @@ void EXTI3_IRQHandler(void)
 void EXTI4_IRQHandler(void)
 {
   /* USER CODE BEGIN EXTI4_IRQn 0 */
+	IRQ_PROFILE_ENTER(IRQ_EXTI4);
 
   /* USER CODE END EXTI4_IRQn 0 */
   HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_4);
   /* USER CODE BEGIN EXTI4_IRQn 1 */
-
+	IRQ_PROFILE_EXIT(IRQ_EXTI4);
   /* USER CODE END EXTI4_IRQn 1 */
 }
 
+/**
+  * @brief This function handles USB high priority or CAN TX interrupts.
+  */
+void USB_HP_CAN1_TX_IRQHandler(void)
+{
+  /* USER CODE BEGIN USB_HP_CAN1_TX_IRQn 0 */
+	IRQ_PROFILE_ENTER(IRQ_CAN_TX);
+	CAN_Bus_Arbitration_Tx_Handle();
+
+  /* USER CODE END USB_HP_CAN1_TX_IRQn 0 */
+  HAL_CAN_IRQHandler(&hcan);
+  /* USER CODE BEGIN USB_HP_CAN1_TX_IRQn 1 */
+	IRQ_PROFILE_EXIT(IRQ_CAN_TX);
+  /* USER CODE END USB_HP_CAN1_TX_IRQn 1 */
+}
+
 /**
   * @brief This function handles USB low priority or CAN RX0 interrupts.
   */
 void USB_LP_CAN1_RX0_IRQHandler(void)
 {
   /* USER CODE BEGIN USB_LP_CAN1_RX0_IRQn 0 */
+	IRQ_PROFILE_ENTER(IRQ_CAN_RX0);
 
   /* USER CODE END USB_LP_CAN1_RX0_IRQn 0 */
   HAL_CAN_IRQHandler(&hcan);
   /* USER CODE BEGIN USB_LP_CAN1_RX0_IRQn 1 */
-
+	IRQ_PROFILE_EXIT(IRQ_CAN_RX0);
   /* USER CODE END USB_LP_CAN1_RX0_IRQn 1 */
 }
 
@@ -247,25 +282,57 @@ void USB_LP_CAN1_RX0_IRQHandler(void)
 void CAN1_RX1_IRQHandler(void)
 {
   /* USER CODE BEGIN CAN1_RX1_IRQn 0 */
+	IRQ_PROFILE_ENTER(IRQ_CAN_RX1);
 
   /* USER CODE END CAN1_RX1_IRQn 0 */
   HAL_CAN_IRQHandler(&hcan);
   /* USER CODE BEGIN CAN1_RX1_IRQn 1 */
-
+	IRQ_PROFILE_EXIT(IRQ_CAN_RX1);
   /* USER CODE END CAN1_RX1_IRQn 1 */
 }
 
+/**
+  * @brief This function handles CAN SCE interrupt.
+  */
+void CAN1_SCE_IRQHandler(void)
+{
+  /* USER CODE BEGIN CAN1_SCE_IRQn 0 */
+	IRQ_PROFILE_ENTER(IRQ_CAN_SCE);
+
+  /* USER CODE END CAN1_SCE_IRQn 0 */
+  HAL_CAN_IRQHandler(&hcan);
+  /* USER CODE BEGIN CAN1_SCE_IRQn 1 */
+	IRQ_PROFILE_EXIT(IRQ_CAN_SCE);
+  /* USER CODE END CAN1_SCE_IRQn 1 */
+}
+
+/**
+  * @brief This function handles TIM4 global interrupt.
+  */
+void TIM4_IRQHandler(void)
+{
+  /* USER CODE BEGIN TIM4_IRQn 0 */
+	IRQ_PROFILE_ENTER(IRQ_TIM4);
+
+  /* USER CODE END TIM4_IRQn 0 */
+  HAL_TIM_IRQHandler(&htim4);
+  /* USER CODE BEGIN TIM4_IRQn 1 */
+	IRQ_PROFILE_EXIT(IRQ_TIM4);
+  /* USER CODE END TIM4_IRQn 1 */
+}
+
 /**
   * @brief This function handles USART1 global interrupt.
   */
 void USART1_IRQHandler(void)
 {
   /* USER CODE BEGIN USART1_IRQn 0 */
+	IRQ_PROFILE_ENTER(IRQ_USART1);
 
   /* USER CODE END USART1_IRQn 0 */
   HAL_UART_IRQHandler(&huart1);
   /* USER CODE BEGIN USART1_IRQn 1 */
-
+	IRQ_PROFILE_EXIT(IRQ_USART1);
   /* USER CODE END USART1_IRQn 1 */
 }
 
@@ -0,0 +1,343 @@
+/**
+  ******************************************************************************
+  * @file    	CANBusMonitor.c
+  * @author  	Nguyen Vu
+	*	@version 	1.0.0
+  * @brief   	This file provides function to detect CANbus congestion
+	*						and choose a data rate level
+  *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "CANBusMonitor.h"
+
+/**
+  * @brief  Some variables for bus monitor
+  */
+static CAN_HandleTypeDef 							*Monitor_hcan;
+static CAN_Bus_Monitor_HandleTypeDef	Bus_Monitor;
+
+/** @brief    Bus monitor basic function
+  ==============================================================================
+										##### Bus Monitor Basic Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Initialize the monitor.
+    (+) Counting data frame which found every mailbox busy.
+    (+) Sampling TEC/REC and arbitration lost flag.
+    (+) Counting arbitration lost of a completed mailbox in Tx interrupt.
+    (+) Choosing the rate level every window.
+    (+) Updating error state and bus off recovery.
+	[..]
+		A window is congested when a data frame could not be loaded, TEC is at
+		warning level or rising, or arbitration is lost too often. Each congested
+		window halves the data rate (one level up), BUS_RESTORE_WINDOW clear
+		windows in a row double it again (one level down).
+  */
+
+/**
+  * @brief  Initializes the bus monitor
+	* @note		Call Timebase_Init before this function
+	* @param 	hcan      Pointer to the CAN_HandleTypeDef structure.
+  */
+void CAN_Bus_Monitor_Init(CAN_HandleTypeDef *hcan)
+{
+	Monitor_hcan = hcan;
+	Bus_Monitor.tec = 0;
+	Bus_Monitor.rec = 0;
+	Bus_Monitor.level = 0;
+	Bus_Monitor.mailbox_full = 0;
+	Bus_Monitor.arb_lost = 0;
+	Bus_Monitor.window_start_us = Timebase_Get_Us();
+	Bus_Monitor.window_full = 0;
+	Bus_Monitor.window_arb_lost = 0;
+	Bus_Monitor.clear_window = 0;
+	Bus_Monitor.congested = 0;
+	Bus_Monitor.state = BUS_STATE_ACTIVE;
+	Bus_Monitor.recovery_request = 0;
+	Bus_Monitor.bus_off = 0;
+	Bus_Monitor.bus_off_start_us = 0;
+	Bus_Monitor.recovery_last_us = 0;
+	Bus_Monitor.recovery_max_us = 0;
+}
+
+/**
+  * @brief 	Counting result of loading a data frame
+	* @note 	Safe to call from interrupt and from while loop
+	* @param 	status      Return value of HAL_CAN_AddTxMessage.
+  */
+void CAN_Bus_Tx_Result(HAL_StatusTypeDef status)
+{
+	if (status == HAL_OK)
+		return;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	Bus_Monitor.window_full++;
+	Bus_Monitor.mailbox_full++;
+	__set_PRIMASK(primask);
+}
+
+/**
+  * @brief 	Sampling arbitration lost flag of pending mailbox
+	* @note 	Flag is cleared by writing RQCP, pending request is not affected
+  */
+static void CAN_Bus_Arbitration_Sample(void)
+{
+	static const uint32_t alst_flag[3] = {CAN_FLAG_ALST0, CAN_FLAG_ALST1, CAN_FLAG_ALST2};
+	static const uint32_t rqcp_flag[3] = {CAN_FLAG_RQCP0, CAN_FLAG_RQCP1, CAN_FLAG_RQCP2};
+
+	uint8_t tx_it = (Monitor_hcan->Instance->IER & CAN_IER_TMEIE) != 0;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	for (uint8_t i = 0; i < 3; i++)
+	{
+		//A completed request is left to the Tx interrupt, its callback needs RQCP
+		if (!__HAL_CAN_GET_FLAG(Monitor_hcan, alst_flag[i]) || (tx_it && __HAL_CAN_GET_FLAG(Monitor_hcan, rqcp_flag[i])))
+			continue;
+		__HAL_CAN_CLEAR_FLAG(Monitor_hcan, rqcp_flag[i]);
+		Bus_Monitor.window_arb_lost++;
+		Bus_Monitor.arb_lost++;
+	}
+	__set_PRIMASK(primask);
+}
+
+/**
+  * @brief 	Counting arbitration lost of completed mailbox
+	* @note 	With the Tx mailbox empty interrupt active, HAL_CAN_IRQHandler clears
+	*					RQCP and the arbitration lost flag with it, place this function
+	*					in the CAN Tx interrupt before HAL_CAN_IRQHandler
+  */
+void CAN_Bus_Arbitration_Tx_Handle(void)
+{
+	static const uint32_t alst_flag[3] = {CAN_FLAG_ALST0, CAN_FLAG_ALST1, CAN_FLAG_ALST2};
+	static const uint32_t rqcp_flag[3] = {CAN_FLAG_RQCP0, CAN_FLAG_RQCP1, CAN_FLAG_RQCP2};
+
+	if (Monitor_hcan == NULL)
+		return;
+
+	for (uint8_t i = 0; i < 3; i++)
+	{
+		if (!__HAL_CAN_GET_FLAG(Monitor_hcan, alst_flag[i]) || !__HAL_CAN_GET_FLAG(Monitor_hcan, rqcp_flag[i]))
+			continue;
+		Bus_Monitor.window_arb_lost++;
+		Bus_Monitor.arb_lost++;
+	}
+}
+
+/**
+  * @brief 	Updating error state and rate level
+	* @note 	Call this function in while loop
+	* @return	Event mask (BUS_EVENT_x), 0 if nothing changed
+  */
+uint8_t CAN_Bus_Monitor_Update(void)
+{
+	if (Monitor_hcan == NULL)
+		return 0;
+
+	//No window evaluation while the node is off the bus
+	uint8_t event = CAN_Bus_Recovery_Update();
+	if (Bus_Monitor.state == BUS_STATE_OFF)
+		return event;
+
+	CAN_Bus_Arbitration_Sample();
+
+	uint32_t now = Timebase_Get_Us();
+	if ((now - Bus_Monitor.window_start_us) < BUS_MONITOR_WINDOW_US)
+		return event;
+
+	//Close the window
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint16_t full = Bus_Monitor.window_full;
+	Bus_Monitor.window_full = 0;
+	__set_PRIMASK(primask);
+
+	uint32_t esr = Monitor_hcan->Instance->ESR;
+	uint8_t tec = (esr & CAN_ESR_TEC) >> CAN_ESR_TEC_Pos;
+	uint8_t rec = (esr & CAN_ESR_REC) >> CAN_ESR_REC_Pos;
+
+	uint8_t congested = (full > 0) || (tec >= BUS_TEC_WARNING) || (tec > Bus_Monitor.tec)
+											|| (Bus_Monitor.window_arb_lost >= BUS_ARB_LOST_LIMIT);
+
+	Bus_Monitor.tec = tec;
+	Bus_Monitor.rec = rec;
+	Bus_Monitor.window_arb_lost = 0;
+	Bus_Monitor.window_start_us = now;
+
+	uint8_t level = Bus_Monitor.level;
+	if (congested)
+	{
+		//Back off fast
+		Bus_Monitor.congested++;
+		Bus_Monitor.clear_window = 0;
+		if (level < BUS_RATE_LEVEL_MAX)
+			level++;
+	}
+	else if (++Bus_Monitor.clear_window >= BUS_RESTORE_WINDOW)
+	{
+		//Restore slowly
+		Bus_Monitor.clear_window = 0;
+		if (level > 0)
+			level--;
+	}
+
+	if (level == Bus_Monitor.level)
+		return event;
+	Bus_Monitor.level = level;
+	return event | BUS_EVENT_LEVEL;
+}
+
+/** @brief    Bus off recovery function
+  ==============================================================================
+										##### Bus Off Recovery Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Detecting bus off from error interrupt or ESR.
+    (+) Leaving bus off, automatically or supervised.
+    (+) Measuring recovery time.
+	[..]
+		With AutoBusOff enabled, bxCAN starts the 128 x 11 recessive bit
+		sequence as soon as it enters bus off, which is the fastest recovery.
+		With AutoBusOff disabled (supervised), the node waits
+		BUS_RECOVERY_DELAY_US, or CAN_Bus_Recover from the application,
+		then restarts the CAN. Mailboxes and Tx queue are kept in both cases.
+  */
+
+/**
+  * @brief 	Entering bus off state
+	* @note 	Call with interrupt locked
+	* @param 	now      Current time in microsecond.
+  */
+static void CAN_Bus_Enter_Off(uint32_t now)
+{
+	if (Bus_Monitor.state == BUS_STATE_OFF)
+		return;
+	Bus_Monitor.state = BUS_STATE_OFF;
+	Bus_Monitor.recovery_request = 0;
+	Bus_Monitor.bus_off++;
+	Bus_Monitor.bus_off_start_us = now;
+}
+
+/**
+  * @brief 	Handling CAN error
+	* @note 	Place this function in HAL_CAN_ErrorCallback,
+	*					activate CAN_IT_BUSOFF and CAN_IT_ERROR before
+	* @param 	hcan      Pointer to the CAN_HandleTypeDef structure.
+	* @return	Just entered bus off (1) or not (0)
+  */
+uint8_t CAN_Bus_Error_Handle(CAN_HandleTypeDef *hcan)
+{
+	if (hcan != Monitor_hcan)
+		return 0;
+
+	uint8_t entered = 0;
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if ((HAL_CAN_GetError(hcan) & HAL_CAN_ERROR_BOF) && Bus_Monitor.state != BUS_STATE_OFF)
+	{
+		CAN_Bus_Enter_Off(Timebase_Get_Us());
+		entered = 1;
+	}
+	__set_PRIMASK(primask);
+
+	HAL_CAN_ResetError(hcan);
+	return entered;
+}
+
+/**
+  * @brief 	Leaving bus off now
+	* @note 	Use this function in supervised mode (AutoBusOff disabled),
+	*					call from while loop only
+  */
+void CAN_Bus_Recover(void)
+{
+	if (Monitor_hcan == NULL || Bus_Monitor.state != BUS_STATE_OFF || Bus_Monitor.recovery_request)
+		return;
+
+	//Init mode then normal mode starts the bus off recovery sequence
+	Bus_Monitor.recovery_request = 1;
+	HAL_CAN_Stop(Monitor_hcan);
+	HAL_CAN_Start(Monitor_hcan);
+}
+
+/**
+  * @brief 	Updating error state
+	* @return	BUS_EVENT_RECOVERED when node is back on the bus, 0 if not
+  */
+uint8_t CAN_Bus_Recovery_Update(void)
+{
+	uint32_t esr = Monitor_hcan->Instance->ESR;
+	uint32_t now = Timebase_Get_Us();
+
+	if (esr & CAN_ESR_BOFF)
+	{
+		//Error interrupt may be not active, detect by polling as well
+		uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+		CAN_Bus_Enter_Off(now);
+		__set_PRIMASK(primask);
+
+		if (Monitor_hcan->Init.AutoBusOff == DISABLE && (now - Bus_Monitor.bus_off_start_us) >= BUS_RECOVERY_DELAY_US)
+			CAN_Bus_Recover();
+		return 0;
+	}
+
+	uint8_t event = 0;
+	if (Bus_Monitor.state == BUS_STATE_OFF)
+	{
+		uint32_t recovery_us = now - Bus_Monitor.bus_off_start_us;
+		Bus_Monitor.recovery_last_us = recovery_us;
+		if (recovery_us > Bus_Monitor.recovery_max_us)
+			Bus_Monitor.recovery_max_us = recovery_us;
+
+		//Congestion counters before bus off are meaningless now
+		Bus_Monitor.window_start_us = now;
+		Bus_Monitor.window_full = 0;
+		Bus_Monitor.window_arb_lost = 0;
+		Bus_Monitor.clear_window = 0;
+		event = BUS_EVENT_RECOVERED;
+	}
+	Bus_Monitor.state = (esr & CAN_ESR_EPVF) ? BUS_STATE_PASSIVE : BUS_STATE_ACTIVE;
+	return event;
+}
+
+/** @brief    Bus monitor reading function
+  ==============================================================================
+										##### Bus Monitor Reading Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Getting the current rate level.
+    (+) Getting the bus error state.
+    (+) Getting the monitor counters.
+  */
+
+/**
+  * @brief 	Getting the current rate level
+	* @return	Rate level, data period is multiplied by 2^level
+  */
+uint8_t CAN_Bus_Get_Level(void)
+{
+	return Bus_Monitor.level;
+}
+
+/**
+  * @brief 	Getting the bus error state
+	* @return	BUS_STATE_ACTIVE, BUS_STATE_PASSIVE or BUS_STATE_OFF
+  */
+uint8_t CAN_Bus_Get_State(void)
+{
+	return Bus_Monitor.state;
+}
+
+/**
+  * @brief 	Getting the monitor counters
+	* @return	Pointer to the CAN_Bus_Monitor_HandleTypeDef structure
+  */
+CAN_Bus_Monitor_HandleTypeDef *CAN_Bus_Get_Monitor(void)
+{
+	return &Bus_Monitor;
+}
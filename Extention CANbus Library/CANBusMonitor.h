@@ -0,0 +1,93 @@
+/**
+  ******************************************************************************
+  * @file    	CANBusMonitor.h
+  * @author  	Nguyen Vu
+  * @brief   	This file contains all the functions prototypes
+	*						for the CANbus congestion monitor
+  *****************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef CANBUSMONITOR_H_
+#define CANBUSMONITOR_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f1xx_hal.h"
+#include "Timebase.h"
+
+/**
+  * @brief  Configuration Value
+	* @note		Rate level n divides data stream rate by 2^n
+  */
+#define BUS_MONITOR_WINDOW_US		10000		//Evaluation window
+#define BUS_RATE_LEVEL_MAX			3
+#define BUS_RESTORE_WINDOW			10			//Clear windows before restoring one level
+#define BUS_TEC_WARNING					96			//Same as bxCAN error warning limit
+#define BUS_ARB_LOST_LIMIT			8				//Arbitration lost indications in a window
+#define BUS_RECOVERY_DELAY_US		10000		//Supervised recovery, wait before leaving bus off
+
+/**
+  * @brief  Bus error state
+  */
+#define BUS_STATE_ACTIVE				0
+#define BUS_STATE_PASSIVE				1
+#define BUS_STATE_OFF						2
+
+/**
+  * @brief  Bus monitor event, returned by CAN_Bus_Monitor_Update
+  */
+#define BUS_EVENT_LEVEL					0x01		//Rate level changed
+#define BUS_EVENT_RECOVERED			0x02		//Bus off recovery finished
+
+/**
+  * @brief  Bus monitor struct
+	* @param	tec						Transmit error counter at the last window
+	* @param	rec						Receive error counter at the last window
+	* @param	level					Current rate level, 0 is full rate
+	* @param	mailbox_full	Data frame not loaded because every mailbox was busy
+	* @param	arb_lost			Pending mailbox seen with arbitration lost
+	* @param	window_xxx		Counter of the running window
+	* @param	clear_window	Consecutive windows without congestion
+	* @param	congested			Windows evaluated as congested
+	* @param	state					Bus error state (BUS_STATE_x)
+	* @param	bus_off				Bus off event count
+	* @param	recovery_xxx	Time from entering bus off to error active/passive
+  */
+typedef struct
+{
+	uint8_t						tec;
+	uint8_t						rec;
+	uint8_t						level;
+	uint32_t					mailbox_full;
+	uint32_t					arb_lost;
+
+	uint32_t					window_start_us;
+	volatile uint16_t	window_full;
+	uint16_t					window_arb_lost;
+	uint16_t					clear_window;
+	uint32_t					congested;
+
+	volatile uint8_t	state;
+	uint8_t						recovery_request;
+	uint32_t					bus_off;
+	uint32_t					bus_off_start_us;
+	uint32_t					recovery_last_us;
+	uint32_t					recovery_max_us;
+}CAN_Bus_Monitor_HandleTypeDef;
+
+/* Initialization and handling functions  *************************************/
+void CAN_Bus_Monitor_Init(CAN_HandleTypeDef *hcan);
+void CAN_Bus_Tx_Result(HAL_StatusTypeDef status);
+uint8_t CAN_Bus_Monitor_Update(void);
+void CAN_Bus_Arbitration_Tx_Handle(void);
+
+/* Bus off recovery functions  ************************************************/
+uint8_t CAN_Bus_Error_Handle(CAN_HandleTypeDef *hcan);
+void CAN_Bus_Recover(void);
+uint8_t CAN_Bus_Recovery_Update(void);
+
+/* Reading functions  *********************************************************/
+uint8_t CAN_Bus_Get_Level(void);
+uint8_t CAN_Bus_Get_State(void);
+CAN_Bus_Monitor_HandleTypeDef *CAN_Bus_Get_Monitor(void);
+
+#endif
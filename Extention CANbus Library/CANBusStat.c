@@ -0,0 +1,452 @@
+/**
+  ******************************************************************************
+  * @file    	CANBusStat.c
+  * @author  	Nguyen Vu
+	*	@version 	1.0.0
+  * @brief   	This file provides function to measure CANbus load
+	*						and traffic of each identifier
+  *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "CANBusStat.h"
+
+/**
+  * @brief  Received frame waiting to be sized
+  */
+typedef struct
+{
+	uint32_t	id;
+	uint8_t		remote;
+	uint8_t		dlc;
+	uint8_t		data[8];
+	uint32_t	now;
+}CAN_Bus_Stat_RxTypeDef;
+
+/**
+  * @brief  Some variables for bus statistic
+  */
+static CAN_HandleTypeDef 						*Stat_hcan;
+static CAN_Bus_Stat_HandleTypeDef		Bus_Stat;
+static CAN_Bus_Stat_RxTypeDef				Stat_Queue[BUS_STAT_QUEUE_NUM];
+static uint8_t											Stat_Queue_Head;
+static uint8_t											Stat_Queue_Tail;
+
+/**
+  * @brief  Bit stream state for stuffing and CRC
+  */
+typedef struct
+{
+	uint16_t	crc;
+	uint8_t		last;
+	uint8_t		run;
+	uint32_t	bits;
+}CAN_Bus_Stat_StreamTypeDef;
+
+/** @brief    Frame size function
+  ==============================================================================
+										##### Frame Size Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Computing the bit count of a frame on the bus, stuff bits included.
+	[..]
+		The frame is rebuilt bit by bit with its CRC, so stuff bits are the
+		exact ones the transmitter inserts (one after 5 equal bits, SOF to CRC).
+  */
+
+/**
+  * @brief  Putting bits in the stream
+	* @param 	stream     	Pointer to the CAN_Bus_Stat_StreamTypeDef structure.
+	* @param 	value     	Bits, MSB first.
+	* @param 	num     		Number of bits.
+	* @param 	crc     		Bits are covered by CRC (1) or are the CRC (0).
+  */
+static void CAN_Bus_Stat_Put(CAN_Bus_Stat_StreamTypeDef *stream, uint32_t value, uint8_t num, uint8_t crc)
+{
+	for (int8_t i = num - 1; i >= 0; i--)
+	{
+		uint8_t bit = (value >> i) & 1;
+
+		if (crc)
+		{
+			uint8_t next = bit ^ ((stream->crc >> 14) & 1);
+			stream->crc = (stream->crc << 1) & 0x7FFF;
+			if (next)
+				stream->crc ^= BUS_STAT_CRC_POLY;
+		}
+
+		//Stuff bit is the complement and starts a new run
+		stream->bits++;
+		if (bit != stream->last)
+		{
+			stream->last = bit;
+			stream->run = 1;
+		}
+		else if (++stream->run == 5)
+		{
+			stream->bits++;
+			stream->last = !bit;
+			stream->run = 1;
+		}
+	}
+}
+
+/**
+  * @brief  Computing the bit count of a frame
+	* @param 	id     		Standard or extended identifier.
+	* @param 	ext     	Extended identifier (1) or standard (0).
+	* @param 	remote    Remote frame (1) or data frame (0).
+	* @param 	dlc     	Data length code.
+	* @param 	data     	Data array, not read for a remote frame.
+	* @return	Bits from SOF to the end of intermission
+  */
+uint32_t CAN_Bus_Stat_Frame_Bits(uint32_t id, uint8_t ext, uint8_t remote, uint8_t dlc, const uint8_t *data)
+{
+	CAN_Bus_Stat_StreamTypeDef stream = {0, 2, 0, 0};
+	uint8_t bytes = (remote) ? 0 : ((dlc > 8) ? 8 : dlc);
+
+	//SOF and arbitration field
+	CAN_Bus_Stat_Put(&stream, 0, 1, 1);
+	if (ext)
+	{
+		CAN_Bus_Stat_Put(&stream, id >> 18, 11, 1);
+		CAN_Bus_Stat_Put(&stream, 0x3, 2, 1);
+		CAN_Bus_Stat_Put(&stream, id & 0x3FFFF, 18, 1);
+		CAN_Bus_Stat_Put(&stream, remote ? 1 : 0, 1, 1);
+	}
+	else
+	{
+		CAN_Bus_Stat_Put(&stream, id & 0x7FF, 11, 1);
+		CAN_Bus_Stat_Put(&stream, remote ? 1 : 0, 1, 1);
+	}
+
+	//IDE and r0 (standard) or r1 and r0 (extended), DLC and data
+	CAN_Bus_Stat_Put(&stream, 0, 2, 1);
+	CAN_Bus_Stat_Put(&stream, dlc & 0x0F, 4, 1);
+	for (uint8_t i = 0; i < bytes; i++)
+		CAN_Bus_Stat_Put(&stream, data[i], 8, 1);
+
+	CAN_Bus_Stat_Put(&stream, stream.crc, 15, 0);
+	return stream.bits + BUS_STAT_TAIL_BITS;
+}
+
+/** @brief    Bus statistic basic function
+  ==============================================================================
+										##### Bus Statistic Basic Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Initialize the statistic and the sniffing filter.
+    (+) Counting received and transmitted frames by identifier.
+    (+) Closing the load window.
+	[..]
+		Transmitted frames are counted when loaded in a mailbox, a data frame
+		aborted for a fresher one is taken back with the average size of its
+		identifier. Inter-arrival time of a transmitted identifier is the time
+		between loads. Received frames are queued in the Rx interrupt with their
+		receive time and rebuilt bit by bit in CAN_Bus_Stat_Update, so a fully
+		loaded bus does not run the CRC and stuffing in interrupt.
+  */
+
+/**
+  * @brief  Initializes the bus statistic
+	* @note		Call Timebase_Init and bit rate detection before this function,
+	*					with BUS_STAT_SNIFF place CAN_Bus_Stat_FIFO1_Handle in
+	*					HAL_CAN_RxFifo1MsgPendingCallback
+	* @param 	hcan      Pointer to the CAN_HandleTypeDef structure.
+  */
+void CAN_Bus_Stat_Init(CAN_HandleTypeDef *hcan)
+{
+	Stat_hcan = hcan;
+	CAN_Bus_Stat_Reset();
+
+#if BUS_STAT_SNIFF
+	//Lowest priority accept all filter, slave frames still match their own bank
+	CAN_FilterTypeDef canfilter;
+	CAN_Fifo1_Filter_Config(hcan, &canfilter, BUS_STAT_FILTER_BANK, 0, 0);
+	HAL_CAN_ActivateNotification(hcan, CAN_IT_RX_FIFO1_MSG_PENDING);
+#endif
+}
+
+/**
+  * @brief  Resetting every counter
+  */
+void CAN_Bus_Stat_Reset(void)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	Bus_Stat = (CAN_Bus_Stat_HandleTypeDef){0};
+	Bus_Stat.window_start_us = Timebase_Get_Us();
+	Stat_Queue_Head = Stat_Queue_Tail = 0;
+	__set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Finding the entry of an identifier, a new one if there is room
+	* @note		Call with interrupt locked
+	* @param 	id      Identifier, with BUS_STAT_EXT if extended.
+	* @param 	create  Take a free entry if not found (1) or not (0).
+	* @return	Pointer to the entry, NULL if not tracked
+  */
+static CAN_Bus_Stat_EntryTypeDef *CAN_Bus_Stat_Find(uint32_t id, uint8_t create)
+{
+	for (uint8_t i = 0; i < Bus_Stat.entry_num; i++)
+		if (Bus_Stat.entry[i].id == id)
+			return &Bus_Stat.entry[i];
+
+	if (!create || Bus_Stat.entry_num >= BUS_STAT_ID_NUM)
+		return NULL;
+
+	CAN_Bus_Stat_EntryTypeDef *entry = &Bus_Stat.entry[Bus_Stat.entry_num++];
+	*entry = (CAN_Bus_Stat_EntryTypeDef){0};
+	entry->id = id;
+	entry->gap_min_us = 0xFFFFFFFF;
+	return entry;
+}
+
+/**
+  * @brief  Counting a frame
+	* @param 	id      Identifier, with BUS_STAT_EXT if extended.
+	* @param 	dir     BUS_STAT_RX or BUS_STAT_TX.
+	* @param 	bytes   Data bytes.
+	* @param 	bits    Bits on the bus.
+	* @param 	now     Time of the frame in microsecond.
+  */
+static void CAN_Bus_Stat_Count(uint32_t id, uint8_t dir, uint8_t bytes, uint32_t bits, uint32_t now)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	Bus_Stat.window_bits += bits;
+	if (dir == BUS_STAT_RX)
+		Bus_Stat.rx_frames++;
+	else
+		Bus_Stat.tx_frames++;
+
+	CAN_Bus_Stat_EntryTypeDef *entry = CAN_Bus_Stat_Find(id, 1);
+	if (entry == NULL)
+		Bus_Stat.untracked++;
+	else
+	{
+		if (entry->frames)
+		{
+			uint32_t gap = now - entry->last_us;
+			if (gap < entry->gap_min_us)
+				entry->gap_min_us = gap;
+			if (gap > entry->gap_max_us)
+				entry->gap_max_us = gap;
+			entry->gap_sum_us += gap;
+		}
+		entry->dir |= dir;
+		entry->frames++;
+		entry->bytes += bytes;
+		entry->bits += bits;
+		entry->last_us = now;
+	}
+	__set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Counting a received frame
+	* @note		Call from the Rx interrupt of each FIFO, the frame is only queued
+	*					and sized later in CAN_Bus_Stat_Update.
+	* @param 	RxHeader    Pointer to the CAN_RxHeaderTypeDef structure.
+	* @param 	data      	Data array.
+	* @param 	now      		Receive time in microsecond.
+  */
+void CAN_Bus_Stat_Rx(CAN_RxHeaderTypeDef *RxHeader, uint8_t *data, uint32_t now)
+{
+	uint8_t ext = (RxHeader->IDE == CAN_ID_EXT);
+	uint8_t remote = (RxHeader->RTR == CAN_RTR_REMOTE);
+	uint8_t bytes = (remote) ? 0 : ((RxHeader->DLC > 8) ? 8 : RxHeader->DLC);
+	uint32_t id = ext ? (RxHeader->ExtId | BUS_STAT_EXT) : RxHeader->StdId;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint8_t next = (Stat_Queue_Head + 1) % BUS_STAT_QUEUE_NUM;
+	if (next != Stat_Queue_Tail)
+	{
+		CAN_Bus_Stat_RxTypeDef *frame = &Stat_Queue[Stat_Queue_Head];
+		frame->id = id;
+		frame->remote = remote;
+		frame->dlc = RxHeader->DLC;
+		for (uint8_t i = 0; i < bytes; i++)
+			frame->data[i] = data[i];
+		frame->now = now;
+		Stat_Queue_Head = next;
+		__set_PRIMASK(primask);
+		return;
+	}
+	Bus_Stat.unstuffed++;
+	__set_PRIMASK(primask);
+
+	//Queue full, count now without stuff bits
+	uint32_t bits = (ext ? BUS_STAT_EXT_BITS : BUS_STAT_STD_BITS) + 8 * bytes + BUS_STAT_TAIL_BITS;
+	CAN_Bus_Stat_Count(id, BUS_STAT_RX, bytes, bits, now);
+}
+
+/**
+  * @brief  Sizing and counting the queued frames
+	* @note		Call in while loop, bounded to one queue length
+  */
+static void CAN_Bus_Stat_Rx_Drain(void)
+{
+	for (uint8_t i = 0; i < BUS_STAT_QUEUE_NUM; i++)
+	{
+		uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+		if (Stat_Queue_Tail == Stat_Queue_Head)
+		{
+			__set_PRIMASK(primask);
+			return;
+		}
+		CAN_Bus_Stat_RxTypeDef frame = Stat_Queue[Stat_Queue_Tail];
+		Stat_Queue_Tail = (Stat_Queue_Tail + 1) % BUS_STAT_QUEUE_NUM;
+		__set_PRIMASK(primask);
+
+		uint8_t ext = (frame.id & BUS_STAT_EXT) ? 1 : 0;
+		uint32_t bits = CAN_Bus_Stat_Frame_Bits(frame.id & ~BUS_STAT_EXT, ext, frame.remote, frame.dlc, frame.data);
+		CAN_Bus_Stat_Count(frame.id, BUS_STAT_RX, frame.remote ? 0 : frame.dlc, bits, frame.now);
+	}
+}
+
+/**
+  * @brief  Counting a frame loaded in a mailbox
+	* @note		Place this function in CAN_Transmit_Handle
+	* @param 	TxHeader    Pointer to the CAN_TxHeaderTypeDef structure.
+	* @param 	data      	Data array.
+  */
+void CAN_Bus_Stat_Tx(CAN_TxHeaderTypeDef *TxHeader, uint8_t *data)
+{
+	uint8_t ext = (TxHeader->IDE == CAN_ID_EXT);
+	uint8_t remote = (TxHeader->RTR == CAN_RTR_REMOTE);
+	uint32_t id = ext ? TxHeader->ExtId : TxHeader->StdId;
+	uint32_t bits = CAN_Bus_Stat_Frame_Bits(id, ext, remote, TxHeader->DLC, data);
+
+	CAN_Bus_Stat_Count(ext ? (id | BUS_STAT_EXT) : id, BUS_STAT_TX, remote ? 0 : TxHeader->DLC, bits, Timebase_Get_Us());
+}
+
+/**
+  * @brief  Taking back an aborted frame
+	* @param 	StdId      Standard identifier of the aborted frame.
+  */
+void CAN_Bus_Stat_Tx_Abort(uint32_t StdId)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	CAN_Bus_Stat_EntryTypeDef *entry = CAN_Bus_Stat_Find(StdId, 0);
+	if (entry != NULL && entry->frames > 1)
+	{
+		uint32_t bits = entry->bits / entry->frames;
+		entry->bytes -= entry->bytes / entry->frames;
+		entry->bits -= bits;
+		entry->frames--;
+		Bus_Stat.window_bits -= (bits < Bus_Stat.window_bits) ? bits : Bus_Stat.window_bits;
+		Bus_Stat.tx_frames--;
+	}
+	__set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Counting every frame waiting in FIFO1
+	* @note		Place this function in HAL_CAN_RxFifo1MsgPendingCallback
+	* @param 	hcan      Pointer to the CAN_HandleTypeDef structure.
+  */
+void CAN_Bus_Stat_FIFO1_Handle(CAN_HandleTypeDef *hcan)
+{
+	uint32_t now = Timebase_Get_Us();
+	CAN_RxHeaderTypeDef RxHeader;
+	uint8_t 						data[8];
+
+	while (HAL_CAN_GetRxFifoFillLevel(hcan, CAN_RX_FIFO1))
+	{
+		if (HAL_CAN_GetRxMessage(hcan, CAN_RX_FIFO1, &RxHeader, data) != HAL_OK)
+			return;
+		CAN_Bus_Stat_Rx(&RxHeader, data, now);
+	}
+}
+
+/**
+  * @brief  Counting the queued frames and closing the load window
+	* @note		Call this function in while loop
+  */
+void CAN_Bus_Stat_Update(void)
+{
+	if (Stat_hcan == NULL)
+		return;
+
+	//Frames of the window are counted before it closes
+	CAN_Bus_Stat_Rx_Drain();
+
+	uint32_t now = Timebase_Get_Us();
+	uint32_t elapsed = now - Bus_Stat.window_start_us;
+	if (elapsed < BUS_STAT_WINDOW_US)
+		return;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint32_t bits = Bus_Stat.window_bits;
+	Bus_Stat.window_bits = 0;
+	__set_PRIMASK(primask);
+	Bus_Stat.window_start_us = now;
+
+	//Bit time x bits / window, in per mille
+	uint32_t bitrate = CAN_Get_Bitrate(Stat_hcan);
+	uint64_t load = bitrate ? ((uint64_t)bits * 1000000000U) / ((uint64_t)bitrate * elapsed) : 0;
+	if (load > 1000)
+		load = 1000;
+
+	Bus_Stat.load_last = (uint16_t)load;
+	Bus_Stat.load[Bus_Stat.load_index] = (uint16_t)load;
+	Bus_Stat.load_index = (Bus_Stat.load_index + 1) % BUS_STAT_WINDOW_NUM;
+	if (load > Bus_Stat.load_peak)
+		Bus_Stat.load_peak = (uint16_t)load;
+
+	uint32_t sum = 0;
+	for (uint8_t i = 0; i < BUS_STAT_WINDOW_NUM; i++)
+		sum += Bus_Stat.load[i];
+	Bus_Stat.load_avg = sum / BUS_STAT_WINDOW_NUM;
+}
+
+/** @brief    Bus statistic reading function
+  ==============================================================================
+										##### Bus Statistic Reading Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Getting the statistic.
+    (+) Getting a tracked identifier.
+    (+) Getting the average inter-arrival time.
+  */
+
+/**
+  * @brief 	Getting the statistic
+	* @return	Pointer to the CAN_Bus_Stat_HandleTypeDef structure
+  */
+CAN_Bus_Stat_HandleTypeDef *CAN_Bus_Get_Stat(void)
+{
+	return &Bus_Stat;
+}
+
+/**
+  * @brief 	Getting a tracked identifier
+	* @param 	slot      Entry index, in order of first frame.
+	* @return	Pointer to the entry, NULL if slot is not used
+  */
+CAN_Bus_Stat_EntryTypeDef *CAN_Bus_Stat_Get_Entry(uint8_t slot)
+{
+	if (slot >= Bus_Stat.entry_num)
+		return NULL;
+	return &Bus_Stat.entry[slot];
+}
+
+/**
+  * @brief 	Getting the average inter-arrival time
+	* @param 	entry      Pointer to the CAN_Bus_Stat_EntryTypeDef structure.
+	* @return	Average in microsecond, 0 if less than 2 frames
+  */
+uint32_t CAN_Bus_Stat_Get_Gap_Avg(CAN_Bus_Stat_EntryTypeDef *entry)
+{
+	if (entry->frames < 2)
+		return 0;
+	return (uint32_t)(entry->gap_sum_us / (entry->frames - 1));
+}
@@ -0,0 +1,126 @@
+/**
+  ******************************************************************************
+  * @file    	CANBusStat.h
+  * @author  	Nguyen Vu
+  * @brief   	This file contains all the functions prototypes
+	*						for the CANbus load and per identifier statistics
+  *****************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef CANBUSSTAT_H_
+#define CANBUSSTAT_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "bxCANlib.h"
+#include "Timebase.h"
+
+/**
+  * @brief  Configuration Value
+	* @note		Bus load is given in per mille of the bit rate. The sliding load
+	*					covers the last BUS_STAT_WINDOW_NUM windows.
+	*					With BUS_STAT_SNIFF, every frame not accepted by the slave filters
+	*					goes to FIFO1 through BUS_STAT_FILTER_BANK and is only counted,
+	*					so the load is the whole bus and not only the slave traffic.
+	*					It costs one Rx interrupt per frame on the bus, the interrupt only
+	*					queues the frame and CAN_Bus_Stat_Update sizes it. A frame received
+	*					with the queue full is counted at once with its size before stuffing.
+  */
+#define BUS_STAT_SNIFF					1
+#define BUS_STAT_FILTER_BANK		12			//Below CAN_DETECT_FILTER_BANK, configured after bit rate detection
+#define BUS_STAT_WINDOW_US			100000
+#define BUS_STAT_WINDOW_NUM			10
+#define BUS_STAT_ID_NUM					16			//Identifiers tracked, frames of the others are only counted
+#define BUS_STAT_QUEUE_NUM			32			//Received frames waiting for CAN_Bus_Stat_Update
+
+/**
+  * @brief  Frame size value in bit
+	* @note		SOF to end of CRC is stuffed, CRC delimiter, ACK, EOF and
+	*					intermission are not.
+  */
+#define BUS_STAT_TAIL_BITS			13
+#define BUS_STAT_STD_BITS				34			//SOF to DLC and CRC of a standard frame, before stuffing
+#define BUS_STAT_EXT_BITS				54			//Same for an extended frame
+#define BUS_STAT_CRC_POLY				0x4599
+
+/**
+  * @brief  Identifier flag and direction
+  */
+#define BUS_STAT_EXT						0x80000000U		//Set in id for an extended identifier
+#define BUS_STAT_RX							0x01
+#define BUS_STAT_TX							0x02
+
+/**
+  * @brief  Per identifier statistic struct
+	* @param	id					Standard ID, or extended ID | BUS_STAT_EXT
+	* @param	dir					Direction seen (BUS_STAT_RX, BUS_STAT_TX)
+	* @param	frames			Frame count
+	* @param	bytes				Data byte count
+	* @param	bits				Bit count on the bus, stuff bits included
+	* @param	last_us			Time of the last frame
+	* @param	gap_xxx			Inter-arrival time statistic, average is gap_sum_us / (frames - 1)
+  */
+typedef struct
+{
+	uint32_t	id;
+	uint8_t		dir;
+	uint32_t	frames;
+	uint32_t	bytes;
+	uint32_t	bits;
+	uint32_t	last_us;
+	uint32_t	gap_min_us;
+	uint32_t	gap_max_us;
+	uint64_t	gap_sum_us;
+}CAN_Bus_Stat_EntryTypeDef;
+
+/**
+  * @brief  Bus statistic struct
+	* @param	entry					Tracked identifiers, used in order of first frame
+	* @param	entry_num			Tracked identifier count
+	* @param	untracked			Frames of identifiers not tracked because the table is full
+	* @param	unstuffed			Frames counted without stuff bits because the queue was full
+	* @param	rx_frames			Frame received (FIFO0 and FIFO1)
+	* @param	tx_frames			Frame loaded in a mailbox, aborted frames are taken back
+	* @param	window_xxx		Running window
+	* @param	load					Load of each closed window in per mille, ring
+	* @param	load_index		Next ring slot
+	* @param	load_last			Load of the last closed window in per mille
+	* @param	load_avg			Load of the last BUS_STAT_WINDOW_NUM windows in per mille,
+	*												windows not closed yet count as idle
+	* @param	load_peak			Highest window load in per mille
+  */
+typedef struct
+{
+	CAN_Bus_Stat_EntryTypeDef	entry[BUS_STAT_ID_NUM];
+	uint8_t										entry_num;
+	uint32_t									untracked;
+	uint32_t									unstuffed;
+	uint32_t									rx_frames;
+	uint32_t									tx_frames;
+
+	uint32_t									window_start_us;
+	volatile uint32_t					window_bits;
+	uint16_t									load[BUS_STAT_WINDOW_NUM];
+	uint8_t										load_index;
+	uint16_t									load_last;
+	uint16_t									load_avg;
+	uint16_t									load_peak;
+}CAN_Bus_Stat_HandleTypeDef;
+
+/* Initialization and handling functions  *************************************/
+void CAN_Bus_Stat_Init(CAN_HandleTypeDef *hcan);
+void CAN_Bus_Stat_Update(void);
+void CAN_Bus_Stat_Reset(void);
+
+/* Counting functions  ********************************************************/
+void CAN_Bus_Stat_Rx(CAN_RxHeaderTypeDef *RxHeader, uint8_t *data, uint32_t now);
+void CAN_Bus_Stat_Tx(CAN_TxHeaderTypeDef *TxHeader, uint8_t *data);
+void CAN_Bus_Stat_Tx_Abort(uint32_t StdId);
+void CAN_Bus_Stat_FIFO1_Handle(CAN_HandleTypeDef *hcan);
+uint32_t CAN_Bus_Stat_Frame_Bits(uint32_t id, uint8_t ext, uint8_t remote, uint8_t dlc, const uint8_t *data);
+
+/* Reading functions  *********************************************************/
+CAN_Bus_Stat_HandleTypeDef *CAN_Bus_Get_Stat(void);
+CAN_Bus_Stat_EntryTypeDef *CAN_Bus_Stat_Get_Entry(uint8_t slot);
+uint32_t CAN_Bus_Stat_Get_Gap_Avg(CAN_Bus_Stat_EntryTypeDef *entry);
+
+#endif
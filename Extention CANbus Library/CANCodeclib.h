@@ -0,0 +1,64 @@
+/**
+  ******************************************************************************
+  * @file    	CANCodeclib.h
+  * @author  	Nguyen Vu
+  * @brief   	This file generates the pack and unpack functions
+	*						of every frame in CAN_MESSAGE_TABLE
+  *****************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef CANCODECLIB_H_
+#define CANCODECLIB_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f1xx_hal.h"
+#include "CANConfig.h"
+#include "string.h"
+
+/**
+  * @brief  Wire order is LSB first, same as the memory order of Cortex-M3,
+	*					so every field is a plain copy (a single load or store after inlining).
+  */
+#if defined(__BIG_ENDIAN) || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#error "CANCodeclib needs a little-endian target"
+#endif
+
+/**
+  * @brief  Field generators, one F(type, field) row of a message
+  */
+#define CAN_MSG_FIELD_DECL(type, field)			type field;
+#define CAN_MSG_FIELD_SIZE(type, field)			+ sizeof(type)
+#define CAN_MSG_FIELD_PACK(type, field)			memcpy(&data[pos], &msg->field, sizeof(type)); pos += sizeof(type);
+#define CAN_MSG_FIELD_UNPACK(type, field)		memcpy(&msg->field, &data[pos], sizeof(type)); pos += sizeof(type);
+
+/**
+  * @brief  Message generator, one X(name) row of CAN_MESSAGE_TABLE
+	* @note		CAN_Msg_name_Pack fills name_SIZE bytes of data and returns name_SIZE,
+	*					CAN_Msg_name_Unpack reads name_SIZE bytes, check DLC before calling it.
+  */
+#define CAN_MSG_CODEC(name) \
+typedef struct \
+{ \
+	CAN_MSG_##name(CAN_MSG_FIELD_DECL) \
+}CAN_Msg_##name##_TypeDef; \
+\
+enum { CAN_MSG_##name##_SIZE = 0 CAN_MSG_##name(CAN_MSG_FIELD_SIZE) }; \
+typedef char CAN_Msg_##name##_SizeCheck[((int)CAN_MSG_##name##_SIZE == (int)name##_DLC) ? 1 : -1]; \
+\
+static inline uint8_t CAN_Msg_##name##_Pack(const CAN_Msg_##name##_TypeDef *msg, uint8_t *data) \
+{ \
+	uint8_t pos = 0; \
+	CAN_MSG_##name(CAN_MSG_FIELD_PACK) \
+	return pos; \
+} \
+\
+static inline uint8_t CAN_Msg_##name##_Unpack(CAN_Msg_##name##_TypeDef *msg, const uint8_t *data) \
+{ \
+	uint8_t pos = 0; \
+	CAN_MSG_##name(CAN_MSG_FIELD_UNPACK) \
+	return pos; \
+}
+
+CAN_MESSAGE_TABLE(CAN_MSG_CODEC)
+
+#endif
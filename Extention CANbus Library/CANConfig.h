@@ -15,64 +15,401 @@
 
 /**
   * @brief  Configuration Queue Size
+	* @note		Commands pipelined by master wait in the Rx queue
   */
-#define CAN_QUEUE_CAPACITY	4	
+#define CAN_QUEUE_CAPACITY	8	
+
+/**
+  * @brief  Configuration Identifier Layout
+	* @note		StdId = [function (3 bit)][node (3 bit)][sensor (2 bit)][command (3 bit)]
+	*					Master command and slave feedback use different function,
+	*					so master and slaves never send the same ID.
+	*					FUNC_NMT frames are broadcast, their node field is ignored.
+	*					Frames are listed in CAN_FRAME_TABLE.
+  */
+#define FUNC_POS				8
+#define NODE_POS				5
+#define SENSOR_POS			3
+#define CMD_POS					0
+
+#define FUNC_MASK				0x07
+#define NODE_MASK				0x07
+#define SENSOR_MASK			0x03
+#define CMD_MASK				0x07
+
+#define NODE_NUM				8				//Node ID is 0 to NODE_NUM-1
+
+#define CAN_STDID(func, node, sensor, cmd)	(((func) << FUNC_POS) | ((node) << NODE_POS) | \
+																						 ((sensor) << SENSOR_POS) | ((cmd) << CMD_POS))
+
+/**
+  * @brief  Configuration Function, lower value wins arbitration
+	* @note		Reorder the values to change the urgency of a whole class
+  */
+#define FUNC_EMCY				0x00		//Stop command, stop feedback and error report
+#define FUNC_NMT				0x01		//Master broadcast
+#define FUNC_CMD				0x02		//Master command to a node
+#define FUNC_FB					0x03		//Slave feedback of a command
+#define FUNC_DATA				0x04		//Slave sensor data
+#define FUNC_MGMT				0x05		//Node management
+#define FUNC_DIAG				0x06		//Slave diagnostics report
+#define FUNC_BULK				0x07		//Segmented transfer, uses the bus time left
 
 /**
   * @brief  Configuration Sensor ID
   */
 #define IMU_ID 					0x00
 #define ENC_ID					0x01
+#define SLAVE_ID				0x02		//Node level frames, not a sensor
+#define SENSOR_NUM			0x02		//Number of sensor, sensor ID is 0 to SENSOR_NUM-1
+
+/**
+  * @brief  Configuration Frame Table
+	* @note		One row per frame: X(name, function, command, DLC), it generates
+	*					name_FUNC, name_ID (command field), name_DLC and CAN_FRAME_name.
+	*					Function and command must be unique, frames are decoded from them.
+	*					Sensor frames are sent with the sensor ID, the others with SLAVE_ID.
+	*					Frame order follows urgency: stop/error, sync/command,
+	*					feedback, sensor data, management, diagnostics.
+	*					A command may carry one more tag byte (DLC = table DLC + 1),
+	*					the tag is appended to every feedback and error while the command
+	*					is handled, so master can pipeline commands and match feedback.
+	*					ENC_ASSIGN and DIAG_FB are full and have no room for a tag.
+	*
+	*					START: 			[period LSB][period MSB][stream mode], DLC 2 still accepted
+	*					BATCH: 			[sensor mask][period code of sensor 0 to 3][mode 0 | mode 1 << 4][mode 2 | mode 3 << 4]
+	*					BATCH_FB: 	[started sensor mask][status]
+	*					DIAG_RQ: 		[page][index]
+	*					BITRATE: 		[kbit/s (16 bit)][sample point per mille (16 bit), 0 is default][save to flash]
+	*					NODE_SET: 	[new node ID][save to flash]
+	*					DIAG_FB: 		[page][index][6 bytes page data]
+	*					BITRATE_FB: [kbit/s (16 bit)][achieved sample point (16 bit)][status]
+	*					NODE_FB: 		[new node ID][status], sent with the old node ID
+	*					PARAM: 			[operation][index][value (32 bit LSB first)]
+	*					PARAM_FB: 	[operation][index][value (32 bit LSB first)][status]
+	*					SYNC: 			[seq][master time of previous SYNC in us (LSB first)]
+	*					SYNC_FB: 		[seq][slave capture time of this SYNC in us (LSB first)]
+	*					BULK_x: 		Segmented transfer frame sent by slave or master, see CANTransferlib
+	*					x_DATA: 		Signals packed with the stream mapping, table DLC is the default mapping
+  */
+#define CAN_FRAME_TABLE(X) \
+	X(STOP,					FUNC_EMCY,	0x00,	0x00)	\
+	X(STOP_FB,			FUNC_EMCY,	0x01,	0x00)	\
+	X(ERROR,				FUNC_EMCY,	0x02,	0x00)	\
+	X(SYNC,					FUNC_NMT,		0x00,	0x05)	\
+	X(START,				FUNC_CMD,		0x00,	0x03)	\
+	X(RESET,				FUNC_CMD,		0x01,	0x00)	\
+	X(PARAM,				FUNC_CMD,		0x02,	0x06)	\
+	X(BATCH,				FUNC_CMD,		0x04,	0x07)	\
+	X(ENC_ASSIGN,		FUNC_CMD,		0x03,	0x08)	\
+	X(DIAG_RQ,			FUNC_CMD,		0x05,	0x02)	\
+	X(BITRATE,			FUNC_CMD,		0x06,	0x05)	\
+	X(NODE_SET,			FUNC_CMD,		0x07,	0x02)	\
+	X(START_FB,			FUNC_FB,		0x00,	0x03)	\
+	X(RESET_FB,			FUNC_FB,		0x01,	0x00)	\
+	X(PARAM_FB,			FUNC_FB,		0x02,	0x07)	\
+	X(ASSIGN_FB,		FUNC_FB,		0x03,	0x08)	\
+	X(SYNC_FB,			FUNC_FB,		0x04,	0x05)	\
+	X(BATCH_FB,			FUNC_FB,		0x05,	0x02)	\
+	X(BITRATE_FB,		FUNC_FB,		0x06,	0x05)	\
+	X(NODE_FB,			FUNC_FB,		0x07,	0x02)	\
+	X(IMU_DATA,			FUNC_DATA,	0x00,	0x07)	\
+	X(ENC_DATA,			FUNC_DATA,	0x01,	0x08)	\
+	X(MGMT_CLAIM,		FUNC_MGMT,	0x00,	0x04)	\
+	X(MGMT_BOOTUP,	FUNC_MGMT,	0x01,	0x05)	\
+	X(DIAG_FB,			FUNC_DIAG,	0x00,	0x08)	\
+	X(BULK_SLAVE,		FUNC_BULK,	0x00,	0x08)	\
+	X(BULK_MASTER,	FUNC_BULK,	0x01,	0x08)
+
+#define CAN_FRAME_CONST(name, func, cmd, dlc)		name##_FUNC = (func), name##_ID = (cmd), name##_DLC = (dlc),
+#define CAN_FRAME_INDEX(name, func, cmd, dlc)		CAN_FRAME_##name,
+
+enum
+{
+	CAN_FRAME_TABLE(CAN_FRAME_CONST)
+};
+
+typedef enum
+{
+	CAN_FRAME_TABLE(CAN_FRAME_INDEX)
+	CAN_FRAME_NUM
+}CAN_Frame_TypeDef;
+
+/**
+  * @brief  Configuration Message Schema
+	* @note		One row per frame with multi byte fields: X(name), CAN_MSG_name(F) lists
+	*					its fields as F(type, field) in wire order, LSB first, packed without gap.
+	*					CANCodeclib generates CAN_Msg_name_TypeDef with its pack and unpack
+	*					function, and fails to compile if the field sizes do not add up to name_DLC.
+	*					MGMT_CLAIM is the first 4 bytes of MGMT_BOOTUP.
+  */
+#define CAN_MSG_START(F)				F(uint16_t,	period)				F(uint8_t,	mode)
+#define CAN_MSG_PARAM(F)				F(uint8_t,	op)						F(uint8_t,	index)					F(uint32_t,	value)
+#define CAN_MSG_PARAM_FB(F)			F(uint8_t,	op)						F(uint8_t,	index)					F(uint32_t,	value)	F(uint8_t,	status)
+#define CAN_MSG_ENC_ASSIGN(F)		F(float,		x)						F(float,		y)
+#define CAN_MSG_BITRATE(F)			F(uint16_t,	kbps)					F(uint16_t,	sample_point)		F(uint8_t,	save)
+#define CAN_MSG_BITRATE_FB(F)		F(uint16_t,	kbps)					F(uint16_t,	sample_point)		F(uint8_t,	status)
+#define CAN_MSG_SYNC(F)					F(uint8_t,	seq)					F(uint32_t,	master_us)
+#define CAN_MSG_SYNC_FB(F)			F(uint8_t,	seq)					F(uint32_t,	capture_us)
+#define CAN_MSG_MGMT_CLAIM(F)		F(uint32_t,	hash)
+#define CAN_MSG_MGMT_BOOTUP(F)	F(uint32_t,	hash)					F(uint8_t,	status)
+
+#define CAN_MESSAGE_TABLE(X) \
+	X(START)				\
+	X(PARAM)				\
+	X(PARAM_FB)			\
+	X(ENC_ASSIGN)		\
+	X(BITRATE)			\
+	X(BITRATE_FB)		\
+	X(SYNC)					\
+	X(SYNC_FB)			\
+	X(MGMT_CLAIM)		\
+	X(MGMT_BOOTUP)
+
+/**
+  * @brief  Configuration Batch Start, sent with Sensor ID = SLAVE_ID
+	* @note		Every sensor in the mask is started, or none if one setting is invalid.
+	*					Period code: [unit (2 bit)][count (6 bit)], period = count x unit,
+	*					unit 0: 100 us, 1: 1 ms, 2: 10 ms, 3: 100 ms.
+	*					Count 0 is only valid for STREAM_MODE_SYNC and STREAM_MODE_POLL.
+  */
+#define BATCH_OK						0x00
+#define BATCH_INVALID				0x01
+#define BATCH_SLOT_NUM			0x04		//Period code slots, sensor ID 0 to 3
+#define BATCH_UNIT_POS			6
+#define BATCH_COUNT_MASK		0x3F
+
+/**
+  * @brief  Configuration Parameter, sent with Sensor ID = SLAVE_ID
+	* @note		PARAM_OP_WRITE checks the range and applies the value at once,
+	*					PARAM_OP_COMMIT saves every parameter, the running streams and the last
+	*					assigned encoder position to flash (CPU stalls a few ms),
+	*					PARAM_OP_DEFAULT restores and applies the defaults, flash is kept.
+	*					Float value is sent as its IEEE 754 bits.
+	*					MAP operations edit a staged signal mapping, index high nibble is
+	*					the map (sensor ID), low nibble the entry. MAP_APPLY checks and
+	*					compiles the staged entries, then the data frames use them.
+  */
+#define PARAM_OP_READ				0x00
+#define PARAM_OP_WRITE			0x01
+#define PARAM_OP_COMMIT			0x02
+#define PARAM_OP_DEFAULT		0x03
+#define PARAM_OP_MAP_READ		0x04		//index: [map][entry], value: [signal][bit position][width][entry count]
+#define PARAM_OP_MAP_WRITE	0x05		//index: [map][entry], value: [signal][bit position][width]
+#define PARAM_OP_MAP_APPLY	0x06		//index: [map][0], value: [entry count], 0 restores the default
+
+#define PARAM_OK						0x00
+#define PARAM_INVALID_INDEX	0x01
+#define PARAM_OUT_OF_RANGE	0x02
+#define PARAM_INVALID_OP		0x03
+#define PARAM_FLASH_ERROR		0x04
+
+/**
+  * @brief  Configuration Parameter Table
+	* @note		One row per parameter: X(name, type, min, max, default), it generates
+	*					PARAM_name (index) and the range table of CANParamlib.
+	*					Type: U8, U16, U32 or FLOAT. Row order is the index, only append
+	*					rows so parameters saved in flash keep their index.
+	*					Defaults may use values of the sensor library, the table is only
+	*					expanded in CANParamlib.c.
+	*
+	*					WHEEL_DIAM: 	Encoder wheel diameter in mm
+	*					ENC_RES: 			Encoder resolution in pulse per revolution
+	*					IMU_PHASE: 		IMU stream release offset in us, used from the next start
+	*					ENC_PHASE: 		Encoder stream release offset in us, used from the next start
+	*					TP_BLOCK: 		Segmented transfer block size asked to master
+	*					TP_STMIN: 		Segmented transfer STmin asked to master
+	*					AUTO_START: 	Restore committed streams and encoder position at boot (1)
+  */
+#define CAN_PARAM_TABLE(X) \
+	X(WHEEL_DIAM,		FLOAT,	1.0f,		1000.0f,	WHEEL_DIAMETER)				\
+	X(ENC_RES,			U16,		1,			10000,		ENCODER_RESOLUTION)		\
+	X(IMU_PHASE,		U32,		0,			100000,		250)									\
+	X(ENC_PHASE,		U32,		0,			100000,		0)										\
+	X(TP_BLOCK,			U8,			0,			255,			TRANSFER_BLOCK_SIZE)	\
+	X(TP_STMIN,			U8,			0,			0xF9,			TRANSFER_STMIN)				\
+	X(AUTO_START,		U8,			0,			1,				0)
+
+#define CAN_PARAM_INDEX(name, type, min, max, def)		PARAM_##name,
+
+typedef enum
+{
+	CAN_PARAM_TABLE(CAN_PARAM_INDEX)
+	PARAM_NUM
+}CAN_Param_TypeDef;
+
+/**
+  * @brief  Configuration Signal Table
+	* @note		One row per signal: X(name, width), it generates SIGNAL_name.
+	*					Width is the raw signal width in bit, a mapping may take its low bits.
+	*					Signed signal is two's complement, master sign-extends a narrow field.
+	*
+	*					ENC_X, ENC_Y: 	Encoder position, IEEE 754 float bits (mm)
+	*					IMU_x: 					IMU angle raw value, angle = raw * 180 / 32768 (deg)
+	*					TIMESTAMP: 			Master time when the frame is packed (us)
+	*					STATUS: 				MAP_STATUS_x bits
+	*					SEQ: 						Rolling sequence of the stream, +1 for every frame handed
+	*													to the bus, a gap is a frame lost on the slave side.
+	*													A remote frame answered twice before new data repeats it.
+  */
+#define CAN_SIGNAL_TABLE(X) \
+	X(ENC_X,				32)	\
+	X(ENC_Y,				32)	\
+	X(IMU_ROLL,			16)	\
+	X(IMU_PITCH,		16)	\
+	X(IMU_YAW,			16)	\
+	X(TIMESTAMP,		32)	\
+	X(STATUS,				8)	\
+	X(SEQ,					8)
+
+#define CAN_SIGNAL_INDEX(name, width)		SIGNAL_##name,
+
+typedef enum
+{
+	CAN_SIGNAL_TABLE(CAN_SIGNAL_INDEX)
+	SIGNAL_NUM
+}CAN_Signal_TypeDef;
+
+/**
+  * @brief  Configuration Signal Mapping
+	* @note		One mapping per data stream, the map index is the sensor ID.
+	*					Entries are packed LSB first from bit 0 of the data field,
+	*					DLC is the last mapped byte. Entries must not overlap.
+	*					Default mapping gives the former fixed layouts:
+	*					IMU_DATA: [IMU_ROLL (16)][IMU_PITCH (16)][IMU_YAW (16)]
+	*					ENC_DATA: [ENC_X (32)][ENC_Y (32)]
+  */
+#define MAP_NUM							SENSOR_NUM
+#define MAP_ENTRY_MAX				8
+#define MAP_BIT_MAX					64
+
+#define MAP_STATUS_IMU_RUN		0x01
+#define MAP_STATUS_ENC_RUN		0x02
+#define MAP_STATUS_SYNC_VALID	0x04
+#define MAP_STATUS_LEVEL_POS	3				//Bus rate level, 2 bit
+#define MAP_STATUS_PASSIVE		0x20		//Bus error passive
+
+/**
+  * @brief  Configuration Segmented Transfer
+	* @note		STmin coding: 0x00-0x7F in ms, 0xF1-0xF9 in 100 us steps
+  */
+#define TRANSFER_BLOCK_SIZE				8				//Consecutive frames between flow control, 0 is no limit
+#define TRANSFER_STMIN						0x00
+#define TRANSFER_TIMEOUT_US				1000000	//Wait for flow control or consecutive frame
+#define TRANSFER_MAILBOX_RESERVE	1				//Mailboxes always left for sensor streams
+#define TRANSFER_BUFFER_SIZE			256			//Slave receive buffer
+
+/**
+  * @brief  Configuration Bit Rate Switching
+	* @note		BITRATE_FB is sent with the old bit rate, the new one is used
+	*					when every mailbox is empty or after BITRATE_SWITCH_US
+  */
+#define BITRATE_OK					0x00
+#define BITRATE_INVALID			0x01		//Out of range or not reachable with APB1 clock
+#define BITRATE_MIN					125000
+#define BITRATE_MAX					1000000
+#define BITRATE_SWITCH_US		10000
 
 /**
-  * @brief  Configuration Sensor Data Address/ID
+  * @brief  Configuration Bit Rate Detection
+	* @note		Saved bit rate is tried first, then BITRATE_DETECT_LIST.
+	*					Nothing received before BITRATE_DETECT_TIMEOUT_MS (quiet bus or
+	*					first node) falls back to the saved bit rate.
   */
-#define IMU_DATA				0x0A
-#define ENC_DATA				0x0A
+#define BITRATE_AUTO_DETECT					1
+#define BITRATE_DETECT_LIST					{1000000, 500000, 250000, 125000}
+#define BITRATE_DETECT_DWELL_MS			100
+#define BITRATE_DETECT_TIMEOUT_MS		1000
 
 /**
-  * @brief  Configuration Sensor Data DLC
+  * @brief  Configuration Stream Mode
+	* @note		STREAM_MODE_FREE: transmit data every period
+	*					STREAM_MODE_SYNC: latch and transmit data when receiving SYNC
+	*					STREAM_MODE_POLL: transmit data only as answer of a remote frame
+	*					A started sensor answers remote frame (RTR) of its data ID in any mode
   */
-#define IMU_DATA_DLC 		0x06
-#define ENC_DATA_DLC		0x08
+#define STREAM_MODE_FREE	0x00
+#define STREAM_MODE_SYNC	0x01
+#define STREAM_MODE_POLL	0x02
+#define STREAM_MODE_MASK	0x0F
+#define STREAM_PERIOD_US	0x80		//Period is in microsecond instead of millisecond
 
 /**
-  * @brief  Configuration Command ID for Master
+  * @brief  Configuration Diagnostics Page
+	* @note		DIAG_PAGE_STREAM index: sensor ID
+	*					data: [min period][max period][avg period] (us, LSB first)
   */
-#define START_ID				0x00
-#define RESET_ID				0x01
-#define	STOP_ID					0x02
-#define ENC_ASSIGN_ID 	0x03
+#define DIAG_PAGE_STREAM	0x01
+#define DIAG_PAGE_STALE		0x02		//index: sensor ID, data: [aborted frame (32 bit)][missed release (16 bit)]
+#define DIAG_PAGE_RATE		0x03		//index: sensor ID, data: [effective period us (32 bit)][rate level][TEC]
+#define DIAG_PAGE_BUS			0x04		//index: 0, data: [TEC][REC][mailbox full (16 bit)][arbitration lost (16 bit)]
+#define DIAG_PAGE_RECOVERY	0x05		//index: 0, data: [bus off count][last recovery us][max recovery us] (16 bit each)
+#define DIAG_PAGE_BITRATE	0x06		//index: 0, data: [kbit/s (16 bit)][detection ms (16 bit)][detected (1) or fallback (0)]
+#define DIAG_PAGE_BOOT		0x07		//index: 0, data: [first data ms after reset (32 bit)][auto started][flash records]
+#define DIAG_PAGE_LOSS		0x08		//index: [counter << 4 | sensor ID], data: [counter (32 bit)][next seq][pending mailboxes]
+#define DIAG_PAGE_LOAD		0x09		//index: 0, data: [last window][sliding][peak] (bus load per mille, 16 bit each)
+																	//index: 1, data: [received frames (32 bit)][untracked frames (16 bit)]
+																	//index: 2, data: [transmitted frames (32 bit)][tracked IDs][0]
+#define DIAG_PAGE_TRAFFIC	0x0A		//index: [field << 5 | slot], slot in order of first frame, see CANBusStat
+																	//field 0, data: [ID (32 bit, bit 31 extended)][direction][0]
+																	//field 1, data: [frames (32 bit)][bytes (16 bit)]
+																	//field 2, data: [min][max][avg] inter-arrival time (us, 16 bit each)
+#define DIAG_PAGE_LATENCY	0x0B		//index: [command << 4 | stage << 2 | part], command is CAN_FRAME_x, stage LATENCY_STAGE_x
+																	//data: [bucket 3 x part][next][next] (samples, 16 bit each), see CANLatency
+#define DIAG_PAGE_LATENCY_MAX	0x0C	//index: [command << 4 | stage << 2], data: [max latency us (32 bit)][samples (16 bit)]
+																	//index: 0xFF, data: [lost commands (32 bit)][bucket shift][core clock MHz]
+#define DIAG_PAGE_PROFILE	0x0D		//index: [field << 4 | task], task as numbered in main.c, 0x0F is the loop period
+																	//field 0, data: [calls (32 bit)][min us (16 bit)]
+																	//field 1, data: [max us (32 bit)][avg us (16 bit)]
+																	//field 2, data: [avg cycles (24 bit)][min cycles (24 bit)]
+																	//field 3, loop only, data: [max jitter us (32 bit)][avg jitter us (16 bit)]
+#define DIAG_PAGE_IRQ			0x0E		//index: [field << 4 | irq], irq as numbered in stm32f1xx_it.c, 0x0F is every interrupt
+																	//field 0, data: [entries (32 bit)][max nesting]
+																	//field 1, data: [cumulative us (32 bit)][max us (16 bit)]
+																	//field 2, data: [max cycles (32 bit)][max us with nested (16 bit)]
+																	//field 3, all only, data: [last window][peak] (interrupt CPU load per mille, 16 bit each)
+#define DIAG_PAGE_TASK		0x0F		//index: [field << 4 | task], task as numbered in main.c
+																	//field 0, data: [runs (32 bit)][deadline missed (16 bit)]
+																	//field 1, data: [max response us (32 bit)][overrun (16 bit)]
+																	//field 2, data: [deadline us (32 bit)][priority][period ms]
 
 /**
-  * @brief  Configuration Command DLC for Master
+  * @brief  Stream loss counter, high nibble of DIAG_PAGE_LOSS index
+	* @note		PRODUCED = QUEUED + DROPPED, QUEUED = TRANSMITTED + ABORTED + pending.
   */
-#define START_DLC				0x02
-#define RESET_DLC 			0x00
-#define	STOP_DLC				0x00
-#define ENC_ASSIGN_DLC	0x08
+#define STREAM_STAT_PRODUCED		0x00
+#define STREAM_STAT_QUEUED			0x01
+#define STREAM_STAT_TRANSMITTED	0x02
+#define STREAM_STAT_ABORTED			0x03
+#define STREAM_STAT_DROPPED			0x04
 
 /**
-  * @brief  Configuration Feedback ID for Slave
+  * @brief  Configuration Node ID Status
   */
-#define START_FB_ID 		0x00
-#define RESET_FB_ID			0x01
-#define STOP_FB_ID			0x02
-#define ASSIGN_FB_ID		0x03
+#define NODE_OK					0x00
+#define NODE_INVALID		0x01
 
 /**
-  * @brief  Configuration Feedback DLC for Slave
+  * @brief  Configuration Node Boot-up Status
+	* @note		MGMT_CLAIM data: [UID hash (32 bit LSB first)], node field is the claimed node
+	*					MGMT_BOOTUP data: [UID hash (32 bit LSB first)][NODE_BOOT_x]
   */
-#define START_FB_DLC		0x02
-#define RESET_FB_DLC		0x00
-#define	STOP_FB_DLC			0x00
-#define ASSIGN_FB_DLC		0x08
+#define NODE_BOOT_STORED		0x00		//Node ID kept from flash
+#define NODE_BOOT_CLAIMED		0x01		//Node ID newly claimed
+#define NODE_BOOT_CONFLICT	0x02		//Every node ID busy, running with the configured one
 
 /**
-  * @brief  Configuration Error ID for Slave
+  * @brief  Configuration Node ID Claim
+	* @note		A slave without a valid node ID in flash starts from UID hash % NODE_NUM.
+	*					The claim of a node is given up when its owner answers with BOOTUP or
+	*					a slave with lower UID hash claims it too, the next node ID is tried.
+	*					Every claim waits a backoff up to NODE_CLAIM_BACKOFF_US seeded by UID hash,
+	*					claims of one node have the same StdId and only split by start time.
+	*					The owner of a node answers every claim of it with BOOTUP.
   */
-#define ERROR_ID				0x0B
-#define ERROR_DLC				0x00
+#define NODE_AUTO_CLAIM					1
+#define NODE_CLAIM_WAIT_MS			50
+#define NODE_CLAIM_BACKOFF_US		32000
 
 
 #endif
@@ -0,0 +1,289 @@
+/**
+  ******************************************************************************
+  * @file    	CANLatency.c
+  * @author  	Nguyen Vu
+	*	@version 	1.0.0
+  * @brief   	This file provides function to measure the latency of every
+	*						command from its Rx interrupt to its feedback on the bus
+  *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "CANLatency.h"
+
+#if LATENCY_ENABLE
+
+static CAN_Latency_HistTypeDef			Latency_Hist[LATENCY_CMD_NUM][LATENCY_STAGE_NUM];
+static CAN_Latency_PendingTypeDef		Latency_Pending[LATENCY_PENDING_NUM];
+static CAN_Latency_PendingTypeDef		*Latency_Current;
+static uint32_t											Latency_Lost;
+
+/** @brief    Latency basic function
+  ==============================================================================
+										##### Latency Basic Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Initialize the cycle counter and the Tx complete interrupt.
+    (+) Adding a sample to a histogram.
+	[..]
+		A command is stamped in its Rx interrupt, at dispatch, when its feedback
+		is loaded in a mailbox and when the feedback is transmitted. The feedback
+		is matched by StdId, so a feedback retransmitted from the Tx queue later
+		is still matched to its command.
+  */
+
+/**
+  * @brief  Initializes the latency measure
+	* @note		Call after HAL_CAN_Start, place CAN_Latency_Tx in CAN_Transmit_Handle,
+	*					CAN_Latency_Tx_Complete and CAN_Latency_Tx_Abort in the Tx mailbox
+	*					complete and abort callbacks
+	* @param 	hcan      Pointer to the CAN_HandleTypeDef structure.
+  */
+void CAN_Latency_Init(CAN_HandleTypeDef *hcan)
+{
+	Timebase_Cycle_Init();
+	CAN_Latency_Reset();
+	HAL_CAN_ActivateNotification(hcan, CAN_IT_TX_MAILBOX_EMPTY);
+}
+
+/**
+  * @brief  Resetting every histogram
+  */
+void CAN_Latency_Reset(void)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	for (uint8_t cmd = 0; cmd < LATENCY_CMD_NUM; cmd++)
+		for (uint8_t stage = 0; stage < LATENCY_STAGE_NUM; stage++)
+			Latency_Hist[cmd][stage] = (CAN_Latency_HistTypeDef){0};
+	for (uint8_t i = 0; i < LATENCY_PENDING_NUM; i++)
+		Latency_Pending[i].state = LATENCY_FREE;
+	Latency_Current = NULL;
+	Latency_Lost = 0;
+	__set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Getting the histogram index of a command
+	* @param 	cmd      	Command (CAN_FRAME_x).
+	* @return	Command index (LATENCY_CMD_x), LATENCY_CMD_NUM if not measured
+  */
+#define LATENCY_CMD_CASE(name)		case CAN_FRAME_##name: return LATENCY_CMD_##name;
+
+static uint8_t CAN_Latency_Cmd_Index(uint8_t cmd)
+{
+	switch (cmd)
+	{
+		LATENCY_CMD_TABLE(LATENCY_CMD_CASE)
+		default: return LATENCY_CMD_NUM;
+	}
+}
+
+/**
+  * @brief  Adding a sample
+	* @note		Call with interrupt locked
+	* @param 	cmd      	Command index (LATENCY_CMD_x).
+	* @param 	stage     Stage (LATENCY_STAGE_x).
+	* @param 	cycle     Latency in cycle.
+  */
+static void CAN_Latency_Add(uint8_t cmd, uint8_t stage, uint32_t cycle)
+{
+	CAN_Latency_HistTypeDef *hist = &Latency_Hist[cmd][stage];
+	uint8_t bucket = 0;
+
+	//Bucket is the bit length above the shift
+	for (uint32_t edge = cycle >> LATENCY_BUCKET_SHIFT; edge && bucket < LATENCY_BUCKET_NUM - 1; edge >>= 1)
+		bucket++;
+
+	if (hist->bucket[bucket] < 0xFFFF)
+		hist->bucket[bucket]++;
+	hist->count++;
+	if (cycle > hist->max)
+		hist->max = cycle;
+}
+
+/** @brief    Latency measuring function
+  ==============================================================================
+										##### Latency Measuring Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Stamping a command at dispatch.
+    (+) Closing the dispatch of a command without feedback.
+    (+) Stamping its feedback at mailbox load.
+    (+) Stamping its feedback at transmit complete.
+  */
+
+/**
+  * @brief  Stamping a command at dispatch
+	* @note		Call in while loop before the command is handled.
+	*					A waiting command older than LATENCY_TIMEOUT_MS is counted as lost.
+	* @param 	cmd      		Command (CAN_FRAME_x).
+	* @param 	ack_id      StdId of its feedback, LATENCY_NO_ACK if it has none.
+	* @param 	rx_cycle    Cycle counter in the Rx interrupt.
+  */
+void CAN_Latency_Dispatch(uint8_t cmd, uint32_t ack_id, uint32_t rx_cycle)
+{
+	uint32_t now = Timebase_Get_Cycle();
+	uint32_t timeout = LATENCY_TIMEOUT_MS * (SystemCoreClock / 1000);
+	CAN_Latency_PendingTypeDef *slot = NULL;
+
+	cmd = CAN_Latency_Cmd_Index(cmd);
+	if (cmd >= LATENCY_CMD_NUM)
+		return;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	CAN_Latency_Add(cmd, LATENCY_STAGE_QUEUE, now - rx_cycle);
+
+	for (uint8_t i = 0; i < LATENCY_PENDING_NUM; i++)
+	{
+		CAN_Latency_PendingTypeDef *pending = &Latency_Pending[i];
+		if (pending->state != LATENCY_FREE && now - pending->dispatch_cycle > timeout)
+		{
+			pending->state = LATENCY_FREE;
+			Latency_Lost++;
+		}
+		if (pending->state == LATENCY_FREE && slot == NULL)
+			slot = pending;
+	}
+
+	if (ack_id != LATENCY_NO_ACK)
+	{
+		if (slot == NULL)
+			Latency_Lost++;
+		else
+		{
+			slot->state = LATENCY_WAIT_LOAD;
+			slot->cmd = cmd;
+			slot->ack_id = ack_id;
+			slot->rx_cycle = rx_cycle;
+			slot->dispatch_cycle = now;
+		}
+	}
+	Latency_Current = (ack_id != LATENCY_NO_ACK) ? slot : NULL;
+	__set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Closing the dispatch of a command
+	* @note		Call in while loop after the command is handled. Reset, stop and
+	*					assign only answer a started sensor, a diagnostics request of an
+	*					unknown page is ignored, such command is not waited for.
+	* @param 	queued      Feedback was put in the Tx queue for retransmission (1) or not (0).
+  */
+void CAN_Latency_Dispatch_End(uint8_t queued)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if (Latency_Current != NULL && Latency_Current->state == LATENCY_WAIT_LOAD && !queued)
+		Latency_Current->state = LATENCY_FREE;
+	Latency_Current = NULL;
+	__set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Stamping a feedback loaded in a mailbox
+	* @note		Place this function in CAN_Transmit_Handle (interrupt locked).
+	*					The oldest command waiting for this StdId takes it.
+	* @param 	TxHeader    Pointer to the CAN_TxHeaderTypeDef structure.
+	* @param 	Mailbox     Mailbox loaded (CAN_TX_MAILBOXx).
+  */
+void CAN_Latency_Tx(CAN_TxHeaderTypeDef *TxHeader, uint32_t Mailbox)
+{
+	uint32_t now = Timebase_Get_Cycle();
+	CAN_Latency_PendingTypeDef *oldest = NULL;
+
+	if (TxHeader->IDE != CAN_ID_STD)
+		return;
+
+	for (uint8_t i = 0; i < LATENCY_PENDING_NUM; i++)
+	{
+		CAN_Latency_PendingTypeDef *pending = &Latency_Pending[i];
+		if (pending->state != LATENCY_WAIT_LOAD || pending->ack_id != TxHeader->StdId)
+			continue;
+		if (oldest == NULL || now - pending->dispatch_cycle > now - oldest->dispatch_cycle)
+			oldest = pending;
+	}
+
+	if (oldest == NULL)
+		return;
+	CAN_Latency_Add(oldest->cmd, LATENCY_STAGE_HANDLE, now - oldest->dispatch_cycle);
+	oldest->state = LATENCY_WAIT_TX;
+	oldest->mailbox = Mailbox;
+	oldest->load_cycle = now;
+}
+
+/**
+  * @brief  Stamping a transmitted feedback
+	* @note		Place this function in HAL_CAN_TxMailboxxCompleteCallback
+	* @param 	Mailbox     Mailbox transmitted (CAN_TX_MAILBOXx).
+  */
+void CAN_Latency_Tx_Complete(uint32_t Mailbox)
+{
+	uint32_t now = Timebase_Get_Cycle();
+
+	for (uint8_t i = 0; i < LATENCY_PENDING_NUM; i++)
+	{
+		CAN_Latency_PendingTypeDef *pending = &Latency_Pending[i];
+		if (pending->state != LATENCY_WAIT_TX || pending->mailbox != Mailbox)
+			continue;
+
+		CAN_Latency_Add(pending->cmd, LATENCY_STAGE_BUS, now - pending->load_cycle);
+		CAN_Latency_Add(pending->cmd, LATENCY_STAGE_TOTAL, now - pending->rx_cycle);
+		pending->state = LATENCY_FREE;
+	}
+}
+
+/**
+  * @brief  Dropping an aborted feedback
+	* @note		Place this function in HAL_CAN_TxMailboxxAbortCallback
+	* @param 	Mailbox     Mailbox aborted (CAN_TX_MAILBOXx).
+  */
+void CAN_Latency_Tx_Abort(uint32_t Mailbox)
+{
+	for (uint8_t i = 0; i < LATENCY_PENDING_NUM; i++)
+	{
+		CAN_Latency_PendingTypeDef *pending = &Latency_Pending[i];
+		if (pending->state != LATENCY_WAIT_TX || pending->mailbox != Mailbox)
+			continue;
+
+		pending->state = LATENCY_FREE;
+		Latency_Lost++;
+	}
+}
+
+/** @brief    Latency reading function
+  ==============================================================================
+										##### Latency Reading Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Getting a histogram.
+    (+) Getting the lost command count.
+  */
+
+/**
+  * @brief 	Getting a histogram
+	* @param 	cmd      	Command (CAN_FRAME_x).
+	* @param 	stage     Stage (LATENCY_STAGE_x).
+	* @return	Pointer to the histogram, NULL if cmd is not measured or stage is out of range
+  */
+CAN_Latency_HistTypeDef *CAN_Latency_Get_Hist(uint8_t cmd, uint8_t stage)
+{
+	cmd = CAN_Latency_Cmd_Index(cmd);
+	if (cmd >= LATENCY_CMD_NUM || stage >= LATENCY_STAGE_NUM)
+		return NULL;
+	return &Latency_Hist[cmd][stage];
+}
+
+/**
+  * @brief 	Getting the lost command count
+	* @return	Commands whose feedback was not matched, timed out or aborted
+  */
+uint32_t CAN_Latency_Get_Lost(void)
+{
+	return Latency_Lost;
+}
+
+#endif
@@ -0,0 +1,140 @@
+/**
+  ******************************************************************************
+  * @file    	CANLatency.h
+  * @author  	Nguyen Vu
+  * @brief   	This file contains all the functions prototypes
+	*						for the command to feedback latency histogram
+  *****************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef CANLATENCY_H_
+#define CANLATENCY_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "bxCANlib.h"
+#include "CANConfig.h"
+#include "Timebase.h"
+
+/**
+  * @brief  Configuration Value
+	* @note		LATENCY_ENABLE 0 removes the measure, every function becomes empty.
+	*					With LATENCY_ENABLE, the Tx mailbox empty interrupt is activated
+	*					and costs one interrupt per transmitted frame.
+	*					Bucket b counts latency below 2^(b + LATENCY_BUCKET_SHIFT) cycles,
+	*					the last bucket counts everything above.
+	*					A feedback not loaded within LATENCY_TIMEOUT_MS is counted as lost.
+  */
+#define LATENCY_ENABLE				1
+#define LATENCY_BUCKET_NUM		12
+#define LATENCY_BUCKET_SHIFT	8				//3.6 us at 72 MHz, last bucket from 3.6 ms
+#define LATENCY_PENDING_NUM		4				//Commands waiting for their feedback
+#define LATENCY_TIMEOUT_MS		1000
+#define LATENCY_NO_ACK				0xFFFFFFFFU	//Command without feedback
+
+/**
+  * @brief  Measured commands, one histogram per stage each
+	* @note		Listed by name so the bound does not depend on the order of
+	*					CAN_FRAME_TABLE. Other frames are not measured.
+  */
+#define LATENCY_CMD_TABLE(X) \
+	X(STOP)				\
+	X(SYNC)				\
+	X(START)			\
+	X(RESET)			\
+	X(PARAM)			\
+	X(BATCH)			\
+	X(ENC_ASSIGN)	\
+	X(DIAG_RQ)		\
+	X(BITRATE)		\
+	X(NODE_SET)
+
+#define LATENCY_CMD_INDEX(name)		LATENCY_CMD_##name,
+
+enum
+{
+	LATENCY_CMD_TABLE(LATENCY_CMD_INDEX)
+	LATENCY_CMD_NUM
+};
+
+/**
+  * @brief  Latency stage
+	* @note		QUEUE: 	Rx interrupt to dispatch in while loop
+	*					HANDLE: Dispatch to feedback loaded in a mailbox
+	*					BUS: 		Mailbox loaded to transmit complete
+	*					TOTAL: 	Rx interrupt to transmit complete, command to feedback
+  */
+#define LATENCY_STAGE_QUEUE		0x00
+#define LATENCY_STAGE_HANDLE	0x01
+#define LATENCY_STAGE_BUS			0x02
+#define LATENCY_STAGE_TOTAL		0x03
+#define LATENCY_STAGE_NUM			0x04
+
+/**
+  * @brief  Histogram struct
+	* @param	bucket		Sample count of each bucket, saturated
+	* @param	count			Sample count
+	* @param	max				Highest latency in cycle
+  */
+typedef struct
+{
+	uint16_t	bucket[LATENCY_BUCKET_NUM];
+	uint32_t	count;
+	uint32_t	max;
+}CAN_Latency_HistTypeDef;
+
+/**
+  * @brief  Command waiting for its feedback
+	* @param	state					LATENCY_FREE, LATENCY_WAIT_LOAD or LATENCY_WAIT_TX
+	* @param	cmd						Command index (LATENCY_CMD_x)
+	* @param	ack_id				StdId of the feedback
+	* @param	mailbox				Mailbox holding the feedback
+	* @param	xxx_cycle			Time of each stage
+  */
+typedef struct
+{
+	uint8_t		state;
+	uint8_t		cmd;
+	uint32_t	ack_id;
+	uint32_t	mailbox;
+	uint32_t	rx_cycle;
+	uint32_t	dispatch_cycle;
+	uint32_t	load_cycle;
+}CAN_Latency_PendingTypeDef;
+
+#define LATENCY_FREE					0
+#define LATENCY_WAIT_LOAD			1
+#define LATENCY_WAIT_TX				2
+
+#if LATENCY_ENABLE
+
+/* Initialization functions  **************************************************/
+void CAN_Latency_Init(CAN_HandleTypeDef *hcan);
+void CAN_Latency_Reset(void);
+
+/* Measuring functions  *******************************************************/
+void CAN_Latency_Dispatch(uint8_t cmd, uint32_t ack_id, uint32_t rx_cycle);
+void CAN_Latency_Dispatch_End(uint8_t queued);
+void CAN_Latency_Tx(CAN_TxHeaderTypeDef *TxHeader, uint32_t Mailbox);
+void CAN_Latency_Tx_Complete(uint32_t Mailbox);
+void CAN_Latency_Tx_Abort(uint32_t Mailbox);
+
+/* Reading functions  *********************************************************/
+CAN_Latency_HistTypeDef *CAN_Latency_Get_Hist(uint8_t cmd, uint8_t stage);
+uint32_t CAN_Latency_Get_Lost(void);
+
+#define CAN_Latency_Now()									Timebase_Get_Cycle()
+
+#else
+
+#define CAN_Latency_Init(hcan)
+#define CAN_Latency_Reset()
+#define CAN_Latency_Dispatch(cmd, ack_id, rx_cycle)
+#define CAN_Latency_Dispatch_End(queued)					(void)(queued)
+#define CAN_Latency_Tx(TxHeader, Mailbox)
+#define CAN_Latency_Tx_Complete(Mailbox)
+#define CAN_Latency_Tx_Abort(Mailbox)
+#define CAN_Latency_Now()									0
+
+#endif
+
+#endif
@@ -0,0 +1,295 @@
+/**
+  ******************************************************************************
+  * @file    	CANMaplib.c
+  * @author  	Nguyen Vu
+	*	@version 	1.0.0
+  * @brief   	This file provides function to pack signals in data frames
+	*						following a mapping set by master (PDO style)
+  *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "CANMaplib.h"
+#include "string.h"
+
+static const uint8_t Signal_Width[SIGNAL_NUM] = {CAN_SIGNAL_TABLE(CAN_SIGNAL_WIDTH)};
+static volatile uint32_t Map_Signal[SIGNAL_NUM];
+static CAN_Map_HandleTypeDef Map[MAP_NUM];
+
+//Former fixed layouts, sequence where the frame has room
+static const CAN_Map_EntryTypeDef Map_Default_Entry[MAP_NUM][MAP_ENTRY_MAX] =
+{
+	[IMU_ID] = {{SIGNAL_IMU_ROLL, 0, 16}, {SIGNAL_IMU_PITCH, 16, 16}, {SIGNAL_IMU_YAW, 32, 16}, {SIGNAL_SEQ, 48, 8}},
+	[ENC_ID] = {{SIGNAL_ENC_X, 0, 32}, {SIGNAL_ENC_Y, 32, 32}},
+};
+static const uint8_t Map_Default_Num[MAP_NUM] = {[IMU_ID] = 4, [ENC_ID] = 2};
+
+/** @brief    Mapping initialization function
+  ==============================================================================
+									##### Mapping Initialization Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Restoring the default mapping of a data stream.
+    (+) Loading mappings saved in flash configuration.
+    (+) Storing mappings to flash configuration.
+  */
+
+/**
+  * @brief  Restoring the default mapping
+	* @param 	map     Map index (sensor ID).
+  */
+void CAN_Map_Default(uint8_t map)
+{
+	if (map >= MAP_NUM)
+		return;
+	
+	for (uint8_t i = 0; i < MAP_ENTRY_MAX; i++)
+		Map[map].stage[i] = Map_Default_Entry[map][i];
+	CAN_Map_Apply(map, Map_Default_Num[map]);
+}
+
+/**
+  * @brief  Loading mappings from flash configuration
+	* @note		A mapping not saved or not valid keeps the default
+	* @param 	config      Pointer to the Flash_Config_TypeDef structure.
+  */
+void CAN_Map_Load(const Flash_Config_TypeDef *config)
+{
+	for (uint8_t map = 0; map < MAP_NUM; map++)
+	{
+		CAN_Map_Default(map);
+		if (map >= FLASH_CONFIG_MAP_NUM || !config->map_num[map] ||
+				config->map_num[map] > MAP_ENTRY_MAX || config->map_num[map] > FLASH_CONFIG_MAP_ENTRY)
+			continue;
+		
+		uint8_t status = PARAM_OK;
+		for (uint8_t i = 0; i < config->map_num[map] && status == PARAM_OK; i++)
+		{
+			uint32_t raw = config->map[map][i];
+			status = CAN_Map_Write(map, i, raw & 0xFF, (raw >> 8) & 0xFF, (raw >> 16) & 0xFF);
+		}
+		if (status != PARAM_OK || CAN_Map_Apply(map, config->map_num[map]) != PARAM_OK)
+			CAN_Map_Default(map);
+	}
+}
+
+/**
+  * @brief  Storing mappings to flash configuration
+	* @note		Call Flash_Config_Save after this function
+	* @param 	config      Pointer to the Flash_Config_TypeDef structure.
+  */
+void CAN_Map_Store(Flash_Config_TypeDef *config)
+{
+	for (uint8_t map = 0; map < FLASH_CONFIG_MAP_NUM; map++)
+	{
+		config->map_num[map] = 0;
+		for (uint8_t i = 0; i < FLASH_CONFIG_MAP_ENTRY; i++)
+		{
+			config->map[map][i] = 0;
+			if (map >= MAP_NUM || i >= Map[map].num)
+				continue;
+			
+			CAN_Map_EntryTypeDef *Entry = &Map[map].entry[i];
+			config->map[map][i] = (uint32_t)Entry->signal | ((uint32_t)Entry->pos << 8) | ((uint32_t)Entry->width << 16);
+			config->map_num[map]++;
+		}
+	}
+}
+
+/** @brief    Mapping edit function
+  ==============================================================================
+										##### Mapping Edit Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Reading an entry of the mapping in use.
+    (+) Writing an entry of the staged mapping.
+    (+) Checking and compiling the staged mapping, then using it.
+	[..]
+		Entries are staged so a data frame is never packed with a half
+		written mapping, like disabling a PDO before changing its mapping.
+  */
+
+/**
+  * @brief  Reading an entry of the mapping in use
+	* @param 	map     Map index (sensor ID).
+	* @param 	entry   Entry index.
+	* @param 	Entry   Pointer to store the entry, zero if not used.
+	* @param 	num   	Pointer to store the number of entries in use.
+	* @return	PARAM_OK or PARAM_INVALID_INDEX
+  */
+uint8_t CAN_Map_Read(uint8_t map, uint8_t entry, CAN_Map_EntryTypeDef *Entry, uint8_t *num)
+{
+	static const CAN_Map_EntryTypeDef none = {0, 0, 0};
+	
+	if (map >= MAP_NUM || entry >= MAP_ENTRY_MAX)
+		return PARAM_INVALID_INDEX;
+	
+	*Entry = (entry < Map[map].num) ? Map[map].entry[entry] : none;
+	*num = Map[map].num;
+	return PARAM_OK;
+}
+
+/**
+  * @brief  Writing an entry of the staged mapping
+	* @param 	map     Map index (sensor ID).
+	* @param 	entry   Entry index.
+	* @param 	signal  Signal (SIGNAL_x).
+	* @param 	pos  		First bit in the data field.
+	* @param 	width  	Field width in bit.
+	* @return	PARAM_OK, PARAM_INVALID_INDEX or PARAM_OUT_OF_RANGE
+  */
+uint8_t CAN_Map_Write(uint8_t map, uint8_t entry, uint8_t signal, uint8_t pos, uint8_t width)
+{
+	if (map >= MAP_NUM || entry >= MAP_ENTRY_MAX)
+		return PARAM_INVALID_INDEX;
+	
+	if (signal >= SIGNAL_NUM || !width || width > Signal_Width[signal] || pos + width > MAP_BIT_MAX)
+		return PARAM_OUT_OF_RANGE;
+	
+	Map[map].stage[entry].signal = signal;
+	Map[map].stage[entry].pos = pos;
+	Map[map].stage[entry].width = width;
+	return PARAM_OK;
+}
+
+/**
+  * @brief  Checking and compiling the staged mapping, then using it
+	* @param 	map     Map index (sensor ID).
+	* @param 	num     Number of staged entries to use, 0 restores the default.
+	* @return	PARAM_OK, PARAM_INVALID_INDEX or PARAM_OUT_OF_RANGE (bad or overlapped entry)
+  */
+uint8_t CAN_Map_Apply(uint8_t map, uint8_t num)
+{
+	CAN_Map_OpTypeDef op[MAP_ENTRY_MAX];
+	uint64_t used = 0;
+	uint8_t dlc = 0;
+	
+	if (map >= MAP_NUM)
+		return PARAM_INVALID_INDEX;
+	if (num > MAP_ENTRY_MAX)
+		return PARAM_OUT_OF_RANGE;
+	if (!num)
+	{
+		CAN_Map_Default(map);
+		return PARAM_OK;
+	}
+	
+	//Check every entry and compute mask and shift once
+	for (uint8_t i = 0; i < num; i++)
+	{
+		CAN_Map_EntryTypeDef *Entry = &Map[map].stage[i];
+		if (Entry->signal >= SIGNAL_NUM || !Entry->width || Entry->width > Signal_Width[Entry->signal] ||
+				Entry->pos + Entry->width > MAP_BIT_MAX)
+			return PARAM_OUT_OF_RANGE;
+		
+		op[i].signal = Entry->signal;
+		op[i].shift = Entry->pos;
+		op[i].mask = (Entry->width >= 32) ? 0xFFFFFFFF : ((1UL << Entry->width) - 1);
+		
+		uint64_t field = (uint64_t)op[i].mask << op[i].shift;
+		if (used & field)
+			return PARAM_OUT_OF_RANGE;
+		used |= field;
+		
+		if ((Entry->pos + Entry->width + 7) / 8 > dlc)
+			dlc = (Entry->pos + Entry->width + 7) / 8;
+	}
+	
+	//Data frames may be packed in Rx interrupt (SYNC)
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	for (uint8_t i = 0; i < num; i++)
+	{
+		Map[map].entry[i] = Map[map].stage[i];
+		Map[map].op[i] = op[i];
+	}
+	Map[map].num = num;
+	Map[map].dlc = dlc;
+	__set_PRIMASK(primask);
+	return PARAM_OK;
+}
+
+/** @brief    Signal and packing function
+  ==============================================================================
+									##### Signal and Packing Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Updating a signal value.
+    (+) Packing the signals of a mapping in a data field.
+    (+) Rewriting one signal in a packed data field.
+  */
+
+/**
+  * @brief  Updating a signal value
+	* @param 	signal  Signal (SIGNAL_x).
+	* @param 	raw  		Raw value, signed value as two's complement.
+  */
+void CAN_Map_Set_Signal(CAN_Signal_TypeDef signal, uint32_t raw)
+{
+	Map_Signal[signal] = raw;
+}
+
+/**
+  * @brief  Updating a float signal value
+	* @param 	signal  Signal (SIGNAL_x).
+	* @param 	value  	Value, stored as IEEE 754 bits.
+  */
+void CAN_Map_Set_Float(CAN_Signal_TypeDef signal, float value)
+{
+	uint32_t raw;
+	memcpy(&raw, &value, sizeof(raw));
+	Map_Signal[signal] = raw;
+}
+
+/**
+  * @brief  Packing the signals of a mapping
+	* @param 	map     Map index (sensor ID).
+	* @param 	data    Data array to store, 8 bytes.
+	* @return	DLC of the mapping, 0 if map is invalid
+  */
+uint8_t CAN_Map_Pack(uint8_t map, uint8_t data[8])
+{
+	uint64_t field = 0;
+	
+	if (map >= MAP_NUM)
+		return 0;
+	
+	for (uint8_t i = 0; i < Map[map].num; i++)
+		field |= (uint64_t)(Map_Signal[Map[map].op[i].signal] & Map[map].op[i].mask) << Map[map].op[i].shift;
+	
+	//LSB first
+	for (uint8_t i = 0; i < 8; i++)
+		data[i] = (field >> (8 * i)) & 0xFF;
+	return Map[map].dlc;
+}
+
+/**
+  * @brief  Rewriting one signal in a data field packed by CAN_Map_Pack
+	* @note		Other signals are kept, nothing is written if the mapping does not have it.
+	* @param 	map     Map index (sensor ID).
+	* @param 	signal  Signal (SIGNAL_x).
+	* @param 	raw  		Raw value, signed value as two's complement.
+	* @param 	data    Packed data array, 8 bytes.
+  */
+void CAN_Map_Pack_Signal(uint8_t map, CAN_Signal_TypeDef signal, uint32_t raw, uint8_t data[8])
+{
+	uint64_t field = 0;
+	
+	if (map >= MAP_NUM)
+		return;
+	
+	for (uint8_t i = 0; i < 8; i++)
+		field |= (uint64_t)data[i] << (8 * i);
+	for (uint8_t i = 0; i < Map[map].num; i++)
+	{
+		CAN_Map_OpTypeDef *op = &Map[map].op[i];
+		if (op->signal != signal)
+			continue;
+		field &= ~((uint64_t)op->mask << op->shift);
+		field |= (uint64_t)(raw & op->mask) << op->shift;
+	}
+	for (uint8_t i = 0; i < 8; i++)
+		data[i] = (field >> (8 * i)) & 0xFF;
+}
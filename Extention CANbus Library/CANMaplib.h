@@ -0,0 +1,78 @@
+/**
+  ******************************************************************************
+  * @file    	CANMaplib.h
+  * @author  	Nguyen Vu
+  * @brief   	This file contains all the functions prototypes
+	*						for the signal mapping of data frames
+  *****************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef CANMAPLIB_H_
+#define CANMAPLIB_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f1xx_hal.h"
+#include "CANConfig.h"
+#include "FlashConfig.h"
+
+/**
+  * @brief  Mapping entry, one signal in a data frame
+	* @param	signal	Signal (SIGNAL_x)
+	* @param	pos			First bit in the data field, LSB first
+	* @param	width		Field width in bit, low bits of the signal
+  */
+typedef struct
+{
+	uint8_t	signal;
+	uint8_t	pos;
+	uint8_t	width;
+}CAN_Map_EntryTypeDef;
+
+/**
+  * @brief  Compiled mapping entry, packing is only mask, shift and or
+	* @param	signal	Signal (SIGNAL_x)
+	* @param	shift		First bit in the data field
+	* @param	mask		Mask of the field width
+  */
+typedef struct
+{
+	uint8_t		signal;
+	uint8_t		shift;
+	uint32_t	mask;
+}CAN_Map_OpTypeDef;
+
+/**
+  * @brief  Signal mapping struct
+	* @param	stage			Entries written by master, used after CAN_Map_Apply
+	* @param	entry			Entries in use
+	* @param	op				Compiled entries in use
+	* @param	dlc				Data length of the mapping in use
+  */
+typedef struct
+{
+	CAN_Map_EntryTypeDef	stage[MAP_ENTRY_MAX];
+	CAN_Map_EntryTypeDef	entry[MAP_ENTRY_MAX];
+	uint8_t								num;
+	CAN_Map_OpTypeDef			op[MAP_ENTRY_MAX];
+	uint8_t								dlc;
+}CAN_Map_HandleTypeDef;
+
+#define CAN_SIGNAL_WIDTH(name, width)		(width),
+
+/* Initialization and flash functions  ****************************************/
+void CAN_Map_Default(uint8_t map);
+void CAN_Map_Load(const Flash_Config_TypeDef *config);
+void CAN_Map_Store(Flash_Config_TypeDef *config);
+
+/* Mapping edit functions  ****************************************************/
+uint8_t CAN_Map_Read(uint8_t map, uint8_t entry, CAN_Map_EntryTypeDef *Entry, uint8_t *num);
+uint8_t CAN_Map_Write(uint8_t map, uint8_t entry, uint8_t signal, uint8_t pos, uint8_t width);
+uint8_t CAN_Map_Apply(uint8_t map, uint8_t num);
+
+/* Signal and packing functions  **********************************************/
+void CAN_Map_Set_Signal(CAN_Signal_TypeDef signal, uint32_t raw);
+void CAN_Map_Set_Float(CAN_Signal_TypeDef signal, float value);
+uint8_t CAN_Map_Pack(uint8_t map, uint8_t data[8]);
+void CAN_Map_Pack_Signal(uint8_t map, CAN_Signal_TypeDef signal, uint32_t raw, uint8_t data[8]);
+
+#endif
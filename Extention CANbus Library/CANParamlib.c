@@ -0,0 +1,149 @@
+/**
+  ******************************************************************************
+  * @file    	CANParamlib.c
+  * @author  	Nguyen Vu
+	*	@version 	1.0.0
+  * @brief   	This file provides function to read and write
+	*						runtime parameters by index, with range check
+  *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "CANParamlib.h"
+#include "EncoderPosition.h"
+
+static const CAN_Param_Info_TypeDef Param_Info[PARAM_NUM] = {CAN_PARAM_TABLE(CAN_PARAM_INFO)};
+static CAN_Param_ValueTypeDef				Param_Value[PARAM_NUM] = {CAN_PARAM_TABLE(CAN_PARAM_DEFAULT)};
+
+/** @brief    Parameter initialization function
+  ==============================================================================
+									##### Parameter Initialization Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Restoring every default value.
+    (+) Loading parameters saved in flash configuration.
+    (+) Storing parameters to flash configuration.
+	[..]
+		Values are only stored, applying them (encoder scale, stream phase...)
+		is done by the caller once after a change.
+  */
+
+/**
+  * @brief  Restoring every default value
+  */
+void CAN_Param_Default(void)
+{
+	for (uint8_t i = 0; i < PARAM_NUM; i++)
+		Param_Value[i] = Param_Info[i].def;
+}
+
+/**
+  * @brief  Loading parameters from flash configuration
+	* @note		A parameter not saved or out of range keeps its default
+	* @param 	config      Pointer to the Flash_Config_TypeDef structure.
+  */
+void CAN_Param_Load(const Flash_Config_TypeDef *config)
+{
+	CAN_Param_Default();
+	
+	for (uint8_t i = 0; i < PARAM_NUM && i < config->param_num && i < FLASH_CONFIG_PARAM_NUM; i++)
+		CAN_Param_Write(i, config->param[i]);
+}
+
+/**
+  * @brief  Storing parameters to flash configuration
+	* @note		Call Flash_Config_Save after this function
+	* @param 	config      Pointer to the Flash_Config_TypeDef structure.
+  */
+void CAN_Param_Store(Flash_Config_TypeDef *config)
+{
+	config->param_num = 0;
+	for (uint8_t i = 0; i < PARAM_NUM && i < FLASH_CONFIG_PARAM_NUM; i++)
+	{
+		config->param[i] = Param_Value[i].u;
+		config->param_num++;
+	}
+}
+
+/** @brief    Parameter access function
+  ==============================================================================
+										##### Parameter Access Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Reading a parameter by index.
+    (+) Writing a parameter by index with range check.
+    (+) Reading a parameter with its type.
+  */
+
+/**
+  * @brief  Reading a parameter by index
+	* @param 	index     Parameter index (PARAM_x).
+	* @param 	raw     	Pointer to store the raw value (float as IEEE 754 bits).
+	* @return	PARAM_OK or PARAM_INVALID_INDEX
+  */
+uint8_t CAN_Param_Read(uint8_t index, uint32_t *raw)
+{
+	if (index >= PARAM_NUM)
+		return PARAM_INVALID_INDEX;
+	
+	*raw = Param_Value[index].u;
+	return PARAM_OK;
+}
+
+/**
+  * @brief  Writing a parameter by index
+	* @param 	index     Parameter index (PARAM_x).
+	* @param 	raw     	Raw value (float as IEEE 754 bits).
+	* @return	PARAM_OK, PARAM_INVALID_INDEX or PARAM_OUT_OF_RANGE
+  */
+uint8_t CAN_Param_Write(uint8_t index, uint32_t raw)
+{
+	CAN_Param_ValueTypeDef value;
+	
+	if (index >= PARAM_NUM)
+		return PARAM_INVALID_INDEX;
+	
+	value.u = raw;
+	if (Param_Info[index].type == PARAM_TYPE_FLOAT)
+	{
+		//Written this way NaN is out of range too
+		if (!(value.f >= Param_Info[index].min.f && value.f <= Param_Info[index].max.f))
+			return PARAM_OUT_OF_RANGE;
+	}
+	else if (value.u < Param_Info[index].min.u || value.u > Param_Info[index].max.u)
+		return PARAM_OUT_OF_RANGE;
+	
+	Param_Value[index] = value;
+	return PARAM_OK;
+}
+
+/**
+  * @brief  Getting type of a parameter
+	* @param 	index     Parameter index (PARAM_x).
+	* @return	PARAM_TYPE_x, 0xFF if index is invalid
+  */
+uint8_t CAN_Param_Get_Type(uint8_t index)
+{
+	return (index < PARAM_NUM) ? Param_Info[index].type : 0xFF;
+}
+
+/**
+  * @brief  Reading an integer parameter
+	* @param 	param     Parameter (PARAM_x) of type U8, U16 or U32.
+	* @return	Value
+  */
+uint32_t CAN_Param_Get_U32(CAN_Param_TypeDef param)
+{
+	return Param_Value[param].u;
+}
+
+/**
+  * @brief  Reading a float parameter
+	* @param 	param     Parameter (PARAM_x) of type FLOAT.
+	* @return	Value
+  */
+float CAN_Param_Get_Float(CAN_Param_TypeDef param)
+{
+	return Param_Value[param].f;
+}
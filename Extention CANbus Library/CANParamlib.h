@@ -0,0 +1,73 @@
+/**
+  ******************************************************************************
+  * @file    	CANParamlib.h
+  * @author  	Nguyen Vu
+  * @brief   	This file contains all the functions prototypes
+	*						for the runtime parameter table
+  *****************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef CANPARAMLIB_H_
+#define CANPARAMLIB_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f1xx_hal.h"
+#include "CANConfig.h"
+#include "FlashConfig.h"
+
+/**
+  * @brief  Parameter type
+  */
+#define PARAM_TYPE_U8				0x00
+#define PARAM_TYPE_U16			0x01
+#define PARAM_TYPE_U32			0x02
+#define PARAM_TYPE_FLOAT		0x03
+
+/**
+  * @brief  Parameter value, u for integer types, f for FLOAT
+  */
+typedef union
+{
+	uint32_t	u;
+	float			f;
+}CAN_Param_ValueTypeDef;
+
+/**
+  * @brief  Parameter table row, generated from CAN_PARAM_TABLE
+	* @param	type	Type (PARAM_TYPE_x)
+	* @param	min		Lowest accepted value
+	* @param	max		Highest accepted value
+	* @param	def		Default value
+  */
+typedef struct
+{
+	uint8_t									type;
+	CAN_Param_ValueTypeDef	min;
+	CAN_Param_ValueTypeDef	max;
+	CAN_Param_ValueTypeDef	def;
+}CAN_Param_Info_TypeDef;
+
+#define PARAM_VALUE_U8(v)			{.u = (v)}
+#define PARAM_VALUE_U16(v)		{.u = (v)}
+#define PARAM_VALUE_U32(v)		{.u = (v)}
+#define PARAM_VALUE_FLOAT(v)	{.f = (v)}
+
+#define CAN_PARAM_INFO(name, type, min, max, def)	\
+	{PARAM_TYPE_##type, PARAM_VALUE_##type(min), PARAM_VALUE_##type(max), PARAM_VALUE_##type(def)},
+#define CAN_PARAM_DEFAULT(name, type, min, max, def)	PARAM_VALUE_##type(def),
+
+/* Initialization and flash functions  ****************************************/
+void CAN_Param_Default(void);
+void CAN_Param_Load(const Flash_Config_TypeDef *config);
+void CAN_Param_Store(Flash_Config_TypeDef *config);
+
+/* Access by index functions  *************************************************/
+uint8_t CAN_Param_Read(uint8_t index, uint32_t *raw);
+uint8_t CAN_Param_Write(uint8_t index, uint32_t raw);
+uint8_t CAN_Param_Get_Type(uint8_t index);
+
+/* Typed reading functions  ***************************************************/
+uint32_t CAN_Param_Get_U32(CAN_Param_TypeDef param);
+float CAN_Param_Get_Float(CAN_Param_TypeDef param);
+
+#endif
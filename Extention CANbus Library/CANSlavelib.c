@@ -17,6 +17,35 @@ static CAN_TxQueue 		Slave_TxQueue;
 static CAN_TxMessage 	Slave_TxMessage;
 static CAN_RxQueue		Slave_RxQueue;
 static CAN_RxMessage	Slave_RxMessage;
+static uint8_t				Slave_Tag;
+static uint8_t				Slave_Tag_Valid;
+static CAN_Start_RequestTypeDef	Slave_Start;
+static float									Slave_Assign[2];
+static uint8_t								Boot_Auto_Started;
+static volatile uint32_t			Boot_First_Data_ms;
+
+static const CAN_Frame_Info_TypeDef Slave_Frame[CAN_FRAME_NUM] = {CAN_FRAME_TABLE(CAN_FRAME_INFO)};
+
+static CAN_Sync_HandleTypeDef Slave_Sync;
+static Sensor_HandleTypedef		*Slave_Sensor[SENSOR_NUM];
+
+static uint8_t						Slave_Node;
+static CAN_FilterTypeDef	Slave_Filter;
+static CAN_Transfer_HandleTypeDef	Slave_Transfer;
+static uint8_t						Slave_Transfer_Buf[TRANSFER_BUFFER_SIZE];
+static uint32_t						Node_Hash;
+static volatile uint8_t		Node_Claiming;
+static volatile uint8_t		Node_Claim_Id;
+static volatile uint8_t		Node_Conflict;
+static volatile uint8_t		Node_Defend;
+
+static uint8_t			Bitrate_Pending;
+static uint8_t			Bitrate_Save;
+static uint32_t			Bitrate_New;
+static uint16_t			Bitrate_Sample;
+static uint32_t			Bitrate_Request_us;
+static uint8_t			Bitrate_Detected;
+static uint32_t			Bitrate_Detect_us;
 
 /** @brief    CAN Slave basic function for transmition and receiving
   ==============================================================================
@@ -25,8 +54,10 @@ static CAN_RxMessage	Slave_RxMessage;
   [..]
     This section provides functions allowing to:
 		(+) Initialize Sensor.
-    (+) Combine Sensor Id and command Id to make StdId.
-    (+) Gettinf sensor Id or command Id from a RxHeader.StdId.
+		(+) Configure Sensor stream priority and phase.
+    (+) Make StdId of a frame in CAN_FRAME_TABLE.
+    (+) Gettinf function, node Id, sensor Id, command Id or frame from a RxHeader.StdId.
+    (+) Echoing command tag in feedback.
   */
 	
 /**
@@ -34,24 +65,79 @@ static CAN_RxMessage	Slave_RxMessage;
 	* @note		Initializes the Sensor in the main function and before while loop
   * @param	Sensor   	Pointer to the Sensor_HandleTypedef structure.
 	* @param 	sensor_id Sensor ID for initializing.
+	* @return	HAL_OK, HAL_ERROR if its stream can not be registered
   */
-	void CAN_Sensor_Init(Sensor_HandleTypedef *Sensor, uint32_t sensor_id)
+HAL_StatusTypeDef CAN_Sensor_Init(Sensor_HandleTypedef *Sensor, uint32_t sensor_id)
 {
 	Sensor->sensor_id 	= sensor_id;
 	Sensor->freq				= 0;
 	Sensor->start_flag	= 0;
 	Sensor->stop_flag		= 0;
+	Sensor->mode				= STREAM_MODE_FREE;
+	Sensor->period_us		= 0;
+	Sensor->frame_valid	= 0;
+	Sensor->stat				= (CAN_Stream_Stat_TypeDef){0};
+	
+	//Keep sensor for node level request
+	if (sensor_id < SENSOR_NUM)
+		Slave_Sensor[sensor_id] = Sensor;
+	return Stream_Register(&Sensor->stream, STREAM_PRIORITY_NORMAL, 0);
+}
+
+/**
+  * @brief  Configure Sensor stream.
+	* @note		Call after CAN_Sensor_Init and before while loop
+  * @param	Sensor   	Pointer to the Sensor_HandleTypedef structure.
+	* @param 	priority 	Stream priority class (STREAM_PRIORITY_x).
+	* @param 	phase_us 	Stream release offset in microsecond.
+	* @return	HAL_OK, HAL_ERROR if the stream can not be registered
+  */
+HAL_StatusTypeDef CAN_Sensor_Stream_Config(Sensor_HandleTypedef *Sensor, uint8_t priority, uint32_t phase_us)
+{
+	return Stream_Register(&Sensor->stream, priority, phase_us);
+}
+
+/**
+  * @brief  Create StdId of a frame.
+	* @param 	Frame			Frame (CAN_FRAME_x).
+	* @param 	Node_Id		Node ID.
+	* @param 	Sensor_Id Sensor ID.
+	* @return	New StdId by combining function and command of Frame, Node_Id and Sensor_Id
+  */
+uint32_t CAN_Frame_StdId(CAN_Frame_TypeDef Frame, uint32_t Node_Id, uint32_t Sensor_Id)
+{
+	return CAN_STDID(Slave_Frame[Frame].func, Node_Id, Sensor_Id, Slave_Frame[Frame].cmd);
 }
 
 /**
-  * @brief  Create StdId by combining sensor id and cmd id.
+  * @brief  Create StdId of a frame sent by this node.
+	* @param 	Frame			Frame (CAN_FRAME_x).
 	* @param 	Sensor_Id Sensor ID.
-  * @param	Cmd_Id   	Command ID.
-	* @return	New StdId by combining Sensor_Id and Cmd_Id
+	* @return	New StdId by combining function and command of Frame, node ID and Sensor_Id
+  */
+uint32_t CAN_Slave_StdId(CAN_Frame_TypeDef Frame, uint32_t Sensor_Id)
+{
+	return CAN_Frame_StdId(Frame, Slave_Node, Sensor_Id);
+}
+
+/**
+  * @brief  Get function in a RxHeader.
+  * @param	RxHeader   	CAN RxHeader.
+	* @return	Function
+  */
+uint8_t getFunc(CAN_RxHeaderTypeDef RxHeader)
+{
+	return (RxHeader.StdId >> FUNC_POS) & FUNC_MASK;
+}
+
+/**
+  * @brief  Get node Id in a RxHeader.
+  * @param	RxHeader   	CAN RxHeader.
+	* @return	Node_Id
   */
-uint32_t CAN_Command_StdId(uint32_t Sensor_Id, uint32_t Cmd_Id)
+uint8_t getNode_Id(CAN_RxHeaderTypeDef RxHeader)
 {
-	return (Sensor_Id << 5) | Cmd_Id;
+	return (RxHeader.StdId >> NODE_POS) & NODE_MASK;
 }
 
 /**
@@ -61,7 +147,7 @@ uint32_t CAN_Command_StdId(uint32_t Sensor_Id, uint32_t Cmd_Id)
   */
 uint8_t getSensor_Id(CAN_RxHeaderTypeDef RxHeader)
 {
-	return RxHeader.StdId >> 5;
+	return (RxHeader.StdId >> SENSOR_POS) & SENSOR_MASK;
 }
 
 /**
@@ -71,7 +157,63 @@ uint8_t getSensor_Id(CAN_RxHeaderTypeDef RxHeader)
   */
 uint8_t getSensor_Cmd(CAN_RxHeaderTypeDef RxHeader)
 {
-	return RxHeader.StdId & 0x1F;
+	return (RxHeader.StdId >> CMD_POS) & CMD_MASK;
+}
+
+/**
+  * @brief  Get frame of a RxHeader from function and cmd Id.
+  * @param	RxHeader   	CAN RxHeader.
+	* @return	Frame (CAN_FRAME_x), CAN_FRAME_NUM if not in CAN_FRAME_TABLE
+  */
+CAN_Frame_TypeDef getFrame(CAN_RxHeaderTypeDef RxHeader)
+{
+	uint8_t func = getFunc(RxHeader);
+	uint8_t cmd = getSensor_Cmd(RxHeader);
+	
+	for (uint8_t i = 0; i < CAN_FRAME_NUM; i++)
+		if (Slave_Frame[i].func == func && Slave_Frame[i].cmd == cmd)
+			return (CAN_Frame_TypeDef)i;
+	return CAN_FRAME_NUM;
+}
+
+/**
+  * @brief  Check a received frame is for this node.
+  * @param	RxHeader   	CAN RxHeader.
+	* @return	Broadcast or command to this node (1), others (0)
+  */
+uint8_t CAN_Slave_isAddressed(CAN_RxHeaderTypeDef RxHeader)
+{
+	if (getFunc(RxHeader) == FUNC_NMT)
+		return 1;
+	return (getFunc(RxHeader) == FUNC_CMD || getFunc(RxHeader) == FUNC_EMCY) && (getNode_Id(RxHeader) == Slave_Node);
+}
+
+/**
+  * @brief  Latch tag of the command at the front of RxQueue.
+	* @note		A command is tagged when its DLC is the table DLC + 1,
+	*					the tag is the byte after the command data.
+  */
+void CAN_Slave_Tag_Latch(void)
+{
+	CAN_RxMessage RxMessage = CAN_RxQueue_getFront(&Slave_RxQueue);
+	CAN_Frame_TypeDef frame = getFrame(RxMessage.RxHeader);
+	
+	Slave_Tag_Valid = (frame < CAN_FRAME_NUM) && (RxMessage.RxHeader.DLC == Slave_Frame[frame].dlc + 1);
+	Slave_Tag = Slave_Tag_Valid ? RxMessage.rxdata[Slave_Frame[frame].dlc] : 0;
+}
+
+/**
+  * @brief  Put tag of the command being handled after feedback data.
+  * @param	data   	Feedback data array.
+  * @param	dlc   	Feedback DLC without tag.
+	* @return	Feedback DLC, one more if a tag was put
+  */
+uint8_t CAN_Slave_Tag_Put(uint8_t *data, uint8_t dlc)
+{
+	if (!Slave_Tag_Valid || dlc >= 8)
+		return dlc;
+	data[dlc] = Slave_Tag;
+	return dlc + 1;
 }
 
 /** @brief    Slave feedback function to master
@@ -81,8 +223,10 @@ uint8_t getSensor_Cmd(CAN_RxHeaderTypeDef RxHeader)
   [..]
     This section provides functions allowing to:
 		(+) Start a Sensor.
+		(+) Start several Sensors in one batch.
     (+) Reset a Sensor.
     (+) Assign new position for Encoder.
+    (+) Read, write or commit a parameter.
   */
 
 /**
@@ -95,17 +239,27 @@ void CAN_Sensor_Start_fb(CAN_HandleTypeDef *hcan)
 	CAN_If_TxQueue_notCreate(&Slave_TxQueue);
 	
 	//Initialize TxHeader
-	CAN_TxHeader_Init(&Slave_TxHeader, CAN_Command_StdId(getSensor_Id(CAN_RxQueue_getFront(&Slave_RxQueue).RxHeader), START_FB_ID), START_FB_DLC);
+	CAN_TxHeader_Init(&Slave_TxHeader, CAN_Slave_StdId(CAN_FRAME_START_FB, getSensor_Id(CAN_RxQueue_getFront(&Slave_RxQueue).RxHeader)), START_FB_DLC);
+	
+	uint8_t data[8] = {0};
+	CAN_RxMessage RxMessage = CAN_RxQueue_getFront(&Slave_RxQueue);
+	
+	//Echo only the bytes the master sent, the rest of rxdata is stale
+	for (uint8_t i = 0; i < RxMessage.RxHeader.DLC && i < 8; i++)
+		data[i] = RxMessage.rxdata[i];
+	
+	//Echo tag of the command
+	Slave_TxHeader.DLC = CAN_Slave_Tag_Put(data, Slave_TxHeader.DLC);
 	
 	//Find empty mailbox
 	mailbox = get_Empty_Mailbox();
 	
 	//Sending message
-	if (HAL_CAN_AddTxMessage(hcan, &Slave_TxHeader, CAN_RxQueue_getFront(&Slave_RxQueue).rxdata, &mailbox) != HAL_OK)
+	if (CAN_Transmit(hcan, &Slave_TxHeader, data, &mailbox) != HAL_OK)
 	{
 		//If failed, store message in queue for next transmit
 		CAN_TxHeader_Copy(&Slave_TxMessage.TxHeader, Slave_TxHeader);
-		CAN_Data_Copy(Slave_TxMessage.txdata, CAN_RxQueue_getFront(&Slave_RxQueue).rxdata);
+		CAN_Data_Copy(Slave_TxMessage.txdata, data);
 		CAN_EnTxQueue(&Slave_TxQueue, Slave_TxMessage); 
 	}
 }
@@ -120,16 +274,22 @@ void CAN_Sensor_Reset_fb(CAN_HandleTypeDef *hcan)
 	CAN_If_TxQueue_notCreate(&Slave_TxQueue);
 	
 	//Initialize TxHeader
-	CAN_TxHeader_Init(&Slave_TxHeader, CAN_Command_StdId(getSensor_Id(CAN_RxQueue_getFront(&Slave_RxQueue).RxHeader), RESET_FB_ID), RESET_FB_DLC);
+	CAN_TxHeader_Init(&Slave_TxHeader, CAN_Slave_StdId(CAN_FRAME_RESET_FB, getSensor_Id(CAN_RxQueue_getFront(&Slave_RxQueue).RxHeader)), RESET_FB_DLC);
+	
+	uint8_t data[8] = {0};
+	
+	//Echo tag of the command
+	Slave_TxHeader.DLC = CAN_Slave_Tag_Put(data, Slave_TxHeader.DLC);
 	
 	//Find empty mailbox
 	mailbox = get_Empty_Mailbox();
 	
 	//Sending message
-	if (HAL_CAN_AddTxMessage(hcan, &Slave_TxHeader, NULL, &mailbox) != HAL_OK)
+	if (CAN_Transmit(hcan, &Slave_TxHeader, data, &mailbox) != HAL_OK)
 	{
 		//If failed, store message in queue for next transmit
 		CAN_TxHeader_Copy(&Slave_TxMessage.TxHeader, Slave_TxHeader);
+		CAN_Data_Copy(Slave_TxMessage.txdata, data);
 		CAN_EnTxQueue(&Slave_TxQueue, Slave_TxMessage); 
 	}
 }
@@ -144,16 +304,22 @@ void CAN_Sensor_Stop_fb(CAN_HandleTypeDef *hcan)
 	CAN_If_TxQueue_notCreate(&Slave_TxQueue);
 	
 	//Initialize TxHeader
-	CAN_TxHeader_Init(&Slave_TxHeader, CAN_Command_StdId(getSensor_Id(CAN_RxQueue_getFront(&Slave_RxQueue).RxHeader), STOP_FB_ID), STOP_FB_DLC);
+	CAN_TxHeader_Init(&Slave_TxHeader, CAN_Slave_StdId(CAN_FRAME_STOP_FB, getSensor_Id(CAN_RxQueue_getFront(&Slave_RxQueue).RxHeader)), STOP_FB_DLC);
+	
+	uint8_t data[8] = {0};
+	
+	//Echo tag of the command
+	Slave_TxHeader.DLC = CAN_Slave_Tag_Put(data, Slave_TxHeader.DLC);
 	
 	//Find empty mailbox
 	mailbox = get_Empty_Mailbox();
 	
 	//Sending message
-	if (HAL_CAN_AddTxMessage(hcan, &Slave_TxHeader, NULL, &mailbox) != HAL_OK)
+	if (CAN_Transmit(hcan, &Slave_TxHeader, data, &mailbox) != HAL_OK)
 	{
 		//If failed, store message in queue for next transmit
 		CAN_TxHeader_Copy(&Slave_TxMessage.TxHeader, Slave_TxHeader);
+		CAN_Data_Copy(Slave_TxMessage.txdata, data);
 		CAN_EnTxQueue(&Slave_TxQueue, Slave_TxMessage); 
 	}
 }
@@ -168,17 +334,267 @@ void CAN_Sensor_Assign_fb(CAN_HandleTypeDef *hcan)
 	CAN_If_TxQueue_notCreate(&Slave_TxQueue);
 	
 	//Initialize TxHeader
-	CAN_TxHeader_Init(&Slave_TxHeader, CAN_Command_StdId(getSensor_Id(CAN_RxQueue_getFront(&Slave_RxQueue).RxHeader), ASSIGN_FB_ID), ASSIGN_FB_DLC);
+	CAN_TxHeader_Init(&Slave_TxHeader, CAN_Slave_StdId(CAN_FRAME_ASSIGN_FB, getSensor_Id(CAN_RxQueue_getFront(&Slave_RxQueue).RxHeader)), ASSIGN_FB_DLC);
+	
+	uint8_t data[8];
+	CAN_Data_Copy(data, CAN_RxQueue_getFront(&Slave_RxQueue).rxdata);
+	
+	//Echo tag of the command
+	Slave_TxHeader.DLC = CAN_Slave_Tag_Put(data, Slave_TxHeader.DLC);
+	
+	//Find empty mailbox
+	mailbox = get_Empty_Mailbox();
+	
+	//Sending message
+	if (CAN_Transmit(hcan, &Slave_TxHeader, data, &mailbox) != HAL_OK)
+	{
+		//If failed, store message in queue for next transmit
+		CAN_TxHeader_Copy(&Slave_TxMessage.TxHeader, Slave_TxHeader);
+		CAN_Data_Copy(Slave_TxMessage.txdata, data);
+		CAN_EnTxQueue(&Slave_TxQueue, Slave_TxMessage); 
+	}
+}
+
+/**
+  * @brief  	Feedback batch start to master.
+	* @param		hcan  	Pointer to the CAN_HandleTypeDef structure.
+	* @param		mask  	Started sensor mask.
+	* @param		status	BATCH_OK or BATCH_INVALID.
+  */
+void CAN_Batch_fb(CAN_HandleTypeDef *hcan, uint8_t mask, uint8_t status)
+{
+	//Checking if TxQueue created
+	CAN_If_TxQueue_notCreate(&Slave_TxQueue);
+	
+	//Initialize TxHeader
+	CAN_TxHeader_Init(&Slave_TxHeader, CAN_Slave_StdId(CAN_FRAME_BATCH_FB, SLAVE_ID), BATCH_FB_DLC);
+	
+	uint8_t data[8] = {0};
+	data[0] = mask;
+	data[1] = status;
+	
+	//Echo tag of the command
+	Slave_TxHeader.DLC = CAN_Slave_Tag_Put(data, Slave_TxHeader.DLC);
+	
+	//Find empty mailbox
+	mailbox = get_Empty_Mailbox();
+	
+	//Sending message
+	if (CAN_Transmit(hcan, &Slave_TxHeader, data, &mailbox) != HAL_OK)
+	{
+		//If failed, store message in queue for next transmit
+		CAN_TxHeader_Copy(&Slave_TxMessage.TxHeader, Slave_TxHeader);
+		CAN_Data_Copy(Slave_TxMessage.txdata, data);
+		CAN_EnTxQueue(&Slave_TxQueue, Slave_TxMessage); 
+	}
+}
+
+/**
+  * @brief  	Feedback SYNC capture time to master.
+	* @param		hcan  Pointer to the CAN_HandleTypeDef structure.
+  */
+void CAN_Sync_fb(CAN_HandleTypeDef *hcan)
+{
+	//Checking if TxQueue created
+	CAN_If_TxQueue_notCreate(&Slave_TxQueue);
+	
+	//Initialize TxHeader
+	CAN_TxHeader_Init(&Slave_TxHeader, CAN_Slave_StdId(CAN_FRAME_SYNC_FB, SLAVE_ID), SYNC_FB_DLC);
+	
+	//Sequence number and local capture time
+	uint8_t data[8] = {0};
+	CAN_Msg_SYNC_FB_TypeDef Msg = {.seq = Slave_Sync.seq, .capture_us = Slave_Sync.capture_us};
+	CAN_Msg_SYNC_FB_Pack(&Msg, data);
+	
+	//Echo tag of the command
+	Slave_TxHeader.DLC = CAN_Slave_Tag_Put(data, Slave_TxHeader.DLC);
+	
+	//Find empty mailbox
+	mailbox = get_Empty_Mailbox();
+	
+	//Sending message
+	if (CAN_Transmit(hcan, &Slave_TxHeader, data, &mailbox) != HAL_OK)
+	{
+		//If failed, store message in queue for next transmit
+		CAN_TxHeader_Copy(&Slave_TxMessage.TxHeader, Slave_TxHeader);
+		CAN_Data_Copy(Slave_TxMessage.txdata, data);
+		CAN_EnTxQueue(&Slave_TxQueue, Slave_TxMessage); 
+	}
+}
+
+/**
+  * @brief  	Feedback diagnostics page to master.
+	* @param		hcan  Pointer to the CAN_HandleTypeDef structure.
+	* @param		page  Diagnostics page.
+	* @param		index Index in page.
+	* @param		aData 6 bytes page data.
+  */
+void CAN_Diag_fb(CAN_HandleTypeDef *hcan, uint8_t page, uint8_t index, uint8_t aData[6])
+{
+	//Checking if TxQueue created
+	CAN_If_TxQueue_notCreate(&Slave_TxQueue);
+	
+	//Initialize TxHeader
+	CAN_TxHeader_Init(&Slave_TxHeader, CAN_Slave_StdId(CAN_FRAME_DIAG_FB, SLAVE_ID), DIAG_FB_DLC);
+	
+	uint8_t data[8];
+	data[0] = page;
+	data[1] = index;
+	for (uint8_t i = 0; i < 6; i++)
+		data[i + 2] = aData[i];
+	
+	//Echo tag of the command
+	Slave_TxHeader.DLC = CAN_Slave_Tag_Put(data, Slave_TxHeader.DLC);
+	
+	//Find empty mailbox
+	mailbox = get_Empty_Mailbox();
+	
+	//Sending message
+	if (CAN_Transmit(hcan, &Slave_TxHeader, data, &mailbox) != HAL_OK)
+	{
+		//If failed, store message in queue for next transmit
+		CAN_TxHeader_Copy(&Slave_TxMessage.TxHeader, Slave_TxHeader);
+		CAN_Data_Copy(Slave_TxMessage.txdata, data);
+		CAN_EnTxQueue(&Slave_TxQueue, Slave_TxMessage); 
+	}
+}
+
+/**
+  * @brief  	Feedback bit rate request to master.
+	* @param		hcan  				Pointer to the CAN_HandleTypeDef structure.
+	* @param		sample_point	Achieved sample point in per mille.
+	* @param		status				BITRATE_OK or BITRATE_INVALID.
+  */
+void CAN_Bitrate_fb(CAN_HandleTypeDef *hcan, uint16_t sample_point, uint8_t status)
+{
+	//Checking if TxQueue created
+	CAN_If_TxQueue_notCreate(&Slave_TxQueue);
+	
+	//Initialize TxHeader
+	CAN_TxHeader_Init(&Slave_TxHeader, CAN_Slave_StdId(CAN_FRAME_BITRATE_FB, SLAVE_ID), BITRATE_FB_DLC);
+	
+	//Echo requested bit rate
+	uint8_t data[8] = {0};
+	CAN_Msg_BITRATE_TypeDef Request;
+	CAN_Msg_BITRATE_Unpack(&Request, CAN_RxQueue_getFront(&Slave_RxQueue).rxdata);
+	CAN_Msg_BITRATE_FB_TypeDef Msg = {.kbps = Request.kbps, .sample_point = sample_point, .status = status};
+	CAN_Msg_BITRATE_FB_Pack(&Msg, data);
+	
+	//Echo tag of the command
+	Slave_TxHeader.DLC = CAN_Slave_Tag_Put(data, Slave_TxHeader.DLC);
+	
+	//Find empty mailbox
+	mailbox = get_Empty_Mailbox();
+	
+	//Sending message
+	if (CAN_Transmit(hcan, &Slave_TxHeader, data, &mailbox) != HAL_OK)
+	{
+		//If failed, store message in queue for next transmit
+		CAN_TxHeader_Copy(&Slave_TxMessage.TxHeader, Slave_TxHeader);
+		CAN_Data_Copy(Slave_TxMessage.txdata, data);
+		CAN_EnTxQueue(&Slave_TxQueue, Slave_TxMessage); 
+	}
+}
+
+/**
+  * @brief  	Feedback node ID request to master.
+	* @param		hcan  		Pointer to the CAN_HandleTypeDef structure.
+	* @param		status		NODE_OK or NODE_INVALID.
+	* @note 		Sent before switching, so master sees it with the old node ID.
+  */
+void CAN_Node_fb(CAN_HandleTypeDef *hcan, uint8_t status)
+{
+	//Checking if TxQueue created
+	CAN_If_TxQueue_notCreate(&Slave_TxQueue);
+	
+	//Initialize TxHeader
+	CAN_TxHeader_Init(&Slave_TxHeader, CAN_Slave_StdId(CAN_FRAME_NODE_FB, SLAVE_ID), NODE_FB_DLC);
+	
+	uint8_t data[8] = {0};
+	data[0] = CAN_RxQueue_getFront(&Slave_RxQueue).rxdata[0];
+	data[1] = status;
+	
+	//Echo tag of the command
+	Slave_TxHeader.DLC = CAN_Slave_Tag_Put(data, Slave_TxHeader.DLC);
+	
+	//Find empty mailbox
+	mailbox = get_Empty_Mailbox();
+	
+	//Sending message
+	if (CAN_Transmit(hcan, &Slave_TxHeader, data, &mailbox) != HAL_OK)
+	{
+		//If failed, store message in queue for next transmit
+		CAN_TxHeader_Copy(&Slave_TxMessage.TxHeader, Slave_TxHeader);
+		CAN_Data_Copy(Slave_TxMessage.txdata, data);
+		CAN_EnTxQueue(&Slave_TxQueue, Slave_TxMessage); 
+	}
+}
+
+/**
+  * @brief  	Feedback parameter request to master.
+	* @param		hcan  		Pointer to the CAN_HandleTypeDef structure.
+	* @param		op				Operation (PARAM_OP_x).
+	* @param		index			Parameter index.
+	* @param		raw				Parameter value after the operation.
+	* @param		status		PARAM_OK or error (PARAM_x).
+  */
+void CAN_Param_fb(CAN_HandleTypeDef *hcan, uint8_t op, uint8_t index, uint32_t raw, uint8_t status)
+{
+	//Checking if TxQueue created
+	CAN_If_TxQueue_notCreate(&Slave_TxQueue);
+	
+	//Initialize TxHeader
+	CAN_TxHeader_Init(&Slave_TxHeader, CAN_Slave_StdId(CAN_FRAME_PARAM_FB, SLAVE_ID), PARAM_FB_DLC);
+	
+	uint8_t data[8] = {0};
+	CAN_Msg_PARAM_FB_TypeDef Msg = {.op = op, .index = index, .value = raw, .status = status};
+	CAN_Msg_PARAM_FB_Pack(&Msg, data);
+	
+	//Echo tag of the command
+	Slave_TxHeader.DLC = CAN_Slave_Tag_Put(data, Slave_TxHeader.DLC);
+	
+	//Find empty mailbox
+	mailbox = get_Empty_Mailbox();
+	
+	//Sending message
+	if (CAN_Transmit(hcan, &Slave_TxHeader, data, &mailbox) != HAL_OK)
+	{
+		//If failed, store message in queue for next transmit
+		CAN_TxHeader_Copy(&Slave_TxMessage.TxHeader, Slave_TxHeader);
+		CAN_Data_Copy(Slave_TxMessage.txdata, data);
+		CAN_EnTxQueue(&Slave_TxQueue, Slave_TxMessage); 
+	}
+}
+
+/**
+  * @brief  	Send node management frame to master and other slaves.
+	* @param		hcan  		Pointer to the CAN_HandleTypeDef structure.
+	* @param		node			Node ID in the identifier.
+	* @param		Frame			CAN_FRAME_MGMT_CLAIM or CAN_FRAME_MGMT_BOOTUP.
+	* @param		status		NODE_BOOT_x, BOOTUP only.
+  */
+void CAN_Node_Mgmt_fb(CAN_HandleTypeDef *hcan, uint8_t node, CAN_Frame_TypeDef Frame, uint8_t status)
+{
+	//Checking if TxQueue created
+	CAN_If_TxQueue_notCreate(&Slave_TxQueue);
+	
+	//Initialize TxHeader
+	CAN_TxHeader_Init(&Slave_TxHeader, CAN_Frame_StdId(Frame, node, SLAVE_ID), Slave_Frame[Frame].dlc);
+	
+	//CLAIM is sent with the first 4 bytes
+	uint8_t data[8] = {0};
+	CAN_Msg_MGMT_BOOTUP_TypeDef Msg = {.hash = Node_Hash, .status = status};
+	CAN_Msg_MGMT_BOOTUP_Pack(&Msg, data);
 	
 	//Find empty mailbox
 	mailbox = get_Empty_Mailbox();
 	
 	//Sending message
-	if (HAL_CAN_AddTxMessage(hcan, &Slave_TxHeader, CAN_RxQueue_getFront(&Slave_RxQueue).rxdata, &mailbox) != HAL_OK)
+	if (CAN_Transmit(hcan, &Slave_TxHeader, data, &mailbox) != HAL_OK)
 	{
 		//If failed, store message in queue for next transmit
 		CAN_TxHeader_Copy(&Slave_TxMessage.TxHeader, Slave_TxHeader);
-		CAN_Data_Copy(Slave_TxMessage.txdata, CAN_RxQueue_getFront(&Slave_RxQueue).rxdata);
+		CAN_Data_Copy(Slave_TxMessage.txdata, data);
 		CAN_EnTxQueue(&Slave_TxQueue, Slave_TxMessage); 
 	}
 }
@@ -198,7 +614,7 @@ void CAN_Slave_FIFO0_ReFb_Handle(CAN_HandleTypeDef *hcan)
 	mailbox = get_Empty_Mailbox();
 	
 	//Dequeue if transmit successed
-	if(HAL_CAN_AddTxMessage(hcan, &Slave_TxHeader, CAN_TxQueue_getFront(&Slave_TxQueue).txdata, &mailbox) == HAL_OK)
+	if(CAN_Transmit(hcan, &Slave_TxHeader, CAN_TxQueue_getFront(&Slave_TxQueue).txdata, &mailbox) == HAL_OK)
 		CAN_DeTxQueue(&Slave_TxQueue);
 }
 
@@ -229,6 +645,46 @@ __weak void CAN_Sensor_Start_Handle(void)
 	
 }
 
+/**
+  * @brief  	Get start request from Start command.
+	* @note 		Period is in millisecond, or in microsecond if STREAM_PERIOD_US is set.
+	*						Stream mode is STREAM_MODE_FREE if master does not send it.
+  */
+void CAN_Start_Parse(void)
+{
+	CAN_RxMessage RxMessage = CAN_RxQueue_getFront(&Slave_RxQueue);
+	CAN_Msg_START_TypeDef Msg;
+	CAN_Msg_START_Unpack(&Msg, RxMessage.rxdata);
+	
+	Slave_Start.sensor_id = getSensor_Id(RxMessage.RxHeader);
+	Slave_Start.freq = Msg.period;
+	Slave_Start.mode = STREAM_MODE_FREE;
+	Slave_Start.period_us = (uint32_t)Slave_Start.freq * 1000;
+	if (RxMessage.RxHeader.DLC < START_DLC)
+		return;
+	
+	Slave_Start.mode = Msg.mode & STREAM_MODE_MASK;
+	if (Msg.mode & STREAM_PERIOD_US)
+		Slave_Start.period_us = Slave_Start.freq;
+}
+
+/**
+  * @brief  	Start Sensor stream from start request.
+	* @param		Sensor   	Pointer to the Sensor_HandleTypedef structure.
+  */
+void CAN_Start_Stream(Sensor_HandleTypedef *Sensor)
+{
+	//Synchronous stream is released by SYNC, polled stream by remote frame
+	if (Sensor->mode != STREAM_MODE_FREE)
+	{
+		Stream_Stop(&Sensor->stream);
+		return;
+	}
+	
+	Sensor->period_us = Slave_Start.period_us;
+	Stream_Start(&Sensor->stream, CAN_Sensor_Rate_Period(Sensor));
+}
+
 /**
   * @brief  	Start IMU function.
 	* @param		Sensor   	Pointer to the Sensor_HandleTypedef structure.
@@ -240,11 +696,13 @@ __weak void CAN_Sensor_Start_Handle(void)
 void CAN_Start_IMU(Sensor_HandleTypedef *Sensor ,UART_HandleTypeDef *huart, uint8_t *rxdata)
 {
 	static uint8_t first_time;
-	if (getSensor_Id(CAN_RxQueue_getFront(&Slave_RxQueue).RxHeader) == IMU_ID)
+	if (Slave_Start.sensor_id == IMU_ID)
 	{
 		Sensor->start_flag = 1;
 		Sensor->stop_flag = 0;
-		Sensor->freq = (uint16_t)((uint16_t)CAN_RxQueue_getFront(&Slave_RxQueue).rxdata[1] << 8 | CAN_RxQueue_getFront(&Slave_RxQueue).rxdata[0]);
+		Sensor->freq = Slave_Start.freq;
+		Sensor->mode = Slave_Start.mode;
+		CAN_Start_Stream(Sensor);
 		if (first_time) 
 			return;
 		HAL_UART_Receive_IT(huart, rxdata, 1);
@@ -263,11 +721,13 @@ void CAN_Start_IMU(Sensor_HandleTypedef *Sensor ,UART_HandleTypeDef *huart, uint
 void CAN_Start_Encoder(Sensor_HandleTypedef *Sensor, TIM_HandleTypeDef *htim1, TIM_HandleTypeDef *htim2)
 {
 	static uint8_t first_time;
-	if (getSensor_Id(CAN_RxQueue_getFront(&Slave_RxQueue).RxHeader) == ENC_ID)
+	if (Slave_Start.sensor_id == ENC_ID)
 	{
 		Sensor->start_flag = 1;
 		Sensor->stop_flag = 0;
-		Sensor->freq = (uint16_t)((uint16_t)CAN_RxQueue_getFront(&Slave_RxQueue).rxdata[1] << 8 | CAN_RxQueue_getFront(&Slave_RxQueue).rxdata[0]);
+		Sensor->freq = Slave_Start.freq;
+		Sensor->mode = Slave_Start.mode;
+		CAN_Start_Stream(Sensor);
 		
 		if (first_time)
 			return;
@@ -327,6 +787,7 @@ void CAN_Reset_Encoder(CAN_HandleTypeDef *hcan, Sensor_HandleTypedef *Sensor, En
 	{
 		Encoder_Reset(Encoderx);
 		Encoder_Reset(Encodery);
+		Slave_Assign[0] = Slave_Assign[1] = 0;
 		if (!Sensor->freq)
 			return;
 		Sensor->start_flag = 1;
@@ -364,6 +825,7 @@ void CAN_Stop_Sensor(CAN_HandleTypeDef *hcan, Sensor_HandleTypedef *Sensor)
 		if (!Sensor->freq)
 			return;
 		Sensor->stop_flag = 1;
+		Stream_Stop(&Sensor->stream);
 		CAN_Sensor_Stop_fb(hcan);
 	}
 }
@@ -397,22 +859,15 @@ void CAN_Assign_Encoder(CAN_HandleTypeDef *hcan, Sensor_HandleTypedef Sensor, En
 {
 	if (getSensor_Id(CAN_RxQueue_getFront(&Slave_RxQueue).RxHeader) == ENC_ID)
 	{
-		//Combine uint8_t arry into uint32_t
-		uint8_t data[8];
-		CAN_Data_Copy(data, CAN_RxQueue_getFront(&Slave_RxQueue).rxdata);
-		
-		uint32_t x_raw = ((uint32_t)data[0]) | ((uint32_t)data[1] << 8) | 
-																((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
-		uint32_t y_raw = ((uint32_t)data[4]) | ((uint32_t)data[5] << 8) | 
-																((uint32_t)data[6] << 16) | ((uint32_t)data[7] << 24);
-		
-		//Convert uint32_t to float data
-		float x_pos = *(float *)&x_raw;
-		float y_pos = *(float *)&y_raw;
+		//Decode float position
+		CAN_Msg_ENC_ASSIGN_TypeDef Msg;
+		CAN_Msg_ENC_ASSIGN_Unpack(&Msg, CAN_RxQueue_getFront(&Slave_RxQueue).rxdata);
 		
-		//Assign new value
-		Encoder_Assign_Position(Encoderx, x_pos);
-		Encoder_Assign_Position(Encodery, y_pos);
+		//Assign new value, kept for commit to flash
+		Encoder_Assign_Position(Encoderx, Msg.x);
+		Encoder_Assign_Position(Encodery, Msg.y);
+		Slave_Assign[0] = Msg.x;
+		Slave_Assign[1] = Msg.y;
 		
 		//Feedback assign value
 		if (!Sensor.freq)
@@ -431,6 +886,28 @@ void CAN_Assign_Encoder(CAN_HandleTypeDef *hcan, Sensor_HandleTypedef Sensor, En
     (+) Feedback after receiving.
   */
 
+/**
+  * @brief  SYNC Handle function.
+	* @note 	Place this function beforn main function
+	*					and call any synchronous transmit function in this.
+	* @warning	This function is called in CAN Rx interrupt.
+  */
+__weak void CAN_Sensor_Sync_Handle(void)
+{
+	
+}
+
+/**
+  * @brief  Segmented transfer receive Handle function.
+	* @note 	Place this function beforn main function
+	*					and wake the task calling CAN_Slave_Transfer_Handle in this.
+	* @warning	This function is called in CAN Rx interrupt.
+  */
+__weak void CAN_Bulk_Rx_Handle(void)
+{
+	
+}
+
 /**
   * @brief  	Receiving command from master.
 	* @param		hcan	   	Pointer to the CAN_HandleTypeDef structure.
@@ -439,34 +916,128 @@ void CAN_Assign_Encoder(CAN_HandleTypeDef *hcan, Sensor_HandleTypedef Sensor, En
   */
 void CAN_Slave_FIFO0_RxMessage(CAN_HandleTypeDef *hcan)
 {
+	//Capture receive time as close as possible to the frame end
+	uint32_t rx_time = Timebase_Get_Us();
+	uint32_t rx_cycle = CAN_Latency_Now();
+	
 	if ((HAL_CAN_GetRxMessage(hcan, CAN_RX_FIFO0, &Slave_RxMessage.RxHeader, Slave_RxMessage.rxdata) != HAL_OK))
 		return;
-	if ((getSensor_Id(Slave_RxMessage.RxHeader) == IMU_ID) || getSensor_Id(Slave_RxMessage.RxHeader) == ENC_ID)
+	Slave_RxMessage.cycle = rx_cycle;
+	
+	//bxCAN Timestamp is only valid in time triggered mode, use local microsecond time instead
+	Slave_RxMessage.RxHeader.Timestamp = rx_time;
+	CAN_Bus_Stat_Rx(&Slave_RxMessage.RxHeader, Slave_RxMessage.rxdata, rx_time);
+	
+	//Answer polling from the pre-serialised frame without waiting for while loop
+	if (Slave_RxMessage.RxHeader.RTR == CAN_RTR_REMOTE)
 	{
-		CAN_If_RxQueue_notCreate(&Slave_RxQueue);
-		CAN_EnRxQueue(&Slave_RxQueue, Slave_RxMessage);
+		CAN_Slave_Remote_Handle(hcan, &Slave_RxMessage.RxHeader);
+		return;
 	}
-}
-
-/**
-  * @brief  	Receiving Start command handle.
+	
+	//Latch and transmit synchronous data without waiting for while loop
+	if (getFrame(Slave_RxMessage.RxHeader) == CAN_FRAME_SYNC)
+		CAN_Sensor_Sync_Handle();
+	
+	//Segmented transfer copies consecutive frames as they come
+	if (getFunc(Slave_RxMessage.RxHeader) == FUNC_BULK)
+	{
+		if (Slave_RxMessage.RxHeader.StdId == Slave_Transfer.rx_id)
+		{
+			CAN_Transfer_Rx_Handle(&Slave_Transfer, &Slave_RxMessage);
+			CAN_Bulk_Rx_Handle();
+		}
+		return;
+	}
+	
+	//Node claim runs before while loop, handle management frame here
+	if (getFunc(Slave_RxMessage.RxHeader) == FUNC_MGMT)
+	{
+		CAN_Slave_Node_Rx(&Slave_RxMessage);
+		return;
+	}
+	
+	if (CAN_Slave_isAddressed(Slave_RxMessage.RxHeader))
+	{
+		CAN_If_RxQueue_notCreate(&Slave_RxQueue);
+		CAN_EnRxQueue(&Slave_RxQueue, Slave_RxMessage);
+	}
+}
+
+/**
+  * @brief  	Receiving Start command handle.
 	* @param		hcan	   	Pointer to the CAN_HandleTypeDef structure.
   */
 void CAN_RxStart_RQ(CAN_HandleTypeDef *hcan)
 {
-	if (getSensor_Cmd(CAN_RxQueue_getFront(&Slave_RxQueue).RxHeader) == START_ID)
+	if (getFrame(CAN_RxQueue_getFront(&Slave_RxQueue).RxHeader) == CAN_FRAME_START)
 	{
+		CAN_Start_Parse();
 		CAN_Sensor_Start_Handle();
 		CAN_Sensor_Start_fb(hcan);
 	}
 }
 
+/**
+  * @brief  	Receiving batch start command handle.
+	* @param		hcan	   	Pointer to the CAN_HandleTypeDef structure.
+	* @note 		Every setting is checked before the first sensor is started.
+  */
+void CAN_RxBatch_RQ(CAN_HandleTypeDef *hcan)
+{
+	static const uint32_t unit_us[4] = {100, 1000, 10000, 100000};
+	
+	if (getFrame(CAN_RxQueue_getFront(&Slave_RxQueue).RxHeader) != CAN_FRAME_BATCH)
+		return;
+	
+	CAN_RxMessage RxMessage = CAN_RxQueue_getFront(&Slave_RxQueue);
+	uint8_t mask = RxMessage.rxdata[0];
+	uint8_t mode[BATCH_SLOT_NUM];
+	uint32_t period_us[BATCH_SLOT_NUM];
+	
+	//Check every setting first, start all or nothing
+	uint8_t valid = (RxMessage.RxHeader.DLC >= BATCH_DLC) && mask && !(mask >> BATCH_SLOT_NUM);
+	for (uint8_t id = 0; id < BATCH_SLOT_NUM && valid; id++)
+	{
+		if (!(mask & (1 << id)))
+			continue;
+		
+		uint8_t code = RxMessage.rxdata[1 + id];
+		mode[id] = (RxMessage.rxdata[5 + id / 2] >> (4 * (id % 2))) & STREAM_MODE_MASK;
+		period_us[id] = (code & BATCH_COUNT_MASK) * unit_us[code >> BATCH_UNIT_POS];
+		
+		if (id >= SENSOR_NUM || Slave_Sensor[id] == NULL || mode[id] > STREAM_MODE_POLL ||
+				(mode[id] == STREAM_MODE_FREE && !period_us[id]))
+			valid = 0;
+	}
+	
+	if (!valid)
+	{
+		CAN_Batch_fb(hcan, 0, BATCH_INVALID);
+		return;
+	}
+	
+	for (uint8_t id = 0; id < SENSOR_NUM; id++)
+	{
+		if (!(mask & (1 << id)))
+			continue;
+		
+		//Same path as Start command, freq keeps the period in millisecond
+		Slave_Start.sensor_id = id;
+		Slave_Start.mode = mode[id];
+		Slave_Start.period_us = period_us[id];
+		Slave_Start.freq = (period_us[id] >= 1000) ? (uint16_t)(period_us[id] / 1000) : 1;
+		CAN_Sensor_Start_Handle();
+	}
+	CAN_Batch_fb(hcan, mask, BATCH_OK);
+}
+
 /**
   * @brief  	Receiving Reset command handle.
   */
 void CAN_RxReset_RQ(void)
 {
-	if (getSensor_Cmd(CAN_RxQueue_getFront(&Slave_RxQueue).RxHeader) == RESET_ID)
+	if (getFrame(CAN_RxQueue_getFront(&Slave_RxQueue).RxHeader) == CAN_FRAME_RESET)
 	{
 		CAN_Sensor_Reset_Handle();
 	}
@@ -477,7 +1048,7 @@ void CAN_RxReset_RQ(void)
   */
 void CAN_RxStop_RQ(void)
 {
-	if (getSensor_Cmd(CAN_RxQueue_getFront(&Slave_RxQueue).RxHeader) == STOP_ID)
+	if (getFrame(CAN_RxQueue_getFront(&Slave_RxQueue).RxHeader) == CAN_FRAME_STOP)
 	{
 		CAN_Sensor_Stop_Handle();
 	}
@@ -488,26 +1059,244 @@ void CAN_RxStop_RQ(void)
   */
 void CAN_RxEncoder_AssignRQ(void)
 {
-	if (getSensor_Cmd(CAN_RxQueue_getFront(&Slave_RxQueue).RxHeader) == ENC_ASSIGN_ID)
+	if (getFrame(CAN_RxQueue_getFront(&Slave_RxQueue).RxHeader) == CAN_FRAME_ENC_ASSIGN)
 	{
 		CAN_Encoder_Assign_Handle();
 	}
 }
 
+/**
+  * @brief  	Receiving SYNC handle.
+	* @param		hcan	   	Pointer to the CAN_HandleTypeDef structure.
+  */
+void CAN_RxSync_RQ(CAN_HandleTypeDef *hcan)
+{
+	if (getFrame(CAN_RxQueue_getFront(&Slave_RxQueue).RxHeader) == CAN_FRAME_SYNC)
+	{
+		CAN_Sync_Update(&Slave_Sync, CAN_RxQueue_getFront(&Slave_RxQueue));
+		CAN_Sync_fb(hcan);
+	}
+}
+
+/**
+  * @brief  	Receiving diagnostics request handle.
+	* @param		hcan	   	Pointer to the CAN_HandleTypeDef structure.
+  */
+void CAN_RxDiag_RQ(CAN_HandleTypeDef *hcan)
+{
+	if (getFrame(CAN_RxQueue_getFront(&Slave_RxQueue).RxHeader) == CAN_FRAME_DIAG_RQ)
+	{
+		CAN_Slave_Diag_Handle(hcan, CAN_RxQueue_getFront(&Slave_RxQueue).rxdata[0], CAN_RxQueue_getFront(&Slave_RxQueue).rxdata[1]);
+	}
+}
+
+/**
+  * @brief  	Receiving bit rate request handle.
+	* @param		hcan	   	Pointer to the CAN_HandleTypeDef structure.
+  */
+void CAN_RxBitrate_RQ(CAN_HandleTypeDef *hcan)
+{
+	if (getFrame(CAN_RxQueue_getFront(&Slave_RxQueue).RxHeader) != CAN_FRAME_BITRATE)
+		return;
+	
+	CAN_RxMessage RxMessage = CAN_RxQueue_getFront(&Slave_RxQueue);
+	CAN_Msg_BITRATE_TypeDef Msg;
+	CAN_Msg_BITRATE_Unpack(&Msg, RxMessage.rxdata);
+	uint32_t bitrate = (uint32_t)Msg.kbps * 1000;
+	uint16_t sample_point = Msg.sample_point;
+	if (sample_point == 0)
+		sample_point = FLASH_CONFIG_SAMPLE;
+	
+	//Check the bit rate is reachable before answering
+	CAN_BitTiming_TypeDef timing;
+	if (RxMessage.RxHeader.DLC < BITRATE_DLC || bitrate < BITRATE_MIN || bitrate > BITRATE_MAX ||
+			CAN_BitTiming_Calc(HAL_RCC_GetPCLK1Freq(), bitrate, sample_point, &timing) != HAL_OK)
+	{
+		CAN_Bitrate_fb(hcan, 0, BITRATE_INVALID);
+		return;
+	}
+	
+	CAN_Bitrate_fb(hcan, timing.sample_point, BITRATE_OK);
+	
+	//Switch after the feedback is on the bus
+	Bitrate_New = bitrate;
+	Bitrate_Sample = sample_point;
+	Bitrate_Save = Msg.save;
+	Bitrate_Request_us = Timebase_Get_Us();
+	Bitrate_Pending = 1;
+}
+
+/**
+  * @brief  	Receiving node ID request handle.
+	* @param		hcan	   	Pointer to the CAN_HandleTypeDef structure.
+  */
+void CAN_RxNode_RQ(CAN_HandleTypeDef *hcan)
+{
+	if (getFrame(CAN_RxQueue_getFront(&Slave_RxQueue).RxHeader) != CAN_FRAME_NODE_SET)
+		return;
+	
+	CAN_RxMessage RxMessage = CAN_RxQueue_getFront(&Slave_RxQueue);
+	if (RxMessage.RxHeader.DLC < NODE_SET_DLC || RxMessage.rxdata[0] >= NODE_NUM)
+	{
+		CAN_Node_fb(hcan, NODE_INVALID);
+		return;
+	}
+	
+	CAN_Node_fb(hcan, NODE_OK);
+	CAN_Slave_Node_Init(hcan, RxMessage.rxdata[0]);
+	if (!RxMessage.rxdata[1])
+		return;
+	
+	Flash_Config_TypeDef config;
+	Flash_Config_Load(&config);
+	config.node_id = RxMessage.rxdata[0];
+	config.node_valid = 1;
+	Flash_Config_Save(&config);
+}
+
+/**
+  * @brief  	Receiving parameter request handle.
+	* @param		hcan	   	Pointer to the CAN_HandleTypeDef structure.
+	* @note 		A written parameter is applied before the feedback.
+  */
+void CAN_RxParam_RQ(CAN_HandleTypeDef *hcan)
+{
+	if (getFrame(CAN_RxQueue_getFront(&Slave_RxQueue).RxHeader) != CAN_FRAME_PARAM)
+		return;
+	
+	CAN_RxMessage RxMessage = CAN_RxQueue_getFront(&Slave_RxQueue);
+	CAN_Msg_PARAM_TypeDef Msg;
+	CAN_Msg_PARAM_Unpack(&Msg, RxMessage.rxdata);
+	uint8_t op = Msg.op;
+	uint8_t index = Msg.index;
+	uint32_t raw = 0;
+	uint8_t status = PARAM_OK;
+	
+	if (RxMessage.RxHeader.DLC < PARAM_DLC)
+	{
+		CAN_Param_fb(hcan, op, index, 0, PARAM_INVALID_OP);
+		return;
+	}
+	
+	switch (op)
+	{
+		case PARAM_OP_READ:
+			status = CAN_Param_Read(index, &raw);
+			break;
+		
+		case PARAM_OP_WRITE:
+			status = CAN_Param_Write(index, Msg.value);
+			if (status == PARAM_OK)
+				CAN_Slave_Param_Apply(index);
+			CAN_Param_Read(index, &raw);
+			break;
+		
+		case PARAM_OP_COMMIT:
+		{
+			Flash_Config_TypeDef config;
+			Flash_Config_Load(&config);
+			CAN_Slave_Config_Store(&config);
+			if (Flash_Config_Save(&config) != HAL_OK)
+				status = PARAM_FLASH_ERROR;
+			break;
+		}
+		
+		case PARAM_OP_DEFAULT:
+			CAN_Param_Default();
+			CAN_Slave_Param_Apply(PARAM_NUM);
+			break;
+		
+		case PARAM_OP_MAP_READ:
+		{
+			CAN_Map_EntryTypeDef Entry;
+			uint8_t num;
+			status = CAN_Map_Read(index >> 4, index & 0x0F, &Entry, &num);
+			if (status == PARAM_OK)
+				raw = (uint32_t)Entry.signal | ((uint32_t)Entry.pos << 8) | ((uint32_t)Entry.width << 16) | ((uint32_t)num << 24);
+			break;
+		}
+		
+		case PARAM_OP_MAP_WRITE:
+			status = CAN_Map_Write(index >> 4, index & 0x0F, Msg.value & 0xFF, (Msg.value >> 8) & 0xFF, (Msg.value >> 16) & 0xFF);
+			break;
+		
+		case PARAM_OP_MAP_APPLY:
+			status = CAN_Map_Apply(index >> 4, Msg.value & 0xFF);
+			break;
+		
+		default:
+			status = PARAM_INVALID_OP;
+			break;
+	}
+	
+	CAN_Param_fb(hcan, op, index, raw, status);
+}
+
+#if LATENCY_ENABLE
+/**
+  * @brief  	Get StdId of the feedback of a command.
+	* @param		RxHeader	 Command RxHeader.
+	* @return		Feedback StdId, LATENCY_NO_ACK if the command has no feedback
+  */
+static uint32_t CAN_Slave_Ack_StdId(CAN_RxHeaderTypeDef RxHeader)
+{
+	uint8_t sensor = getSensor_Id(RxHeader);
+	
+	switch (getFrame(RxHeader))
+	{
+		case CAN_FRAME_STOP:				return CAN_Slave_StdId(CAN_FRAME_STOP_FB, sensor);
+		case CAN_FRAME_SYNC:				return CAN_Slave_StdId(CAN_FRAME_SYNC_FB, SLAVE_ID);
+		case CAN_FRAME_START:				return CAN_Slave_StdId(CAN_FRAME_START_FB, sensor);
+		case CAN_FRAME_RESET:				return CAN_Slave_StdId(CAN_FRAME_RESET_FB, sensor);
+		case CAN_FRAME_PARAM:				return CAN_Slave_StdId(CAN_FRAME_PARAM_FB, sensor);
+		case CAN_FRAME_BATCH:				return CAN_Slave_StdId(CAN_FRAME_BATCH_FB, sensor);
+		case CAN_FRAME_ENC_ASSIGN:	return CAN_Slave_StdId(CAN_FRAME_ASSIGN_FB, sensor);
+		case CAN_FRAME_DIAG_RQ:			return CAN_Slave_StdId(CAN_FRAME_DIAG_FB, sensor);
+		case CAN_FRAME_BITRATE:			return CAN_Slave_StdId(CAN_FRAME_BITRATE_FB, sensor);
+		case CAN_FRAME_NODE_SET:		return CAN_Slave_StdId(CAN_FRAME_NODE_FB, sensor);
+		default:										return LATENCY_NO_ACK;
+	}
+}
+#endif
+
 /**
   * @brief  	Receiving command handle.
 	* @param	hcan   		Pointer to the CAN_HandleTypeDef structure.
+	* @note 		With LATENCY_ENABLE every command is stamped at dispatch,
+	*						its feedback is matched in CAN_Transmit_Handle.
   */
 void CAN_Slave_FIFO0_Recieve_Cmd_Handle(CAN_HandleTypeDef *hcan)
 {
-	if (Slave_RxQueue.used)
+	//Handle every pending command, bounded so while loop is never blocked
+	for (uint8_t i = 0; i < CAN_QUEUE_CAPACITY && Slave_RxQueue.used; i++)
 	{
-		CAN_RxStart_RQ(hcan);
-		CAN_RxReset_RQ();
-		CAN_RxStop_RQ();
-		CAN_RxEncoder_AssignRQ();
+		CAN_RxMessage RxMessage = CAN_RxQueue_getFront(&Slave_RxQueue);
+		uint8_t queued = Slave_TxQueue.used;
+		CAN_Latency_Dispatch(getFrame(RxMessage.RxHeader), CAN_Slave_Ack_StdId(RxMessage.RxHeader), RxMessage.cycle);
+		CAN_Slave_Tag_Latch();
+		
+		//Broadcast and node level frames do not carry sensor command
+		if (getFunc(CAN_RxQueue_getFront(&Slave_RxQueue).RxHeader) == FUNC_NMT)
+			CAN_RxSync_RQ(hcan);
+		else if (getSensor_Id(CAN_RxQueue_getFront(&Slave_RxQueue).RxHeader) == SLAVE_ID)
+		{
+			CAN_RxDiag_RQ(hcan);
+			CAN_RxBatch_RQ(hcan);
+			CAN_RxBitrate_RQ(hcan);
+			CAN_RxNode_RQ(hcan);
+			CAN_RxParam_RQ(hcan);
+		}
+		else
+		{
+			CAN_RxStart_RQ(hcan);
+			CAN_RxReset_RQ();
+			CAN_RxStop_RQ();
+			CAN_RxEncoder_AssignRQ();
+		}
 
+		Slave_Tag_Valid = 0;
 		CAN_DeRxQueue(&Slave_RxQueue);
+		CAN_Latency_Dispatch_End(Slave_TxQueue.used > queued);
 	}
 }
 
@@ -528,6 +1317,9 @@ void CAN_Slave_FIFO0_Recieve_Cmd_Handle(CAN_HandleTypeDef *hcan)
   */
 void CAN_IMU_Data_Transmit(CAN_HandleTypeDef *hcan, Sensor_HandleTypedef *IMU, uint8_t aData[6])
 {
+	//Keep newest frame for polling
+	CAN_IMU_Data_Update(IMU, aData);
+	
 	//Stop transmit for feedback first
 	if (Slave_RxQueue.used	|| Slave_TxQueue.used)
 		return;
@@ -539,14 +1331,15 @@ void CAN_IMU_Data_Transmit(CAN_HandleTypeDef *hcan, Sensor_HandleTypedef *IMU, u
 	if (IMU->stop_flag == 1)
 		return;
 	
-	//Transmition handle
-	static uint32_t time = 0;
-	if ((HAL_GetTick() - time) > IMU->freq)
+	//Synchronous and polled stream are not periodic
+	if (IMU->mode != STREAM_MODE_FREE)
+		return;
+	
+	//Transmition handle, released by stream scheduler
+	if (Stream_isDue(&IMU->stream))
 	{
-		CAN_TxHeader_Init(&Slave_TxHeader, CAN_Command_StdId(IMU_ID, IMU_DATA), IMU_DATA_DLC);
-		mailbox = get_Empty_Mailbox();
-		HAL_CAN_AddTxMessage(hcan, &Slave_TxHeader, aData, &mailbox);
-		time = HAL_GetTick();
+		CAN_Sensor_Frame_Transmit(hcan, IMU, &IMU->frame.TxHeader, IMU->frame.txdata);
+		Stream_Complete(&IMU->stream);
 	}
 }
 
@@ -558,6 +1351,9 @@ void CAN_IMU_Data_Transmit(CAN_HandleTypeDef *hcan, Sensor_HandleTypedef *IMU, u
   */
 void CAN_Encoder_Data_Transmit(CAN_HandleTypeDef *hcan, Sensor_HandleTypedef *Encoder, float x_pos, float y_pos)
 {
+	//Keep newest frame for polling
+	CAN_Encoder_Data_Update(Encoder, x_pos, y_pos);
+	
 	//Stop transmit for feedback first
 	if (Slave_RxQueue.used || Slave_TxQueue.used)
 		return;
@@ -569,35 +1365,1240 @@ void CAN_Encoder_Data_Transmit(CAN_HandleTypeDef *hcan, Sensor_HandleTypedef *En
 	if (Encoder->stop_flag == 1)
 		return;
 	
-	//Transmition handle	
-	static uint32_t time = 0;
-	if ((HAL_GetTick() - time) > Encoder->freq)
+	//Synchronous and polled stream are not periodic
+	if (Encoder->mode != STREAM_MODE_FREE)
+		return;
+	
+	//Transmition handle, released by stream scheduler
+	if (Stream_isDue(&Encoder->stream))
 	{
-		//Convert float data to uint32_t data
-		uint32_t *x_raw = (uint32_t *)&x_pos;
-		uint32_t *y_raw = (uint32_t *)&y_pos;
+		CAN_Sensor_Frame_Transmit(hcan, Encoder, &Encoder->frame.TxHeader, Encoder->frame.txdata);
+		Stream_Complete(&Encoder->stream);
+	}
+}
+
+/** @brief    Slave pre-serialised data frame for polling
+  ==============================================================================
+								##### Slave Polled Data Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+		(+) Updating signals and packing them with the mapping of the stream.
+		(+) Keeping the newest data frame of each sensor ready in RAM.
+		(+) Answering a remote frame (RTR) directly in Rx interrupt.
+		(+) Replacing a pending data frame by a fresher one.
+	[..]
+		Frames are written with interrupt locked, so the Rx interrupt
+		always loads a complete frame in the mailbox.
+  */
+
+/**
+  * @brief  	Store a data frame in a Sensor.
+	* @param		Sensor	 	Pointer to the Sensor_HandleTypedef structure.
+	* @param		StdId	 		Data frame StdId.
+	* @param		DLC	 			Data frame DLC.
+	* @param		data	 		Data array.
+  */
+void CAN_Sensor_Frame_Update(Sensor_HandleTypedef *Sensor, uint32_t StdId, uint32_t DLC, uint8_t data[8])
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	CAN_TxHeader_Init(&Sensor->frame.TxHeader, StdId, DLC);
+	CAN_Data_Copy(Sensor->frame.txdata, data);
+	Sensor->frame_valid = 1;
+	__set_PRIMASK(primask);
+}
+
+/**
+  * @brief  	Account the mailboxes holding frames of a Sensor.
+	* @param		hcan	   	Pointer to the CAN_HandleTypeDef structure.
+	* @param		Sensor	 	Pointer to the Sensor_HandleTypedef structure.
+	* @param		StdId	 		Data frame StdId.
+	* @param		abort	 		Abort the frames still pending (1) or keep them (0).
+	* @note 		Call with interrupt locked. A mailbox left without an abort was
+	*						transmitted, automatic retransmission never gives up a frame.
+  */
+static void CAN_Sensor_Tx_Resolve(CAN_HandleTypeDef *hcan, Sensor_HandleTypedef *Sensor, uint32_t StdId, uint8_t abort)
+{
+	CAN_Stream_Stat_TypeDef *stat = &Sensor->stat;
+	
+	for (uint8_t i = 0; i < 3; i++)
+	{
+		uint32_t TxMailbox = CAN_TX_MAILBOX0 << i;
+		uint32_t TIR = hcan->Instance->sTxMailBox[i].TIR;
+		if (!(stat->mailbox & TxMailbox))
+			continue;
+		
+		//Still holding the frame of this stream
+		if (HAL_CAN_IsTxMessagePending(hcan, TxMailbox) && !(TIR & CAN_TI0R_IDE) &&
+				((TIR & CAN_TI0R_STID) >> CAN_TI0R_STID_Pos) == StdId)
+		{
+			if (!abort)
+				continue;
+			HAL_CAN_AbortTxRequest(hcan, TxMailbox);
+			CAN_Bus_Stat_Tx_Abort(StdId);
+			stat->aborted++;
+		}
+		else
+			stat->transmitted++;
+		stat->mailbox &= ~TxMailbox;
+	}
+}
+
+/**
+  * @brief  	Transmit a Sensor data frame, latest value wins.
+	* @param		hcan	   	Pointer to the CAN_HandleTypeDef structure.
+	* @param		Sensor	 	Pointer to the Sensor_HandleTypedef structure.
+	* @param		TxHeader	Data frame header.
+	* @param		data	 		Data array, its sequence is rewritten for this transmit.
+	* @note 		A data frame of the same sensor still waiting for the bus is older
+	*						than this one, so it is aborted and counted in stat.aborted.
+	*						A frame not loaded is counted in stat.dropped, the sequence
+	*						moves on in both case so master sees the gap. Each call puts
+	*						its own sequence in the frame, so a pre-serialised frame sent
+	*						twice (RTR answer and periodic send) is never a duplicate.
+	*						Feedback frames never go through this function and stay reliable.
+	* @return		HAL status of loading the new frame
+  */
+HAL_StatusTypeDef CAN_Sensor_Frame_Transmit(CAN_HandleTypeDef *hcan, Sensor_HandleTypedef *Sensor, CAN_TxHeaderTypeDef *TxHeader, uint8_t *data)
+{
+	uint32_t TxMailbox;
+	HAL_StatusTypeDef status = HAL_ERROR;
+	uint8_t bus_off = (CAN_Bus_Get_State() == BUS_STATE_OFF);
+	
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	Sensor->stat.produced++;
+	CAN_Map_Pack_Signal(Sensor->sensor_id, SIGNAL_SEQ, Sensor->stat.seq, data);
+	Sensor->stat.seq++;
+	
+	//Data loaded during bus off would be stale on recovery
+	if (!bus_off)
+	{
+		CAN_Sensor_Tx_Resolve(hcan, Sensor, TxHeader->StdId, 1);
+		status = CAN_Transmit(hcan, TxHeader, data, &TxMailbox);
+	}
+	
+	if (status == HAL_OK)
+	{
+		Sensor->stat.queued++;
+		Sensor->stat.mailbox |= TxMailbox;
+	}
+	else
+		Sensor->stat.dropped++;
+	__set_PRIMASK(primask);
+	
+	if (bus_off)
+		return status;
+	CAN_Bus_Tx_Result(status);
+	
+	//Time to first data after reset, 0 until then
+	if (status == HAL_OK && !Boot_First_Data_ms)
+		Boot_First_Data_ms = HAL_GetTick() ? HAL_GetTick() : 1;
+	return status;
+}
+
+/**
+  * @brief  	Update timestamp and status signals.
+	* @note 		Called before packing any data frame.
+  */
+void CAN_Slave_Signal_Update(void)
+{
+	uint8_t status = (CAN_Bus_Get_Level() & 0x03) << MAP_STATUS_LEVEL_POS;
+	
+	if (Slave_Sensor[IMU_ID] != NULL && Slave_Sensor[IMU_ID]->start_flag && !Slave_Sensor[IMU_ID]->stop_flag)
+		status |= MAP_STATUS_IMU_RUN;
+	if (Slave_Sensor[ENC_ID] != NULL && Slave_Sensor[ENC_ID]->start_flag && !Slave_Sensor[ENC_ID]->stop_flag)
+		status |= MAP_STATUS_ENC_RUN;
+	if (Slave_Sync.ref_valid)
+		status |= MAP_STATUS_SYNC_VALID;
+	if (CAN_Bus_Get_State() == BUS_STATE_PASSIVE)
+		status |= MAP_STATUS_PASSIVE;
+	
+	CAN_Map_Set_Signal(SIGNAL_STATUS, status);
+	CAN_Map_Set_Signal(SIGNAL_TIMESTAMP, CAN_Sync_Get_Master_Us());
+}
+
+/**
+  * @brief  	Update IMU signals.
+	* @param		aData	   	IMU hex data array, roll, pitch and yaw LSB first.
+  */
+void CAN_IMU_Signal_Update(uint8_t aData[6])
+{
+	CAN_Map_Set_Signal(SIGNAL_IMU_ROLL, (uint32_t)(int16_t)((uint16_t)aData[1] << 8 | aData[0]));
+	CAN_Map_Set_Signal(SIGNAL_IMU_PITCH, (uint32_t)(int16_t)((uint16_t)aData[3] << 8 | aData[2]));
+	CAN_Map_Set_Signal(SIGNAL_IMU_YAW, (uint32_t)(int16_t)((uint16_t)aData[5] << 8 | aData[4]));
+	CAN_Slave_Signal_Update();
+}
+
+/**
+  * @brief  	Update Encoder signals.
+	* @param		x_pos	   	X axis position.
+	* @param		y_pos	   	Y axis position.
+  */
+void CAN_Encoder_Signal_Update(float x_pos, float y_pos)
+{
+	CAN_Map_Set_Float(SIGNAL_ENC_X, x_pos);
+	CAN_Map_Set_Float(SIGNAL_ENC_Y, y_pos);
+	CAN_Slave_Signal_Update();
+}
+
+/**
+  * @brief  	Pack a Sensor data frame with its mapping and sequence.
+	* @param		Sensor	 	Pointer to the Sensor_HandleTypedef structure.
+	* @param		data	 		Data array to store.
+	* @note 		Locked so a SYNC packing another stream never changes the sequence.
+	*						Out of interrupt, lock the signal update and this function together
+	*						so a SYNC can not change signals between them.
+	* @return		DLC of the data frame
+  */
+uint8_t CAN_Sensor_Data_Pack(Sensor_HandleTypedef *Sensor, uint8_t data[8])
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	CAN_Map_Set_Signal(SIGNAL_SEQ, Sensor->stat.seq);
+	uint8_t dlc = CAN_Map_Pack(Sensor->sensor_id, data);
+	__set_PRIMASK(primask);
+	return dlc;
+}
+
+/**
+  * @brief  	Update IMU pre-serialised frame.
+	* @param		IMU	   		Pointer to the Sensor_HandleTypedef structure.
+	* @param		aData	   	IMU hex data array.
+  */
+void CAN_IMU_Data_Update(Sensor_HandleTypedef *IMU, uint8_t aData[6])
+{
+	uint8_t data[8];
+	
+	//SYNC packs from the same signals in Rx interrupt, update and pack in one step
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	CAN_IMU_Signal_Update(aData);
+	uint8_t dlc = CAN_Sensor_Data_Pack(IMU, data);
+	__set_PRIMASK(primask);
+	CAN_Sensor_Frame_Update(IMU, CAN_Slave_StdId(CAN_FRAME_IMU_DATA, IMU_ID), dlc, data);
+}
+
+/**
+  * @brief  	Update Encoder pre-serialised frame.
+	* @param		Encoder		Pointer to the Sensor_HandleTypedef structure.
+	* @param		x_pos	   	X axis position.
+	* @param		y_pos	   	Y axis position.
+  */
+void CAN_Encoder_Data_Update(Sensor_HandleTypedef *Encoder, float x_pos, float y_pos)
+{
+	uint8_t data[8];
+	
+	//SYNC packs from the same signals in Rx interrupt, update and pack in one step
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	CAN_Encoder_Signal_Update(x_pos, y_pos);
+	uint8_t dlc = CAN_Sensor_Data_Pack(Encoder, data);
+	__set_PRIMASK(primask);
+	CAN_Sensor_Frame_Update(Encoder, CAN_Slave_StdId(CAN_FRAME_ENC_DATA, ENC_ID), dlc, data);
+}
+
+/**
+  * @brief  	Answer a remote frame with the pre-serialised data frame.
+	* @param		hcan	   	Pointer to the CAN_HandleTypeDef structure.
+	* @param		RxHeader	Remote frame header.
+	* @note 		Called in Rx interrupt, round trip is bounded by bus time.
+	* @return		Answered (1) or not (0)
+  */
+uint8_t CAN_Slave_Remote_Handle(CAN_HandleTypeDef *hcan, CAN_RxHeaderTypeDef *RxHeader)
+{
+	for (uint8_t i = 0; i < SENSOR_NUM; i++)
+	{
+		Sensor_HandleTypedef *Sensor = Slave_Sensor[i];
+		if (Sensor == NULL || !Sensor->frame_valid || Sensor->frame.TxHeader.StdId != RxHeader->StdId)
+			continue;
 		
-		//Divide uint32_t data to uint8_t array
-		uint8_t data[8];
-		data[0] = (*x_raw >> 0) & 0xFF;  
-    data[1] = (*x_raw >> 8) & 0xFF;
-    data[2] = (*x_raw >> 16) & 0xFF;
-    data[3] = (*x_raw >> 24) & 0xFF;
-		data[4] = (*y_raw >> 0) & 0xFF;  
-    data[5] = (*y_raw >> 8) & 0xFF;
-    data[6] = (*y_raw >> 16) & 0xFF;
-    data[7] = (*y_raw >> 24) & 0xFF;
+		//No answer before start sensor
+		if (((!Sensor->freq) && (!Sensor->start_flag)) || Sensor->stop_flag == 1)
+			return 0;
 		
-		//Initialize TxHeader
-		CAN_TxHeader_Init(&Slave_TxHeader, CAN_Command_StdId(ENC_ID, ENC_DATA), ENC_DATA_DLC);
+		return (CAN_Sensor_Frame_Transmit(hcan, Sensor, &Sensor->frame.TxHeader, Sensor->frame.txdata) == HAL_OK);
+	}
+	return 0;
+}
+
+/** @brief    Slave bus state and data rate control
+  ==============================================================================
+								##### Slave Bus Control Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+		(+) Getting the effective period of a Sensor stream.
+		(+) Applying a new rate level from the bus monitor.
+		(+) Counting data frames which left their mailbox.
+		(+) Closing the bus load window.
+		(+) Flushing data frames on bus off, keeping feedback.
+		(+) Reporting bus off recovery.
+	[..]
+		Period is multiplied by 2^level, high priority streams are slowed
+		one level later than the others. Every rate change is reported
+		to master with DIAG_PAGE_RATE, every recovery with DIAG_PAGE_RECOVERY.
+  */
+
+/**
+  * @brief  	Get effective period of a Sensor stream.
+	* @param		Sensor	 	Pointer to the Sensor_HandleTypedef structure.
+	* @return		Period in microsecond
+  */
+uint32_t CAN_Sensor_Rate_Period(Sensor_HandleTypedef *Sensor)
+{
+	uint8_t level = CAN_Bus_Get_Level();
+	if (level && Sensor->stream.priority == STREAM_PRIORITY_HIGH)
+		level--;
+	return Sensor->period_us << level;
+}
+
+/**
+  * @brief  	Bus state and rate control handle.
+	* @param		hcan	   	Pointer to the CAN_HandleTypeDef structure.
+	* @note 		Call this function in while loop, after CAN_Bus_Monitor_Init.
+  */
+void CAN_Slave_Bus_Handle(CAN_HandleTypeDef *hcan)
+{
+	uint8_t event = CAN_Bus_Monitor_Update();
+	CAN_Bus_Stat_Update();
+	
+	//Count data frames which left their mailbox
+	for (uint8_t i = 0; i < SENSOR_NUM; i++)
+	{
+		Sensor_HandleTypedef *Sensor = Slave_Sensor[i];
+		if (Sensor == NULL || !Sensor->stat.mailbox)
+			continue;
+		uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+		CAN_Sensor_Tx_Resolve(hcan, Sensor, Sensor->frame.TxHeader.StdId, 0);
+		__set_PRIMASK(primask);
+	}
+	
+	if (event & BUS_EVENT_RECOVERED)
+		CAN_Slave_Diag_Handle(hcan, DIAG_PAGE_RECOVERY, 0);
+	
+	if (!(event & BUS_EVENT_LEVEL))
+		return;
+	
+	for (uint8_t i = 0; i < SENSOR_NUM; i++)
+	{
+		Sensor_HandleTypedef *Sensor = Slave_Sensor[i];
+		if (Sensor == NULL || !Sensor->stream.enable)
+			continue;
 		
-		//Find empty mailbox
-		mailbox = get_Empty_Mailbox();
-		HAL_CAN_AddTxMessage(hcan, &Slave_TxHeader, data, &mailbox);
-		time = HAL_GetTick();
+		uint32_t period_us = CAN_Sensor_Rate_Period(Sensor);
+		if (period_us == Sensor->stream.period_us)
+			continue;
+		Stream_Set_Period(&Sensor->stream, period_us);
+		CAN_Slave_Diag_Handle(hcan, DIAG_PAGE_RATE, i);
 	}
 }
 
+/**
+  * @brief  	CAN error handle.
+	* @param		hcan	   	Pointer to the CAN_HandleTypeDef structure.
+	* @note 		Call this function in HAL_CAN_ErrorCallback.
+	*						Data frames still in a mailbox are aborted on bus off,
+	*						feedback frames and Tx queue are kept for the recovery.
+  */
+void CAN_Slave_Error_Handle(CAN_HandleTypeDef *hcan)
+{
+	if (!CAN_Bus_Error_Handle(hcan))
+		return;
+	
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	for (uint8_t i = 0; i < SENSOR_NUM; i++)
+	{
+		Sensor_HandleTypedef *Sensor = Slave_Sensor[i];
+		if (Sensor == NULL || !Sensor->stat.mailbox)
+			continue;
+		CAN_Sensor_Tx_Resolve(hcan, Sensor, Sensor->frame.TxHeader.StdId, 1);
+	}
+	__set_PRIMASK(primask);
+}
+
+/** @brief    Slave node function
+  ==============================================================================
+								##### Slave Node Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+		(+) Setting node ID and Rx filters at runtime.
+		(+) Getting node ID.
+		(+) Getting and running the segmented transfer link of this node.
+		(+) Claiming a node ID from the unique ID at start up.
+		(+) Answering claims of the node ID in use.
+	[..]
+		Filter bank 0 accepts every FUNC_NMT frame, bank 1 the commands
+		to this node, bank 2 the remote frames polling data of this node,
+		bank 3 every FUNC_MGMT frame, bank 4 the stop commands to this node,
+		bank 5 the segmented transfer frames to this node.
+  */
+
+/**
+  * @brief  	Set node ID and configure Rx filters.
+	* @param		hcan	   	Pointer to the CAN_HandleTypeDef structure.
+	* @param		node_id	 	Node ID, 0 to NODE_NUM-1.
+	* @note 		Call this function before CAN_Slave_Bitrate_Init,
+	*						it can be called again at runtime to move the node,
+	*						a segmented transfer in progress is dropped then.
+  */
+void CAN_Slave_Node_Init(CAN_HandleTypeDef *hcan, uint8_t node_id)
+{
+	uint32_t node_mask = (FUNC_MASK << FUNC_POS) | (NODE_MASK << NODE_POS);
+	
+	Slave_Node = node_id & NODE_MASK;
+	CAN_Fifo0_Filter_Config(hcan, &Slave_Filter, 0, CAN_STDID(FUNC_NMT, 0, 0, 0), FUNC_MASK << FUNC_POS);
+	CAN_Fifo0_Filter_Config(hcan, &Slave_Filter, 1, CAN_STDID(FUNC_CMD, Slave_Node, 0, 0), node_mask);
+	CAN_Fifo0_Filter_Config(hcan, &Slave_Filter, 2, CAN_STDID(FUNC_DATA, Slave_Node, 0, 0), node_mask);
+	CAN_Fifo0_Filter_Config(hcan, &Slave_Filter, 3, CAN_STDID(FUNC_MGMT, 0, 0, 0), FUNC_MASK << FUNC_POS);
+	CAN_Fifo0_Filter_Config(hcan, &Slave_Filter, 4, CAN_STDID(FUNC_EMCY, Slave_Node, 0, 0), node_mask);
+	CAN_Fifo0_Filter_Config(hcan, &Slave_Filter, 5, CAN_STDID(FUNC_BULK, Slave_Node, 0, 0), node_mask);
+	
+	CAN_Transfer_Init(&Slave_Transfer, hcan, CAN_Frame_StdId(CAN_FRAME_BULK_SLAVE, Slave_Node, SLAVE_ID),
+										CAN_Frame_StdId(CAN_FRAME_BULK_MASTER, Slave_Node, SLAVE_ID), Slave_Transfer_Buf, TRANSFER_BUFFER_SIZE);
+	CAN_Transfer_Config(&Slave_Transfer, CAN_Param_Get_U32(PARAM_TP_BLOCK), CAN_Param_Get_U32(PARAM_TP_STMIN));
+}
+
+/**
+  * @brief  	Get node ID.
+	* @return		Node ID
+  */
+uint8_t CAN_Slave_Get_Node(void)
+{
+	return Slave_Node;
+}
+
+/**
+  * @brief  	Get segmented transfer link of this node.
+	* @note 		Send with CAN_Transfer_Send, receive in CAN_Transfer_RxCplt_Callback.
+	* @return		Pointer to the CAN_Transfer_HandleTypeDef structure
+  */
+CAN_Transfer_HandleTypeDef *CAN_Slave_Get_Transfer(void)
+{
+	return &Slave_Transfer;
+}
+
+/**
+  * @brief  	Segmented transfer handle.
+	* @note 		Call this function in while loop, and again after CAN_Bulk_Rx_Handle
+	*						or a Tx mailbox complete callback.
+  */
+void CAN_Slave_Transfer_Handle(void)
+{
+	if (Slave_Transfer.hcan != NULL)
+		CAN_Transfer_Handle(&Slave_Transfer);
+}
+
+/**
+  * @brief  	Hash the 96 bit unique ID.
+	* @return		CRC32 of the unique ID
+  */
+uint32_t CAN_Slave_UID_Hash(void)
+{
+	uint32_t uid[3] = {HAL_GetUIDw0(), HAL_GetUIDw1(), HAL_GetUIDw2()};
+	return Flash_Config_CRC32((const uint8_t *)uid, sizeof(uid));
+}
+
+/**
+  * @brief  	Wait during a claim, return early on conflict.
+	* @param		us	   	Time to wait in microsecond.
+  */
+static void CAN_Node_Claim_Wait(uint32_t us)
+{
+	uint32_t start = Timebase_Get_Us();
+	while (!Node_Conflict && (Timebase_Get_Us() - start) < us);
+}
+
+/**
+  * @brief  	Claim a node ID and announce it with a boot-up frame.
+	* @param		hcan	   	Pointer to the CAN_HandleTypeDef structure.
+	* @param		config	 	Flash configuration, node ID is updated and saved when claimed.
+	* @note 		Call this function after HAL_CAN_Start and Rx notification.
+	*						Start up is delayed NODE_CLAIM_WAIT_MS plus backoff per busy node ID.
+	* @return		HAL_OK, HAL_ERROR if every node ID is busy
+  */
+HAL_StatusTypeDef CAN_Slave_Node_Claim(CAN_HandleTypeDef *hcan, Flash_Config_TypeDef *config)
+{
+	Node_Hash = CAN_Slave_UID_Hash();
+	
+#if NODE_AUTO_CLAIM
+	uint32_t seed = Node_Hash;
+	uint8_t node = config->node_valid ? (config->node_id & NODE_MASK) : (Node_Hash % NODE_NUM);
+	
+	for (uint8_t attempt = 0; attempt < NODE_NUM; attempt++)
+	{
+		Node_Claim_Id = node;
+		Node_Conflict = 0;
+		Node_Claiming = 1;
+		
+		//Claims of one node share the StdId, arbitration cannot split two slaves sending together.
+		//Backoff seeded by UID hash in microsecond, so slaves powered up together start apart
+		//and the later one hears the earlier claim before sending its own
+		seed = seed * 1664525 + 1013904223;
+		CAN_Node_Claim_Wait((seed >> 8) % NODE_CLAIM_BACKOFF_US);
+		if (!Node_Conflict)
+		{
+			CAN_Node_Mgmt_fb(hcan, node, CAN_FRAME_MGMT_CLAIM, 0);
+			CAN_Node_Claim_Wait(NODE_CLAIM_WAIT_MS * 1000);
+		}
+		Node_Claiming = 0;
+		
+		if (!Node_Conflict)
+		{
+			uint8_t status = (config->node_valid && config->node_id == node) ? NODE_BOOT_STORED : NODE_BOOT_CLAIMED;
+			
+			CAN_Slave_Node_Init(hcan, node);
+			config->node_id = node;
+			config->node_valid = 1;
+			Flash_Config_Save(config);
+			CAN_Node_Mgmt_fb(hcan, node, CAN_FRAME_MGMT_BOOTUP, status);
+			return HAL_OK;
+		}
+		node = (node + 1) % NODE_NUM;
+	}
+	
+	CAN_Node_Mgmt_fb(hcan, Slave_Node, CAN_FRAME_MGMT_BOOTUP, NODE_BOOT_CONFLICT);
+	return HAL_ERROR;
+#else
+	CAN_Node_Mgmt_fb(hcan, Slave_Node, CAN_FRAME_MGMT_BOOTUP, NODE_BOOT_STORED);
+	return HAL_OK;
+#endif
+}
+
+/**
+  * @brief  	Node management frame handle.
+	* @param		RxMessage	 	Pointer to the received FUNC_MGMT frame.
+	* @note 		Called from Rx interrupt, only flags are set here.
+  */
+void CAN_Slave_Node_Rx(CAN_RxMessage *RxMessage)
+{
+	if (getSensor_Id(RxMessage->RxHeader) != SLAVE_ID || RxMessage->RxHeader.DLC < MGMT_CLAIM_DLC)
+		return;
+	
+	CAN_Msg_MGMT_CLAIM_TypeDef Msg;
+	CAN_Msg_MGMT_CLAIM_Unpack(&Msg, RxMessage->rxdata);
+	uint32_t hash = Msg.hash;
+	uint8_t node = getNode_Id(RxMessage->RxHeader);
+	CAN_Frame_TypeDef frame = getFrame(RxMessage->RxHeader);
+	
+	if (Node_Claiming)
+	{
+		//Owner answered, or a slave with lower hash claims the same node
+		if (node == Node_Claim_Id && (frame == CAN_FRAME_MGMT_BOOTUP || hash < Node_Hash))
+			Node_Conflict = 1;
+	}
+	else if (node == Slave_Node && frame == CAN_FRAME_MGMT_CLAIM)
+		Node_Defend = 1;
+}
+
+/**
+  * @brief  	Answer a claim of the node ID in use.
+	* @param		hcan	   	Pointer to the CAN_HandleTypeDef structure.
+	* @note 		Call this function in while loop.
+  */
+void CAN_Slave_Node_Handle(CAN_HandleTypeDef *hcan)
+{
+	if (!Node_Defend)
+		return;
+	
+	Node_Defend = 0;
+	CAN_Node_Mgmt_fb(hcan, Slave_Node, CAN_FRAME_MGMT_BOOTUP, NODE_BOOT_STORED);
+}
+
+/** @brief    Slave parameter function
+  ==============================================================================
+								##### Slave Parameter Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+		(+) Loading runtime parameters at start up.
+		(+) Applying a parameter once after it is changed.
+  */
+
+/**
+  * @brief  Parameter apply Handle function.
+	* @param	index		Changed parameter (PARAM_x), PARAM_NUM if every parameter changed.
+	* @note 	Place this function beforn main function and recompute
+	*					the values derived from parameters (encoder scale, stream phase...) in this.
+  */
+__weak void CAN_Param_Apply_Handle(uint8_t index)
+{
+	
+}
+
+/**
+  * @brief  	Apply a changed parameter.
+	* @param		index		Changed parameter (PARAM_x), PARAM_NUM if every parameter changed.
+  */
+void CAN_Slave_Param_Apply(uint8_t index)
+{
+	if (index == PARAM_TP_BLOCK || index == PARAM_TP_STMIN || index == PARAM_NUM)
+		CAN_Transfer_Config(&Slave_Transfer, CAN_Param_Get_U32(PARAM_TP_BLOCK), CAN_Param_Get_U32(PARAM_TP_STMIN));
+	CAN_Param_Apply_Handle(index);
+}
+
+/**
+  * @brief  	Load runtime parameters and signal mappings, then apply them.
+	* @param		config	 	Pointer to the Flash_Config_TypeDef structure loaded at start up.
+	* @note 		Call this function after the sensor and encoder initialization.
+  */
+void CAN_Slave_Param_Init(const Flash_Config_TypeDef *config)
+{
+	CAN_Param_Load(config);
+	CAN_Map_Load(config);
+	CAN_Slave_Param_Apply(PARAM_NUM);
+}
+
+/**
+  * @brief  	Store parameters, running streams and encoder position.
+	* @param		config	 	Pointer to the Flash_Config_TypeDef structure, save it after.
+  */
+void CAN_Slave_Config_Store(Flash_Config_TypeDef *config)
+{
+	CAN_Param_Store(config);
+	CAN_Map_Store(config);
+	
+	for (uint8_t id = 0; id < FLASH_CONFIG_STREAM_NUM; id++)
+	{
+		Sensor_HandleTypedef *Sensor = (id < SENSOR_NUM) ? Slave_Sensor[id] : NULL;
+		uint8_t running = (Sensor != NULL) && Sensor->start_flag && !Sensor->stop_flag;
+		
+		config->stream_mode[id] = running ? Sensor->mode : FLASH_CONFIG_STREAM_OFF;
+		config->stream_period_us[id] = running ? Sensor->period_us : 0;
+	}
+	config->enc_position[0] = Slave_Assign[0];
+	config->enc_position[1] = Slave_Assign[1];
+}
+
+/** @brief    Slave auto start function
+  ==============================================================================
+								##### Slave Auto Start Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+		(+) Restoring encoder position committed to flash.
+		(+) Starting streams committed to flash without waiting for master.
+		(+) Measuring time to first data after reset (DIAG_PAGE_BOOT).
+	[..]
+		Bit rate and node ID are restored by CAN_Slave_Bitrate_Init and
+		CAN_Slave_Node_Claim, auto start only adds streams and calibration.
+  */
+
+/**
+  * @brief  Restore Handle function.
+	* @note 	Place this function beforn main function
+	*					and call any restore function in this.
+  */
+__weak void CAN_Sensor_Restore_Handle(void)
+{
+	
+}
+
+/**
+  * @brief  	Restore Encoder position committed to flash.
+	* @param		Encoderx 	Pointer to the Encoder_HandleTypeDef structure.
+	* @param		Encodery 	Pointer to the Encoder_HandleTypeDef structure.
+	* @note 		Call this function in CAN_Sensor_Restore_Handle.
+  */
+void CAN_Restore_Encoder(Encoder_HandleTypeDef *Encoderx, Encoder_HandleTypeDef *Encodery)
+{
+	Encoder_Assign_Position(Encoderx, Slave_Assign[0]);
+	Encoder_Assign_Position(Encodery, Slave_Assign[1]);
+}
+
+/**
+  * @brief  	Start streams committed to flash if AUTO_START is set.
+	* @param		config	 	Pointer to the Flash_Config_TypeDef structure loaded at start up.
+	* @note 		Call this function after CAN_Slave_Param_Init and before while loop,
+	*						sensors are started through CAN_Sensor_Start_Handle without feedback.
+  */
+void CAN_Slave_Auto_Start(const Flash_Config_TypeDef *config)
+{
+	//Kept even without auto start, so the next commit does not lose it
+	Slave_Assign[0] = config->enc_position[0];
+	Slave_Assign[1] = config->enc_position[1];
+	if (!CAN_Param_Get_U32(PARAM_AUTO_START))
+		return;
+	
+	CAN_Sensor_Restore_Handle();
+	
+	for (uint8_t id = 0; id < SENSOR_NUM && id < FLASH_CONFIG_STREAM_NUM; id++)
+	{
+		uint8_t mode = config->stream_mode[id];
+		
+		//Same check as batch start, a bad record never starts a stream
+		if (Slave_Sensor[id] == NULL || mode > STREAM_MODE_POLL ||
+				(mode == STREAM_MODE_FREE && !config->stream_period_us[id]))
+			continue;
+		
+		Slave_Start.sensor_id = id;
+		Slave_Start.mode = mode;
+		Slave_Start.period_us = config->stream_period_us[id];
+		Slave_Start.freq = (Slave_Start.period_us >= 1000) ? (uint16_t)(Slave_Start.period_us / 1000) : 1;
+		CAN_Sensor_Start_Handle();
+		Boot_Auto_Started = 1;
+	}
+}
+
+/** @brief    Slave bit rate function
+  ==============================================================================
+								##### Slave Bit Rate Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+		(+) Detecting or applying the saved bit rate at start up.
+		(+) Switching bit rate after a BITRATE request.
+  */
+
+/**
+  * @brief  	Detect bus bit rate or apply the saved one.
+	* @param		hcan	   	Pointer to the CAN_HandleTypeDef structure.
+	* @note 		Call this function after CAN_Slave_Node_Init and before HAL_CAN_Start
+	*						and Rx notification. Start up is delayed BITRATE_DETECT_TIMEOUT_MS
+	*						at most on a quiet bus.
+	* @return		HAL status
+  */
+HAL_StatusTypeDef CAN_Slave_Bitrate_Init(CAN_HandleTypeDef *hcan)
+{
+	Flash_Config_TypeDef config;
+	Flash_Config_Load(&config);
+	uint32_t bitrate = config.bitrate;
+	
+#if BITRATE_AUTO_DETECT
+	const uint32_t list[] = BITRATE_DETECT_LIST;
+	uint32_t candidate[sizeof(list) / sizeof(list[0]) + 1];
+	uint8_t num = 0;
+	
+	//Saved bit rate first, it is the most likely one
+	candidate[num++] = config.bitrate;
+	for (uint8_t i = 0; i < sizeof(list) / sizeof(list[0]); i++)
+		if (list[i] != config.bitrate)
+			candidate[num++] = list[i];
+	
+	uint32_t start = Timebase_Get_Us();
+	uint32_t detected = CAN_Bitrate_Detect(hcan, candidate, num, config.sample_point,
+																					BITRATE_DETECT_DWELL_MS, BITRATE_DETECT_TIMEOUT_MS);
+	Bitrate_Detect_us = Timebase_Get_Us() - start;
+	Bitrate_Detected = (detected != 0);
+	if (detected)
+		bitrate = detected;
+#endif
+	
+	return CAN_Set_Bitrate(hcan, bitrate, config.sample_point);
+}
+
+/**
+  * @brief  	Bit rate switching handle.
+	* @param		hcan	   	Pointer to the CAN_HandleTypeDef structure.
+	* @note 		Call this function in while loop.
+  */
+void CAN_Slave_Bitrate_Handle(CAN_HandleTypeDef *hcan)
+{
+	if (!Bitrate_Pending)
+		return;
+	
+	//Wait for feedback to leave the mailboxes
+	if (HAL_CAN_GetTxMailboxesFreeLevel(hcan) < 3 && (Timebase_Get_Us() - Bitrate_Request_us) < BITRATE_SWITCH_US)
+		return;
+	
+	Bitrate_Pending = 0;
+	if (CAN_Set_Bitrate(hcan, Bitrate_New, Bitrate_Sample) != HAL_OK || !Bitrate_Save)
+		return;
+	
+	Flash_Config_TypeDef config;
+	Flash_Config_Load(&config);
+	config.bitrate = Bitrate_New;
+	config.sample_point = Bitrate_Sample;
+	Flash_Config_Save(&config);
+}
+
+/** @brief    Slave diagnostics report to master
+  ==============================================================================
+								##### Slave Diagnostics Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+		(+) Answering a diagnostics request by page and index.
+  */
+
+/**
+  * @brief  	Put a 16 bit value to data array, saturate bigger value.
+	* @param		data	   	Data array to store (LSB first).
+	* @param		value	   	Value to store.
+  */
+void CAN_Diag_Put_U16(uint8_t *data, uint32_t value)
+{
+	if (value > 0xFFFF)
+		value = 0xFFFF;
+	data[0] = value & 0xFF;
+	data[1] = (value >> 8) & 0xFF;
+}
+
+/**
+  * @brief  	Put a 24 bit value to data array, saturate bigger value.
+	* @param		data	   	Data array to store (LSB first).
+	* @param		value	   	Value to store.
+  */
+void CAN_Diag_Put_U24(uint8_t *data, uint32_t value)
+{
+	if (value > 0xFFFFFF)
+		value = 0xFFFFFF;
+	data[0] = value & 0xFF;
+	data[1] = (value >> 8) & 0xFF;
+	data[2] = (value >> 16) & 0xFF;
+}
+
+/**
+  * @brief  	Put a 32 bit value to data array.
+	* @param		data	   	Data array to store (LSB first).
+	* @param		value	   	Value to store.
+  */
+void CAN_Diag_Put_U32(uint8_t *data, uint32_t value)
+{
+	data[0] = value & 0xFF;
+	data[1] = (value >> 8) & 0xFF;
+	data[2] = (value >> 16) & 0xFF;
+	data[3] = (value >> 24) & 0xFF;
+}
+
+/**
+  * @brief  	Answer a diagnostics request.
+	* @param		hcan	   	Pointer to the CAN_HandleTypeDef structure.
+	* @param		page	   	Diagnostics page (DIAG_PAGE_x).
+	* @param		index	   	Index in page.
+	* @note 		Unknown page or index is ignored.
+  */
+void CAN_Slave_Diag_Handle(CAN_HandleTypeDef *hcan, uint8_t page, uint8_t index)
+{
+	uint8_t data[6] = {0};
+	
+	switch (page)
+	{
+		case DIAG_PAGE_STREAM:
+		{
+			if (index >= SENSOR_NUM || Slave_Sensor[index] == NULL)
+				return;
+			Stream_HandleTypeDef *stream = &Slave_Sensor[index]->stream;
+			CAN_Diag_Put_U16(&data[0], stream->run_count > 1 ? stream->period_min_us : 0);
+			CAN_Diag_Put_U16(&data[2], stream->period_max_us);
+			CAN_Diag_Put_U16(&data[4], Stream_Get_Period_Avg(stream));
+			break;
+		}
+		case DIAG_PAGE_STALE:
+		{
+			if (index >= SENSOR_NUM || Slave_Sensor[index] == NULL)
+				return;
+			CAN_Diag_Put_U32(&data[0], Slave_Sensor[index]->stat.aborted);
+			CAN_Diag_Put_U16(&data[4], Slave_Sensor[index]->stream.missed);
+			break;
+		}
+		case DIAG_PAGE_RATE:
+		{
+			if (index >= SENSOR_NUM || Slave_Sensor[index] == NULL)
+				return;
+			CAN_Diag_Put_U32(&data[0], Slave_Sensor[index]->stream.enable ? Slave_Sensor[index]->stream.period_us : 0);
+			data[4] = CAN_Bus_Get_Level();
+			data[5] = CAN_Bus_Get_Monitor()->tec;
+			break;
+		}
+		case DIAG_PAGE_BUS:
+		{
+			CAN_Bus_Monitor_HandleTypeDef *monitor = CAN_Bus_Get_Monitor();
+			data[0] = monitor->tec;
+			data[1] = monitor->rec;
+			CAN_Diag_Put_U16(&data[2], monitor->mailbox_full);
+			CAN_Diag_Put_U16(&data[4], monitor->arb_lost);
+			break;
+		}
+		case DIAG_PAGE_BITRATE:
+		{
+			CAN_Diag_Put_U16(&data[0], CAN_Get_Bitrate(hcan) / 1000);
+			CAN_Diag_Put_U16(&data[2], Bitrate_Detect_us / 1000);
+			data[4] = Bitrate_Detected;
+			break;
+		}
+		case DIAG_PAGE_BOOT:
+		{
+			CAN_Diag_Put_U32(&data[0], Boot_First_Data_ms);
+			data[4] = Boot_Auto_Started;
+			data[5] = Flash_Config_Get_Records();
+			break;
+		}
+		case DIAG_PAGE_LOSS:
+		{
+			uint8_t sensor = index & 0x0F;
+			if (sensor >= SENSOR_NUM || Slave_Sensor[sensor] == NULL)
+				return;
+			
+			CAN_Stream_Stat_TypeDef *stat = &Slave_Sensor[sensor]->stat;
+			uint32_t count;
+			switch (index >> 4)
+			{
+				case STREAM_STAT_PRODUCED:		count = stat->produced;			break;
+				case STREAM_STAT_QUEUED:			count = stat->queued;				break;
+				case STREAM_STAT_TRANSMITTED:	count = stat->transmitted;	break;
+				case STREAM_STAT_ABORTED:			count = stat->aborted;			break;
+				case STREAM_STAT_DROPPED:			count = stat->dropped;			break;
+				default:											return;
+			}
+			CAN_Diag_Put_U32(&data[0], count);
+			data[4] = stat->seq;
+			data[5] = (stat->mailbox & CAN_TX_MAILBOX0 ? 1 : 0) + (stat->mailbox & CAN_TX_MAILBOX1 ? 1 : 0) +
+								(stat->mailbox & CAN_TX_MAILBOX2 ? 1 : 0);
+			break;
+		}
+		case DIAG_PAGE_LOAD:
+		{
+			CAN_Bus_Stat_HandleTypeDef *stat = CAN_Bus_Get_Stat();
+			if (index == 0)
+			{
+				CAN_Diag_Put_U16(&data[0], stat->load_last);
+				CAN_Diag_Put_U16(&data[2], stat->load_avg);
+				CAN_Diag_Put_U16(&data[4], stat->load_peak);
+			}
+			else if (index == 1)
+			{
+				CAN_Diag_Put_U32(&data[0], stat->rx_frames);
+				CAN_Diag_Put_U16(&data[4], stat->untracked);
+			}
+			else if (index == 2)
+			{
+				CAN_Diag_Put_U32(&data[0], stat->tx_frames);
+				data[4] = stat->entry_num;
+			}
+			else
+				return;
+			break;
+		}
+		case DIAG_PAGE_TRAFFIC:
+		{
+			CAN_Bus_Stat_EntryTypeDef *entry = CAN_Bus_Stat_Get_Entry(index & 0x1F);
+			if (entry == NULL)
+				return;
+			
+			switch (index >> 5)
+			{
+				case 0:
+					CAN_Diag_Put_U32(&data[0], entry->id);
+					data[4] = entry->dir;
+					break;
+				case 1:
+					CAN_Diag_Put_U32(&data[0], entry->frames);
+					CAN_Diag_Put_U16(&data[4], entry->bytes);
+					break;
+				case 2:
+					CAN_Diag_Put_U16(&data[0], entry->frames > 1 ? entry->gap_min_us : 0);
+					CAN_Diag_Put_U16(&data[2], entry->gap_max_us);
+					CAN_Diag_Put_U16(&data[4], CAN_Bus_Stat_Get_Gap_Avg(entry));
+					break;
+				default:
+					return;
+			}
+			break;
+		}
+#if LATENCY_ENABLE
+		case DIAG_PAGE_LATENCY:
+		{
+			CAN_Latency_HistTypeDef *hist = CAN_Latency_Get_Hist(index >> 4, (index >> 2) & 0x03);
+			uint8_t bucket = (index & 0x03) * 3;
+			if (hist == NULL)
+				return;
+			
+			for (uint8_t i = 0; i < 3 && bucket + i < LATENCY_BUCKET_NUM; i++)
+				CAN_Diag_Put_U16(&data[2 * i], hist->bucket[bucket + i]);
+			break;
+		}
+		case DIAG_PAGE_LATENCY_MAX:
+		{
+			if (index == 0xFF)
+			{
+				CAN_Diag_Put_U32(&data[0], CAN_Latency_Get_Lost());
+				data[4] = LATENCY_BUCKET_SHIFT;
+				data[5] = SystemCoreClock / 1000000;
+				break;
+			}
+			
+			CAN_Latency_HistTypeDef *hist = CAN_Latency_Get_Hist(index >> 4, (index >> 2) & 0x03);
+			if (hist == NULL)
+				return;
+			CAN_Diag_Put_U32(&data[0], Timebase_Cycle_To_Us(hist->max));
+			CAN_Diag_Put_U16(&data[4], hist->count);
+			break;
+		}
+#endif
+#if LOOP_PROFILER_ENABLE
+		case DIAG_PAGE_PROFILE:
+		{
+			Loop_Profiler_StatTypeDef *stat = Loop_Profiler_Get_Stat(index & 0x0F);
+			if (stat == NULL)
+				return;
+			
+			switch (index >> 4)
+			{
+				case 0:
+					CAN_Diag_Put_U32(&data[0], stat->calls);
+					CAN_Diag_Put_U16(&data[4], Timebase_Cycle_To_Us(stat->min));
+					break;
+				case 1:
+					CAN_Diag_Put_U32(&data[0], Timebase_Cycle_To_Us(stat->max));
+					CAN_Diag_Put_U16(&data[4], Timebase_Cycle_To_Us(Loop_Profiler_Get_Avg(stat)));
+					break;
+				case 2:
+					//Both fit in 24 bit up to 233 ms at 72 MHz, far above any task
+					CAN_Diag_Put_U24(&data[0], Loop_Profiler_Get_Avg(stat));
+					CAN_Diag_Put_U24(&data[3], stat->min);
+					break;
+				case 3:
+				{
+					Loop_Profiler_HandleTypeDef *profiler = Loop_Profiler_Get();
+					if ((index & 0x0F) != LOOP_PROFILER_LOOP)
+						return;
+					CAN_Diag_Put_U32(&data[0], Timebase_Cycle_To_Us(profiler->jitter_max));
+					CAN_Diag_Put_U16(&data[4], stat->calls > 1 ? Timebase_Cycle_To_Us(profiler->jitter_sum / (stat->calls - 1)) : 0);
+					break;
+				}
+				default:
+					return;
+			}
+			break;
+		}
+#endif
+#if IRQ_PROFILER_ENABLE
+		case DIAG_PAGE_IRQ:
+		{
+			Irq_Profiler_StatTypeDef *stat = Irq_Profiler_Get_Stat(index & 0x0F);
+			if (stat == NULL)
+				return;
+			
+			switch (index >> 4)
+			{
+				case 0:
+					CAN_Diag_Put_U32(&data[0], stat->entries);
+					data[4] = stat->nest_max;
+					break;
+				case 1:
+					CAN_Diag_Put_U32(&data[0], (uint32_t)(stat->cycles / (SystemCoreClock / TIMEBASE_TICK_HZ)));
+					CAN_Diag_Put_U16(&data[4], Timebase_Cycle_To_Us(stat->max));
+					break;
+				case 2:
+					CAN_Diag_Put_U32(&data[0], stat->max);
+					CAN_Diag_Put_U16(&data[4], Timebase_Cycle_To_Us(stat->max_total));
+					break;
+				case 3:
+				{
+					Irq_Profiler_HandleTypeDef *profiler = Irq_Profiler_Get();
+					if ((index & 0x0F) != IRQ_PROFILER_ALL)
+						return;
+					CAN_Diag_Put_U16(&data[0], profiler->load_last);
+					CAN_Diag_Put_U16(&data[2], profiler->load_peak);
+					break;
+				}
+				default:
+					return;
+			}
+			break;
+		}
+#endif
+		case DIAG_PAGE_TASK:
+		{
+			Task_HandleTypeDef *task = Task_Get(index & 0x0F);
+			if (task == NULL)
+				return;
+			
+			switch (index >> 4)
+			{
+				case 0:
+					CAN_Diag_Put_U32(&data[0], task->runs);
+					CAN_Diag_Put_U16(&data[4], task->missed);
+					break;
+				case 1:
+					CAN_Diag_Put_U32(&data[0], task->response_max_us);
+					CAN_Diag_Put_U16(&data[4], task->overrun);
+					break;
+				case 2:
+					CAN_Diag_Put_U32(&data[0], task->deadline_us);
+					data[4] = task->priority;
+					data[5] = task->period_us / 1000;
+					break;
+				default:
+					return;
+			}
+			break;
+		}
+		case DIAG_PAGE_RECOVERY:
+		{
+			CAN_Bus_Monitor_HandleTypeDef *monitor = CAN_Bus_Get_Monitor();
+			CAN_Diag_Put_U16(&data[0], monitor->bus_off);
+			CAN_Diag_Put_U16(&data[2], monitor->recovery_last_us);
+			CAN_Diag_Put_U16(&data[4], monitor->recovery_max_us);
+			break;
+		}
+		default:
+			return;
+	}
+	CAN_Diag_fb(hcan, page, index, data);
+}
+
+/** @brief    Slave transmiting synchronous data to master
+  ==============================================================================
+							##### Slave Synchronous Transmit Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+		(+) Transmiting data latched on SYNC.
+	[..]
+		These functions are called from CAN_Sensor_Sync_Handle in Rx interrupt,
+		so they use their own TxHeader and never wait for a mailbox.
+  */
+
+/**
+  * @brief  	Check a sensor is streaming in synchronous mode.
+	* @param		Sensor	 	Pointer to the Sensor_HandleTypedef structure.
+	* @return		Streaming (1) or not (0)
+  */
+uint8_t CAN_Sync_Sensor_isActive(Sensor_HandleTypedef *Sensor)
+{
+	if ((!Sensor->freq) && (!Sensor->start_flag))
+		return 0;
+	if (Sensor->stop_flag == 1)
+		return 0;
+	return (Sensor->mode == STREAM_MODE_SYNC);
+}
+
+/**
+  * @brief  	Transmit IMU hex data latched on SYNC.
+	* @param		hcan	   	Pointer to the CAN_HandleTypeDef structure.
+	* @param		IMU	   		Pointer to the Sensor_HandleTypedef structure.
+	* @param		aData	   	IMU hex data array.
+  */
+void CAN_Sync_IMU_Transmit(CAN_HandleTypeDef *hcan, Sensor_HandleTypedef *IMU, uint8_t aData[6])
+{
+	if (!CAN_Sync_Sensor_isActive(IMU))
+		return;
+	
+	CAN_TxHeaderTypeDef TxHeader;
+	uint8_t 						data[8];
+	
+	//Latch the newest sample
+	CAN_IMU_Signal_Update(aData);
+	uint8_t dlc = CAN_Sensor_Data_Pack(IMU, data);
+	
+	CAN_TxHeader_Init(&TxHeader, CAN_Slave_StdId(CAN_FRAME_IMU_DATA, IMU_ID), dlc);
+	CAN_Sensor_Frame_Transmit(hcan, IMU, &TxHeader, data);
+}
+
+/**
+  * @brief  	Transmit Encoder position latched on SYNC.
+	* @param		hcan	   	Pointer to the CAN_HandleTypeDef structure.
+	* @param		Encoder		Pointer to the Sensor_HandleTypedef structure.
+	* @param		x_pos	   	X axis position.
+	* @param		y_pos	   	Y axis position.
+  */
+void CAN_Sync_Encoder_Transmit(CAN_HandleTypeDef *hcan, Sensor_HandleTypedef *Encoder, float x_pos, float y_pos)
+{
+	if (!CAN_Sync_Sensor_isActive(Encoder))
+		return;
+	
+	CAN_TxHeaderTypeDef TxHeader;
+	uint8_t 						data[8];
+	
+	CAN_Encoder_Signal_Update(x_pos, y_pos);
+	uint8_t dlc = CAN_Sensor_Data_Pack(Encoder, data);
+	CAN_TxHeader_Init(&TxHeader, CAN_Slave_StdId(CAN_FRAME_ENC_DATA, ENC_ID), dlc);
+	CAN_Sensor_Frame_Transmit(hcan, Encoder, &TxHeader, data);
+}
+
+/** @brief    Slave clock synchronisation with master
+  ==============================================================================
+							##### Clock Synchronisation Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+		(+) Pairing SYNC capture time with master transmit time.
+		(+) Estimating master clock offset and drift.
+		(+) Converting local time to master time.
+	[..]
+		Master sends SYNC n with its transmit time of SYNC n-1 (two step method),
+		slave pairs it with the local capture time of SYNC n-1.
+		Two consecutive pairs give the drift, the newest pair gives the offset.
+  */
+
+/**
+  * @brief  	Update offset and drift from a SYNC message.
+	* @param		Sync	   	Pointer to the CAN_Sync_HandleTypeDef structure.
+	* @param		RxMessage	SYNC message with RxHeader.Timestamp as local capture time.
+  */
+void CAN_Sync_Update(CAN_Sync_HandleTypeDef *Sync, CAN_RxMessage RxMessage)
+{
+	CAN_Msg_SYNC_TypeDef Msg;
+	CAN_Msg_SYNC_Unpack(&Msg, RxMessage.rxdata);
+	uint8_t seq = Msg.seq;
+	
+	//Master time of previous SYNC is available
+	if (RxMessage.RxHeader.DLC >= SYNC_DLC && Sync->capture_valid && (uint8_t)(Sync->seq + 1) == seq)
+	{
+		uint32_t master_us = Msg.master_us;
+		
+		if (Sync->ref_valid)
+		{
+			int32_t local_diff = (int32_t)(Sync->capture_us - Sync->local_ref);
+			int32_t master_diff = (int32_t)(master_us - Sync->master_ref);
+			if (local_diff > 0)
+			{
+				//Low pass filter drift to reduce capture jitter
+				int32_t drift = (int32_t)(((int64_t)(master_diff - local_diff) * 1000000000) / local_diff);
+				Sync->drift_ppb += (drift - Sync->drift_ppb) / 4;
+			}
+		}
+		
+		Sync->local_ref = Sync->capture_us;
+		Sync->master_ref = master_us;
+		Sync->ref_valid = 1;
+	}
+	
+	//Store this SYNC for the next pairing
+	Sync->seq = seq;
+	Sync->capture_us = RxMessage.RxHeader.Timestamp;
+	Sync->capture_valid = 1;
+}
+
+/**
+  * @brief  	Convert local time to master time.
+	* @param		local_us	Local time from Timebase_Get_Us.
+	* @return		Drift corrected master time, local time if no SYNC pair yet
+  */
+uint32_t CAN_Sync_Local_To_Master(uint32_t local_us)
+{
+	if (!Slave_Sync.ref_valid)
+		return local_us;
+	
+	int32_t diff = (int32_t)(local_us - Slave_Sync.local_ref);
+	int32_t correction = (int32_t)(((int64_t)diff * Slave_Sync.drift_ppb) / 1000000000);
+	return Slave_Sync.master_ref + diff + correction;
+}
+
+/**
+  * @brief  	Get current master time.
+	* @return		Drift corrected master time in microsecond
+  */
+uint32_t CAN_Sync_Get_Master_Us(void)
+{
+	return CAN_Sync_Local_To_Master(Timebase_Get_Us());
+}
+
+/**
+  * @brief  	Get estimated master clock drift.
+	* @return		Drift in part per billion
+  */
+int32_t CAN_Sync_Get_Drift(void)
+{
+	return Slave_Sync.drift_ppb;
+}
+
 /** @brief    Slave report error to master
   ==============================================================================
 								##### Error Report Functions #####
@@ -609,20 +2610,27 @@ void CAN_Encoder_Data_Transmit(CAN_HandleTypeDef *hcan, Sensor_HandleTypedef *En
 
 /**
   * @brief  	Send error report.
+	* @note 		Tag is echoed when reporting while a tagged command is handled.
 	* @param		hcan	   	Pointer to the CAN_HandleTypeDef structure.
 	* @param		Sensor 		Pointer to the Sensor_HandleTypedef structure.
   */
 void CAN_Sensor_ErrorFb(CAN_HandleTypeDef *hcan, Sensor_HandleTypedef Sensor)
 {
 	//Initialize TxHeader
-	CAN_TxHeader_Init(&Slave_TxHeader, CAN_Command_StdId(Sensor.sensor_id, ERROR_ID), ERROR_DLC);
+	CAN_TxHeader_Init(&Slave_TxHeader, CAN_Slave_StdId(CAN_FRAME_ERROR, Sensor.sensor_id), ERROR_DLC);
+	
+	uint8_t data[8] = {0};
+	
+	//Echo tag of the command
+	Slave_TxHeader.DLC = CAN_Slave_Tag_Put(data, Slave_TxHeader.DLC);
 	
 	//Find empty mailbox
 	mailbox = get_Empty_Mailbox();
-	if (HAL_CAN_AddTxMessage(hcan, &Slave_TxHeader, NULL, &mailbox) != HAL_OK)
+	if (CAN_Transmit(hcan, &Slave_TxHeader, data, &mailbox) != HAL_OK)
 	{
 		//If failed, store message in queue for next transmit
 		CAN_TxHeader_Copy(&Slave_TxMessage.TxHeader, Slave_TxHeader);
+		CAN_Data_Copy(Slave_TxMessage.txdata, data);
 		CAN_EnTxQueue(&Slave_TxQueue, Slave_TxMessage);
 	}
 }
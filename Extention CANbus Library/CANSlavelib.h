@@ -15,26 +15,124 @@
 #include "CANConfig.h"
 #include "EncoderPosition.h"
 #include "IMU.h"
+#include "Timebase.h"
+#include "StreamScheduler.h"
+#include "CANBusMonitor.h"
+#include "CANBusStat.h"
+#include "CANLatency.h"
+#include "FlashConfig.h"
+#include "LoopProfiler.h"
+#include "IrqProfiler.h"
+#include "TaskScheduler.h"
+#include "CANTransferlib.h"
+#include "CANParamlib.h"
+#include "CANMaplib.h"
+#include "CANCodeclib.h"
+
+/**
+  * @brief  Frame table row, generated from CAN_FRAME_TABLE
+	* @param	func	Function (FUNC_x)
+	* @param	cmd		Command field
+	* @param	dlc		Data length
+  */
+typedef struct
+{
+	uint8_t	func;
+	uint8_t	cmd;
+	uint8_t	dlc;
+}CAN_Frame_Info_TypeDef;
+
+#define CAN_FRAME_INFO(name, func, cmd, dlc)		{(func), (cmd), (dlc)},
+
+/**
+  * @brief  Sensor start request, from a Start or a batch start command
+	* @param	sensor_id	Sensor ID
+	* @param	freq			Period value sent by master
+	* @param	mode			Stream mode (STREAM_MODE_x)
+	* @param	period_us	Period in microsecond
+  */
+typedef struct
+{
+	uint8_t		sensor_id;
+	uint16_t	freq;
+	uint8_t		mode;
+	uint32_t	period_us;
+}CAN_Start_RequestTypeDef;
+
+/**
+  * @brief  Stream statistic struct
+	* @param	seq					Sequence of the next frame, packed as SIGNAL_SEQ
+	* @param	produced		Frame handed to the bus (periodic release, SYNC or remote frame)
+	* @param	queued			Frame loaded in a mailbox
+	* @param	transmitted	Frame seen leaving its mailbox, with automatic retransmission
+	*											only a transmission or an abort ends a request
+	* @param	aborted			Pending frame replaced by a fresher one or flushed on bus off
+	* @param	dropped			Frame not loaded, bus off or every mailbox busy
+	* @param	mailbox			Mailboxes still holding a frame of the stream (CAN_TX_MAILBOXx)
+  */
+typedef struct
+{
+	uint8_t		seq;
+	uint32_t	produced;
+	uint32_t	queued;
+	uint32_t	transmitted;
+	uint32_t	aborted;
+	uint32_t	dropped;
+	uint8_t		mailbox;
+}CAN_Stream_Stat_TypeDef;
 
 /**
   * @brief  TxMessage struct
 	* @param	sensor_it	Sensor ID
 	* @param	freq			Frequency
+	* @param	mode			Stream mode (STREAM_MODE_FREE or STREAM_MODE_SYNC)
+	* @param	period_us	Period requested by master, stream period is longer under congestion
+	* @param	stream		Periodic stream released by the stream scheduler
+	* @param	frame			Newest data frame, ready to load in a mailbox
+	* @param	stat			Sequence and loss counters of the data stream
   */
 typedef struct
 {
-	uint32_t	sensor_id;
-	uint16_t	freq;
-	uint8_t		start_flag;
-	uint8_t		stop_flag;
+	uint32_t							sensor_id;
+	uint16_t							freq;
+	uint8_t								start_flag;
+	uint8_t								stop_flag;
+	uint8_t								mode;
+	uint32_t							period_us;
+	Stream_HandleTypeDef	stream;
+	CAN_TxMessage					frame;
+	uint8_t								frame_valid;
+	CAN_Stream_Stat_TypeDef	stat;
 }Sensor_HandleTypedef;
 
+/**
+  * @brief  Clock synchronisation struct
+	* @param	seq					Sequence number of the last SYNC
+	* @param	capture_us	Local time the last SYNC was received
+	* @param	local_ref		Local time of the reference point
+	* @param	master_ref	Master time of the reference point
+	* @param	drift_ppb		Master clock drift relative to local clock (part per billion)
+  */
+typedef struct
+{
+	uint8_t		seq;
+	uint8_t		capture_valid;
+	uint32_t	capture_us;
+	uint8_t		ref_valid;
+	uint32_t	local_ref;
+	uint32_t	master_ref;
+	int32_t		drift_ppb;
+}CAN_Sync_HandleTypeDef;
+
 /* Initialization functions  **************************************************/
-void CAN_Sensor_Init(Sensor_HandleTypedef *Sensor, uint32_t sensor_id);
+HAL_StatusTypeDef CAN_Sensor_Init(Sensor_HandleTypedef *Sensor, uint32_t sensor_id);
+HAL_StatusTypeDef CAN_Sensor_Stream_Config(Sensor_HandleTypedef *Sensor, uint8_t priority, uint32_t phase_us);
 
 /* Receiving functions through CAN protocol  **********************************/
 void CAN_Slave_FIFO0_RxMessage(CAN_HandleTypeDef *hcan);
 void CAN_Slave_FIFO0_Recieve_Cmd_Handle(CAN_HandleTypeDef *hcan);
+void CAN_Slave_Tag_Latch(void);
+uint8_t CAN_Slave_Tag_Put(uint8_t *data, uint8_t dlc);
 
 /* Sensor control functions through CAN protocol  *****************************/
 void CAN_Start_Encoder(Sensor_HandleTypedef *Sensor, TIM_HandleTypeDef *htim1, TIM_HandleTypeDef *htim2);
@@ -54,6 +152,57 @@ void CAN_Slave_FIFO0_ReFb_Handle(CAN_HandleTypeDef *hcan);
 void CAN_IMU_Data_Transmit(CAN_HandleTypeDef *hcan, Sensor_HandleTypedef *IMU, uint8_t aData[6]);
 void CAN_Encoder_Data_Transmit(CAN_HandleTypeDef *hcan, Sensor_HandleTypedef *Encoder, float x_pos, float y_pos);
 
+/* Pre-serialised data frame functions  ***************************************/
+void CAN_IMU_Data_Update(Sensor_HandleTypedef *IMU, uint8_t aData[6]);
+void CAN_Encoder_Data_Update(Sensor_HandleTypedef *Encoder, float x_pos, float y_pos);
+void CAN_Slave_Signal_Update(void);
+void CAN_IMU_Signal_Update(uint8_t aData[6]);
+void CAN_Encoder_Signal_Update(float x_pos, float y_pos);
+uint8_t CAN_Sensor_Data_Pack(Sensor_HandleTypedef *Sensor, uint8_t data[8]);
+uint8_t CAN_Slave_Remote_Handle(CAN_HandleTypeDef *hcan, CAN_RxHeaderTypeDef *RxHeader);
+HAL_StatusTypeDef CAN_Sensor_Frame_Transmit(CAN_HandleTypeDef *hcan, Sensor_HandleTypedef *Sensor, CAN_TxHeaderTypeDef *TxHeader, uint8_t *data);
+
+/* Synchronous data transmit function  ****************************************/
+void CAN_Sync_IMU_Transmit(CAN_HandleTypeDef *hcan, Sensor_HandleTypedef *IMU, uint8_t aData[6]);
+void CAN_Sync_Encoder_Transmit(CAN_HandleTypeDef *hcan, Sensor_HandleTypedef *Encoder, float x_pos, float y_pos);
+
+/* Bus state and rate control functions  **************************************/
+uint32_t CAN_Sensor_Rate_Period(Sensor_HandleTypedef *Sensor);
+void CAN_Slave_Bus_Handle(CAN_HandleTypeDef *hcan);
+void CAN_Slave_Error_Handle(CAN_HandleTypeDef *hcan);
+
+/* Node functions  ************************************************************/
+void CAN_Slave_Node_Init(CAN_HandleTypeDef *hcan, uint8_t node_id);
+uint8_t CAN_Slave_Get_Node(void);
+CAN_Transfer_HandleTypeDef *CAN_Slave_Get_Transfer(void);
+void CAN_Slave_Transfer_Handle(void);
+uint32_t CAN_Slave_UID_Hash(void);
+HAL_StatusTypeDef CAN_Slave_Node_Claim(CAN_HandleTypeDef *hcan, Flash_Config_TypeDef *config);
+void CAN_Slave_Node_Rx(CAN_RxMessage *RxMessage);
+void CAN_Slave_Node_Handle(CAN_HandleTypeDef *hcan);
+
+/* Parameter functions  *******************************************************/
+void CAN_Slave_Param_Init(const Flash_Config_TypeDef *config);
+void CAN_Slave_Param_Apply(uint8_t index);
+void CAN_Slave_Config_Store(Flash_Config_TypeDef *config);
+
+/* Auto start functions  ******************************************************/
+void CAN_Slave_Auto_Start(const Flash_Config_TypeDef *config);
+void CAN_Restore_Encoder(Encoder_HandleTypeDef *Encoderx, Encoder_HandleTypeDef *Encodery);
+
+/* Bit rate functions  ********************************************************/
+HAL_StatusTypeDef CAN_Slave_Bitrate_Init(CAN_HandleTypeDef *hcan);
+void CAN_Slave_Bitrate_Handle(CAN_HandleTypeDef *hcan);
+
+/* Diagnostics functions  *****************************************************/
+void CAN_Slave_Diag_Handle(CAN_HandleTypeDef *hcan, uint8_t page, uint8_t index);
+
+/* Clock synchronisation functions  *******************************************/
+void CAN_Sync_Update(CAN_Sync_HandleTypeDef *Sync, CAN_RxMessage RxMessage);
+uint32_t CAN_Sync_Local_To_Master(uint32_t local_us);
+uint32_t CAN_Sync_Get_Master_Us(void);
+int32_t CAN_Sync_Get_Drift(void);
+
 /* Error feedback function  ***************************************************/
 void CAN_Sensor_ErrorFb(CAN_HandleTypeDef *hcan, Sensor_HandleTypedef Sensor);
 
@@ -0,0 +1,469 @@
+/**
+  ******************************************************************************
+  * @file    	CANTransferlib.c
+  * @author  	Nguyen Vu
+	*	@version 	1.0.0
+  * @brief   	This file provides function to send and receive payload
+	*						longer than one frame (ISO-TP style segmentation)
+  *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "CANTransferlib.h"
+#include "string.h"
+
+/**
+  * @brief  No flow control to send
+  */
+#define TRANSFER_FC_NONE	0xFF
+
+/** @brief    Transfer initialization function
+  ==============================================================================
+									##### Transfer Initialization Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Initialize a transfer link with its two StdId and receive buffer.
+    (+) Setting block size and STmin asked to the other side.
+  */
+
+/**
+  * @brief  Initializes a transfer link
+	* @note		Call Timebase_Init before this function
+	* @param 	htp      	Pointer to the CAN_Transfer_HandleTypeDef structure.
+	* @param 	hcan      Pointer to the CAN_HandleTypeDef structure.
+	* @param 	tx_id     StdId of frames sent by this side.
+	* @param 	rx_id     StdId of frames sent by the other side.
+	* @param 	rx_buf    Buffer for received payload.
+	* @param 	rx_size   Size of rx_buf, longer payload is refused with overflow.
+  */
+void CAN_Transfer_Init(CAN_Transfer_HandleTypeDef *htp, CAN_HandleTypeDef *hcan, uint32_t tx_id, uint32_t rx_id,
+											 uint8_t *rx_buf, uint16_t rx_size)
+{
+	htp->hcan = hcan;
+	htp->tx_id = tx_id;
+	htp->rx_id = rx_id;
+	htp->tx_mailbox = 0;
+	htp->tx_buf = NULL;
+	htp->tx_len = 0;
+	htp->tx_pos = 0;
+	htp->tx_sn = 0;
+	htp->tx_state = TRANSFER_IDLE;
+	htp->tx_error = 0;
+	htp->rx_buf = rx_buf;
+	htp->rx_size = rx_size;
+	htp->rx_len = 0;
+	htp->rx_pos = 0;
+	htp->rx_state = TRANSFER_IDLE;
+	htp->rx_ready = 0;
+	htp->fc_request = TRANSFER_FC_NONE;
+	htp->tx_count = 0;
+	htp->rx_count = 0;
+	htp->error_count = 0;
+	htp->timeout_count = 0;
+	CAN_Transfer_Config(htp, TRANSFER_BLOCK_SIZE, TRANSFER_STMIN);
+}
+
+/**
+  * @brief  Setting block size and STmin asked to the other side
+	* @note		Used from the next flow control
+	* @param 	htp      		Pointer to the CAN_Transfer_HandleTypeDef structure.
+	* @param 	block_size  Consecutive frames between flow control, 0 is no limit.
+	* @param 	stmin      	Minimum gap between consecutive frames (ISO-TP coding).
+  */
+void CAN_Transfer_Config(CAN_Transfer_HandleTypeDef *htp, uint8_t block_size, uint8_t stmin)
+{
+	htp->block_size = block_size;
+	htp->stmin = stmin;
+}
+
+/** @brief    Transfer function
+  ==============================================================================
+											##### Transfer Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Starting to send a payload.
+    (+) Receiving frames of the link in Rx interrupt.
+    (+) Sending consecutive frames and flow control in while loop.
+	[..]
+		Frames are only loaded when more than TRANSFER_MAILBOX_RESERVE mailboxes
+		are free, so sensor streams always find a mailbox. Transfer frames should
+		have a low priority StdId, they then use only the bus time left by streams.
+		Every frame of the link has the same StdId and bxCAN (TXFP off) breaks the
+		tie by mailbox number, so a frame is only loaded after the previous one
+		left its mailbox, consecutive frames can not overtake each other.
+  */
+
+/**
+  * @brief  Converting STmin to microsecond
+	* @param 	stmin      STmin (ISO-TP coding).
+	* @return	Minimum gap in microsecond
+  */
+static uint32_t CAN_Transfer_STmin_Us(uint8_t stmin)
+{
+	if (stmin <= 0x7F)
+		return (uint32_t)stmin * 1000;
+	if (stmin >= 0xF1 && stmin <= 0xF9)
+		return (uint32_t)(stmin - 0xF0) * 100;
+
+	//Reserved value, use the longest gap
+	return 127000;
+}
+
+/**
+  * @brief  Loading a frame of the link
+	* @param 	htp      	Pointer to the CAN_Transfer_HandleTypeDef structure.
+	* @param 	data      Frame data.
+	* @param 	dlc      	Frame DLC.
+	* @return	HAL status
+  */
+static HAL_StatusTypeDef CAN_Transfer_Frame(CAN_Transfer_HandleTypeDef *htp, uint8_t *data, uint8_t dlc)
+{
+	CAN_TxHeaderTypeDef TxHeader;
+	uint32_t mailbox;
+
+	if (HAL_CAN_GetTxMailboxesFreeLevel(htp->hcan) <= TRANSFER_MAILBOX_RESERVE)
+		return HAL_BUSY;
+
+	//Keep frame order, previous frame of the link is still pending
+	if (htp->tx_mailbox && HAL_CAN_IsTxMessagePending(htp->hcan, htp->tx_mailbox))
+		return HAL_BUSY;
+
+	CAN_TxHeader_Init(&TxHeader, htp->tx_id, dlc);
+	HAL_StatusTypeDef status = CAN_Transmit(htp->hcan, &TxHeader, data, &mailbox);
+	if (status == HAL_OK)
+		htp->tx_mailbox = mailbox;
+	return status;
+}
+
+/**
+  * @brief  Starting to send a payload
+	* @note		Single frame is sent now, longer payload is sent by CAN_Transfer_Handle.
+	*					Either way CAN_Transfer_Handle reports the completion.
+	*					Keep data unchanged until CAN_Transfer_TxCplt_Callback.
+	* @param 	htp      	Pointer to the CAN_Transfer_HandleTypeDef structure.
+	* @param 	data      Payload.
+	* @param 	len      	Payload length, 1 to TRANSFER_MAX_LEN.
+	* @return	HAL_OK, HAL_BUSY if a payload is still sent or no mailbox, HAL_ERROR if len is invalid
+  */
+HAL_StatusTypeDef CAN_Transfer_Send(CAN_Transfer_HandleTypeDef *htp, const uint8_t *data, uint16_t len)
+{
+	uint8_t frame[8] = {0};
+
+	if (len == 0 || len > TRANSFER_MAX_LEN)
+		return HAL_ERROR;
+	if (htp->tx_state != TRANSFER_IDLE)
+		return HAL_BUSY;
+
+	if (len <= TRANSFER_SF_MAX)
+	{
+		frame[0] = TRANSFER_PCI_SF | len;
+		memcpy(&frame[1], data, len);
+		if (CAN_Transfer_Frame(htp, frame, len + 1) != HAL_OK)
+			return HAL_BUSY;
+		htp->tx_state = TRANSFER_TX_DONE;
+		return HAL_OK;
+	}
+
+	htp->tx_buf = data;
+	htp->tx_len = len;
+	htp->tx_pos = TRANSFER_FF_DATA;
+	htp->tx_sn = 1;
+	htp->tx_timer_us = Timebase_Get_Us();
+
+	//Flow control may come right after the first frame
+	htp->tx_state = TRANSFER_WAIT_FC;
+	frame[0] = TRANSFER_PCI_FF | (len >> 8);
+	frame[1] = len & 0xFF;
+	memcpy(&frame[2], data, TRANSFER_FF_DATA);
+	if (CAN_Transfer_Frame(htp, frame, 8) != HAL_OK)
+	{
+		htp->tx_state = TRANSFER_IDLE;
+		return HAL_BUSY;
+	}
+	return HAL_OK;
+}
+
+/**
+  * @brief  Receiving a frame of the link
+	* @note		Place this function in Rx interrupt for frames with StdId = rx_id,
+	*					only copies data and sets flags.
+	* @param 	htp      		Pointer to the CAN_Transfer_HandleTypeDef structure.
+	* @param 	RxMessage   Pointer to the received frame.
+  */
+void CAN_Transfer_Rx_Handle(CAN_Transfer_HandleTypeDef *htp, CAN_RxMessage *RxMessage)
+{
+	uint8_t *data = RxMessage->rxdata;
+	uint8_t dlc = RxMessage->RxHeader.DLC;
+	if (dlc == 0)
+		return;
+
+	switch (data[0] & 0xF0)
+	{
+		case TRANSFER_PCI_SF:
+		{
+			uint8_t len = data[0] & 0x0F;
+			if (len == 0 || len > TRANSFER_SF_MAX || len >= dlc || htp->rx_ready || len > htp->rx_size)
+			{
+				htp->error_count++;
+				return;
+			}
+			memcpy(htp->rx_buf, &data[1], len);
+			htp->rx_len = len;
+			htp->rx_state = TRANSFER_IDLE;
+			htp->rx_ready = 1;
+			break;
+		}
+
+		case TRANSFER_PCI_FF:
+		{
+			uint16_t len = ((uint16_t)(data[0] & 0x0F) << 8) | data[1];
+			if (dlc < 8 || len <= TRANSFER_SF_MAX)
+			{
+				htp->error_count++;
+				return;
+			}
+
+			//Previous payload not taken yet or too long
+			if (htp->rx_ready || len > htp->rx_size)
+			{
+				htp->rx_state = TRANSFER_IDLE;
+				htp->fc_request = TRANSFER_FC_OVERFLOW;
+				htp->error_count++;
+				return;
+			}
+			memcpy(htp->rx_buf, &data[2], TRANSFER_FF_DATA);
+			htp->rx_len = len;
+			htp->rx_pos = TRANSFER_FF_DATA;
+			htp->rx_sn = 1;
+			htp->rx_bs_count = 0;
+			htp->rx_timer_us = Timebase_Get_Us();
+			htp->rx_state = TRANSFER_RECEIVING;
+			htp->fc_request = TRANSFER_FC_CTS;
+			break;
+		}
+
+		case TRANSFER_PCI_CF:
+		{
+			if (htp->rx_state != TRANSFER_RECEIVING)
+				return;
+			if ((data[0] & 0x0F) != htp->rx_sn)
+			{
+				//Lost frame, drop the payload
+				htp->rx_state = TRANSFER_IDLE;
+				htp->error_count++;
+				return;
+			}
+
+			uint16_t len = htp->rx_len - htp->rx_pos;
+			if (len > TRANSFER_CF_DATA)
+				len = TRANSFER_CF_DATA;
+			if (len >= dlc)
+				len = dlc - 1;
+			memcpy(&htp->rx_buf[htp->rx_pos], &data[1], len);
+			htp->rx_pos += len;
+			htp->rx_sn = (htp->rx_sn + 1) & 0x0F;
+			htp->rx_timer_us = Timebase_Get_Us();
+
+			if (htp->rx_pos >= htp->rx_len)
+			{
+				htp->rx_state = TRANSFER_IDLE;
+				htp->rx_ready = 1;
+			}
+			else if (htp->block_size && ++htp->rx_bs_count >= htp->block_size)
+			{
+				htp->rx_bs_count = 0;
+				htp->fc_request = TRANSFER_FC_CTS;
+			}
+			break;
+		}
+
+		case TRANSFER_PCI_FC:
+		{
+			if (htp->tx_state != TRANSFER_WAIT_FC || dlc < 3)
+				return;
+
+			uint8_t status = data[0] & 0x0F;
+			htp->tx_timer_us = Timebase_Get_Us();
+			if (status == TRANSFER_FC_CTS)
+			{
+				htp->tx_bs = data[1];
+				htp->tx_bs_left = data[1];
+				htp->tx_stmin_us = CAN_Transfer_STmin_Us(data[2]);
+				htp->tx_last_us = htp->tx_timer_us - htp->tx_stmin_us;
+				htp->tx_state = TRANSFER_SEND_CF;
+			}
+			else if (status != TRANSFER_FC_WAIT)
+			{
+				//Overflow or invalid, receiver refused the payload
+				htp->tx_state = TRANSFER_IDLE;
+				htp->tx_error = 1;
+				htp->error_count++;
+			}
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
+/**
+  * @brief  Ending a sent payload, single frame or segmented
+	* @param 	htp      Pointer to the CAN_Transfer_HandleTypeDef structure.
+  */
+static void CAN_Transfer_Tx_Complete(CAN_Transfer_HandleTypeDef *htp)
+{
+	htp->tx_state = TRANSFER_IDLE;
+	htp->tx_count++;
+	CAN_Transfer_TxCplt_Callback(htp);
+}
+
+/**
+  * @brief  Sending consecutive frames, flow control and checking timeout
+	* @note		Call this function in while loop, and again when a mailbox
+	*					is free for a high throughput.
+	* @param 	htp      Pointer to the CAN_Transfer_HandleTypeDef structure.
+  */
+void CAN_Transfer_Handle(CAN_Transfer_HandleTypeDef *htp)
+{
+	uint8_t frame[8] = {0};
+	uint32_t now = Timebase_Get_Us();
+
+	//Flow control first, the sender is waiting for it
+	if (htp->fc_request != TRANSFER_FC_NONE)
+	{
+		frame[0] = TRANSFER_PCI_FC | htp->fc_request;
+		frame[1] = htp->block_size;
+		frame[2] = htp->stmin;
+		if (CAN_Transfer_Frame(htp, frame, 3) == HAL_OK)
+			htp->fc_request = TRANSFER_FC_NONE;
+	}
+
+	//Give the received payload to the application
+	if (htp->rx_ready)
+	{
+		htp->rx_count++;
+		CAN_Transfer_RxCplt_Callback(htp, htp->rx_buf, htp->rx_len);
+		htp->rx_ready = 0;
+	}
+
+	if (htp->rx_state == TRANSFER_RECEIVING && (now - htp->rx_timer_us) >= TRANSFER_TIMEOUT_US)
+	{
+		htp->rx_state = TRANSFER_IDLE;
+		htp->timeout_count++;
+	}
+
+	if (htp->tx_error)
+	{
+		htp->tx_error = 0;
+		CAN_Transfer_Error_Callback(htp);
+	}
+
+	if (htp->tx_state == TRANSFER_TX_DONE)
+	{
+		CAN_Transfer_Tx_Complete(htp);
+		return;
+	}
+
+	if (htp->tx_state == TRANSFER_WAIT_FC && (now - htp->tx_timer_us) >= TRANSFER_TIMEOUT_US)
+	{
+		htp->tx_state = TRANSFER_IDLE;
+		htp->timeout_count++;
+		CAN_Transfer_Error_Callback(htp);
+		return;
+	}
+
+	//Load consecutive frames as the previous one leaves its mailbox and STmin allows
+	while (htp->tx_state == TRANSFER_SEND_CF && (now - htp->tx_last_us) >= htp->tx_stmin_us)
+	{
+		uint16_t len = htp->tx_len - htp->tx_pos;
+		if (len > TRANSFER_CF_DATA)
+			len = TRANSFER_CF_DATA;
+		uint8_t last = (htp->tx_pos + len >= htp->tx_len);
+		uint8_t block_end = (htp->tx_bs && htp->tx_bs_left == 1);
+
+		frame[0] = TRANSFER_PCI_CF | htp->tx_sn;
+		memcpy(&frame[1], &htp->tx_buf[htp->tx_pos], len);
+
+		//Flow control may come in Rx interrupt right after the last frame of the block,
+		//load the frame and update the state in one step so it is not overwritten
+		uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+		if (CAN_Transfer_Frame(htp, frame, len + 1) != HAL_OK)
+		{
+			__set_PRIMASK(primask);
+			return;
+		}
+		htp->tx_pos += len;
+		htp->tx_sn = (htp->tx_sn + 1) & 0x0F;
+		htp->tx_last_us = now;
+		if (htp->tx_bs)
+			htp->tx_bs_left--;
+		if (!last && block_end)
+		{
+			htp->tx_state = TRANSFER_WAIT_FC;
+			htp->tx_timer_us = now;
+		}
+		__set_PRIMASK(primask);
+
+		if (last)
+		{
+			CAN_Transfer_Tx_Complete(htp);
+			return;
+		}
+	}
+}
+
+/**
+  * @brief  Checking a payload is being sent
+	* @param 	htp      Pointer to the CAN_Transfer_HandleTypeDef structure.
+	* @return	Busy (1) or idle (0)
+  */
+uint8_t CAN_Transfer_isBusy(CAN_Transfer_HandleTypeDef *htp)
+{
+	return (htp->tx_state != TRANSFER_IDLE);
+}
+
+/** @brief    Transfer callback function
+  ==============================================================================
+									##### Transfer Callback Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Notifying a payload was sent.
+    (+) Giving a received payload.
+    (+) Notifying a payload was refused or timed out.
+  */
+
+/**
+  * @brief  Payload sent callback
+	* @note		Place this function beforn main function, tx buffer can be reused
+	* @param 	htp      Pointer to the CAN_Transfer_HandleTypeDef structure.
+  */
+__weak void CAN_Transfer_TxCplt_Callback(CAN_Transfer_HandleTypeDef *htp)
+{
+
+}
+
+/**
+  * @brief  Payload received callback
+	* @note		Place this function beforn main function, data is valid until it returns
+	* @param 	htp      Pointer to the CAN_Transfer_HandleTypeDef structure.
+	* @param 	data     Payload.
+	* @param 	len      Payload length.
+  */
+__weak void CAN_Transfer_RxCplt_Callback(CAN_Transfer_HandleTypeDef *htp, uint8_t *data, uint16_t len)
+{
+
+}
+
+/**
+  * @brief  Payload send failed callback
+	* @note		Place this function beforn main function, tx buffer can be reused
+	* @param 	htp      Pointer to the CAN_Transfer_HandleTypeDef structure.
+  */
+__weak void CAN_Transfer_Error_Callback(CAN_Transfer_HandleTypeDef *htp)
+{
+
+}
@@ -0,0 +1,114 @@
+/**
+  ******************************************************************************
+  * @file    	CANTransferlib.h
+  * @author  	Nguyen Vu
+  * @brief   	This file contains all the functions prototypes
+	*						for the segmented transfer (ISO-TP style) over CANbus
+  *****************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef CANTRANSFERLIB_H_
+#define CANTRANSFERLIB_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "bxCANlib.h"
+#include "CANConfig.h"
+#include "Timebase.h"
+
+/**
+  * @brief  Protocol control information, high nibble of the first byte
+  */
+#define TRANSFER_PCI_SF					0x00		//Single frame, [0|len][data]
+#define TRANSFER_PCI_FF					0x10		//First frame, [1|len high][len low][data]
+#define TRANSFER_PCI_CF					0x20		//Consecutive frame, [2|sn][data]
+#define TRANSFER_PCI_FC					0x30		//Flow control, [3|status][block size][STmin]
+
+#define TRANSFER_FC_CTS					0x00		//Continue to send
+#define TRANSFER_FC_WAIT				0x01
+#define TRANSFER_FC_OVERFLOW		0x02
+
+#define TRANSFER_MAX_LEN				4095
+#define TRANSFER_SF_MAX					7
+#define TRANSFER_FF_DATA				6
+#define TRANSFER_CF_DATA				7
+
+/**
+  * @brief  Transfer state
+  */
+#define TRANSFER_IDLE						0
+#define TRANSFER_WAIT_FC				1				//Sender waits for flow control
+#define TRANSFER_SEND_CF				2				//Sender sends consecutive frames
+#define TRANSFER_RECEIVING			3				//Receiver waits for consecutive frames
+#define TRANSFER_TX_DONE				4				//Sender loaded the last frame, CAN_Transfer_Handle reports it
+
+/**
+  * @brief  Segmented transfer struct
+	* @param	hcan					Pointer to the CAN_HandleTypeDef structure
+	* @param	tx_id					StdId of frames sent by this side (data and flow control)
+	* @param	tx_mailbox		Mailbox of the last frame loaded, 0 if none
+	* @param	rx_id					StdId of frames sent by the other side
+	* @param	tx_xxx				Sending side, buffer is owned by the application until done,
+	*												tx_error is set when the receiver refused the payload
+	* @param	rx_xxx				Receiving side, rx_ready is set until CAN_Transfer_Handle gives it
+	*												to CAN_Transfer_RxCplt_Callback
+	* @param	block_size		Block size asked to the other side, 0 is no limit
+	* @param	stmin					STmin asked to the other side (ISO-TP coding)
+	* @param	fc_request		Flow control status to send, 0xFF if none
+	* @param	xxx_count			Statistic
+  */
+typedef struct
+{
+	CAN_HandleTypeDef		*hcan;
+	uint32_t						tx_id;
+	uint32_t						rx_id;
+	uint32_t						tx_mailbox;
+
+	const uint8_t				*tx_buf;
+	uint16_t						tx_len;
+	uint16_t						tx_pos;
+	uint8_t							tx_sn;
+	volatile uint8_t		tx_state;
+	volatile uint8_t		tx_error;
+	uint8_t							tx_bs;
+	uint8_t							tx_bs_left;
+	uint32_t						tx_stmin_us;
+	uint32_t						tx_last_us;
+	uint32_t						tx_timer_us;
+
+	uint8_t							*rx_buf;
+	uint16_t						rx_size;
+	uint16_t						rx_len;
+	uint16_t						rx_pos;
+	uint8_t							rx_sn;
+	volatile uint8_t		rx_state;
+	volatile uint8_t		rx_ready;
+	uint8_t							rx_bs_count;
+	uint32_t						rx_timer_us;
+
+	uint8_t							block_size;
+	uint8_t							stmin;
+	volatile uint8_t		fc_request;
+
+	uint32_t						tx_count;
+	uint32_t						rx_count;
+	uint32_t						error_count;
+	uint32_t						timeout_count;
+}CAN_Transfer_HandleTypeDef;
+
+/* Initialization functions  **************************************************/
+void CAN_Transfer_Init(CAN_Transfer_HandleTypeDef *htp, CAN_HandleTypeDef *hcan, uint32_t tx_id, uint32_t rx_id,
+											 uint8_t *rx_buf, uint16_t rx_size);
+void CAN_Transfer_Config(CAN_Transfer_HandleTypeDef *htp, uint8_t block_size, uint8_t stmin);
+
+/* Transfer functions  ********************************************************/
+HAL_StatusTypeDef CAN_Transfer_Send(CAN_Transfer_HandleTypeDef *htp, const uint8_t *data, uint16_t len);
+void CAN_Transfer_Rx_Handle(CAN_Transfer_HandleTypeDef *htp, CAN_RxMessage *RxMessage);
+void CAN_Transfer_Handle(CAN_Transfer_HandleTypeDef *htp);
+uint8_t CAN_Transfer_isBusy(CAN_Transfer_HandleTypeDef *htp);
+
+/* Callback functions  ********************************************************/
+void CAN_Transfer_TxCplt_Callback(CAN_Transfer_HandleTypeDef *htp);
+void CAN_Transfer_RxCplt_Callback(CAN_Transfer_HandleTypeDef *htp, uint8_t *data, uint16_t len);
+void CAN_Transfer_Error_Callback(CAN_Transfer_HandleTypeDef *htp);
+
+#endif
@@ -0,0 +1,338 @@
+/**
+  ******************************************************************************
+  * @file    	CANBusSim.c
+  * @author  	Nguyen Vu
+	*	@version 	1.0.0
+  * @brief   	This file provides a simulated bxCAN bus for host tests:
+	*						three mailboxes per node, arbitration by StdId, tie broken by
+	*						mailbox number (TXFP off) and injected error frames with retry
+  *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "CANBusSim.h"
+#include "Timebase.h"
+#include "string.h"
+
+/**
+  * @brief  Mailbox of a simulated controller
+  */
+typedef struct
+{
+	uint8_t							pending;
+	CAN_TxHeaderTypeDef	TxHeader;
+	uint8_t							data[8];
+}CAN_Sim_MailboxTypeDef;
+
+/**
+  * @brief  Simulated controller
+  */
+typedef struct
+{
+	CAN_HandleTypeDef				*hcan;
+	CAN_Sim_RxTypeDef				rx;
+	CAN_Sim_MailboxTypeDef	mailbox[CAN_SIM_MAILBOX_NUM];
+}CAN_Sim_NodeTypeDef;
+
+static CAN_Sim_NodeTypeDef	Sim_Node[CAN_SIM_NODE_NUM];
+static uint8_t							Sim_Node_Num;
+static uint32_t							Sim_Us;
+static uint32_t							Sim_Bitrate;
+static uint16_t							Sim_Error_Rate;
+static uint32_t							Sim_Seed;
+static CAN_Sim_StatTypeDef	Sim_Stat;
+
+//Frame on the bus
+static CAN_Sim_NodeTypeDef	*Sim_Tx_Node;
+static uint8_t							Sim_Tx_Mailbox;
+static uint32_t							Sim_Tx_End_us;
+static uint8_t							Sim_Tx_Error;
+
+DWT_Type Host_DWT;
+uint32_t SystemCoreClock = 72000000;
+
+/** @brief    Simulated bus initialization function
+  ==============================================================================
+								##### Simulated Bus Initialization Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Initialize the bus with a bit rate and an error rate.
+    (+) Attaching a node and its receive function.
+  */
+
+/**
+  * @brief  Initializes the bus
+	* @param 	bitrate      			Bit rate in bit/s.
+	* @param 	error_per_mille   Share of frames destroyed by an error frame and retried.
+	* @param 	seed      				Seed of the error generator, same seed gives the same run.
+  */
+void CAN_Sim_Init(uint32_t bitrate, uint16_t error_per_mille, uint32_t seed)
+{
+	memset(Sim_Node, 0, sizeof(Sim_Node));
+	memset(&Sim_Stat, 0, sizeof(Sim_Stat));
+	Sim_Node_Num = 0;
+	Sim_Us = 0;
+	Sim_Bitrate = bitrate;
+	Sim_Error_Rate = error_per_mille;
+	Sim_Seed = seed ? seed : 1;
+	Sim_Tx_Node = NULL;
+}
+
+/**
+  * @brief  Attaching a node
+	* @param 	hcan      Handle used by the node.
+	* @param 	rx      	Receive function, NULL if the node only sends.
+  */
+void CAN_Sim_Attach(CAN_HandleTypeDef *hcan, CAN_Sim_RxTypeDef rx)
+{
+	if (Sim_Node_Num >= CAN_SIM_NODE_NUM)
+		return;
+	Sim_Node[Sim_Node_Num].hcan = hcan;
+	Sim_Node[Sim_Node_Num].rx = rx;
+	Sim_Node_Num++;
+}
+
+/**
+  * @brief  Getting the node of a handle
+	* @param 	hcan      Handle used by the node.
+	* @return	Pointer to the node, NULL if not attached
+  */
+static CAN_Sim_NodeTypeDef *CAN_Sim_Node(const CAN_HandleTypeDef *hcan)
+{
+	for (uint8_t i = 0; i < Sim_Node_Num; i++)
+		if (Sim_Node[i].hcan == hcan)
+			return &Sim_Node[i];
+	return NULL;
+}
+
+/** @brief    Simulated bus running function
+  ==============================================================================
+								##### Simulated Bus Running Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Advancing the time, running arbitration and delivering frames.
+    (+) Getting the time and the statistic.
+	[..]
+		Every pending mailbox of every node takes part in arbitration, the
+		lowest StdId wins. Between two mailboxes with the same StdId the lower
+		mailbox number wins, as bxCAN does with TXFP off, whatever the load order.
+  */
+
+/**
+  * @brief  Frame length with worst case bit stuffing and interframe space
+	* @param 	dlc      Frame DLC.
+	* @return	Length in microsecond
+  */
+static uint32_t CAN_Sim_Frame_Us(uint8_t dlc)
+{
+	uint32_t bits = 44 + 8 * dlc;
+	bits += (34 + 8 * dlc - 1) / 4 + 3;
+	return (bits * 1000000 + Sim_Bitrate - 1) / Sim_Bitrate;
+}
+
+/**
+  * @brief  Pseudo random draw for error injection
+	* @return	Value 0 to 999
+  */
+static uint16_t CAN_Sim_Random(void)
+{
+	Sim_Seed = Sim_Seed * 1103515245 + 12345;
+	return (Sim_Seed >> 16) % 1000;
+}
+
+/**
+  * @brief  Starting the frame which wins arbitration
+  */
+static void CAN_Sim_Arbitrate(void)
+{
+	CAN_Sim_NodeTypeDef *win_node = NULL;
+	uint8_t win_mailbox = 0;
+
+	for (uint8_t i = 0; i < Sim_Node_Num; i++)
+	{
+		for (uint8_t m = 0; m < CAN_SIM_MAILBOX_NUM; m++)
+		{
+			CAN_Sim_MailboxTypeDef *mailbox = &Sim_Node[i].mailbox[m];
+			if (!mailbox->pending)
+				continue;
+			if (win_node == NULL || mailbox->TxHeader.StdId < win_node->mailbox[win_mailbox].TxHeader.StdId)
+			{
+				win_node = &Sim_Node[i];
+				win_mailbox = m;
+			}
+		}
+	}
+	if (win_node == NULL)
+		return;
+
+	Sim_Tx_Node = win_node;
+	Sim_Tx_Mailbox = win_mailbox;
+	Sim_Tx_Error = (CAN_Sim_Random() < Sim_Error_Rate);
+	if (Sim_Tx_Error)
+		Sim_Tx_End_us = Sim_Us + (CAN_SIM_ERROR_BITS * 1000000 + Sim_Bitrate - 1) / Sim_Bitrate +
+										CAN_Sim_Frame_Us(win_node->mailbox[win_mailbox].TxHeader.DLC) / 2;
+	else
+		Sim_Tx_End_us = Sim_Us + CAN_Sim_Frame_Us(win_node->mailbox[win_mailbox].TxHeader.DLC);
+}
+
+/**
+  * @brief  Ending the frame on the bus
+  */
+static void CAN_Sim_Complete(void)
+{
+	CAN_Sim_MailboxTypeDef *mailbox = &Sim_Tx_Node->mailbox[Sim_Tx_Mailbox];
+	CAN_Sim_NodeTypeDef *sender = Sim_Tx_Node;
+	Sim_Tx_Node = NULL;
+
+	//Destroyed frame stays pending and takes part in the next arbitration
+	if (Sim_Tx_Error)
+	{
+		Sim_Stat.errors++;
+		return;
+	}
+
+	CAN_RxMessage RxMessage = {0};
+	RxMessage.RxHeader.StdId = mailbox->TxHeader.StdId;
+	RxMessage.RxHeader.IDE = mailbox->TxHeader.IDE;
+	RxMessage.RxHeader.RTR = mailbox->TxHeader.RTR;
+	RxMessage.RxHeader.DLC = mailbox->TxHeader.DLC;
+	RxMessage.RxHeader.Timestamp = Sim_Us;
+	memcpy(RxMessage.rxdata, mailbox->data, 8);
+	mailbox->pending = 0;
+	Sim_Stat.frames++;
+
+	for (uint8_t i = 0; i < Sim_Node_Num; i++)
+		if (&Sim_Node[i] != sender && Sim_Node[i].rx != NULL)
+			Sim_Node[i].rx(Sim_Node[i].hcan, &RxMessage);
+}
+
+/**
+  * @brief  Advancing the time
+	* @note		Receive functions are called from here, as the Rx interrupt would.
+	* @param 	us      Time to advance in microsecond.
+  */
+void CAN_Sim_Step(uint32_t us)
+{
+	for (uint32_t i = 0; i < us; i++)
+	{
+		if (Sim_Tx_Node == NULL)
+			CAN_Sim_Arbitrate();
+		Sim_Us++;
+		Host_DWT.CYCCNT += SystemCoreClock / 1000000;
+		if (Sim_Tx_Node != NULL)
+		{
+			Sim_Stat.busy_us++;
+			if (Sim_Us == Sim_Tx_End_us)
+				CAN_Sim_Complete();
+		}
+	}
+}
+
+/**
+  * @brief 	Getting the simulated time
+	* @return	Time in microsecond
+  */
+uint32_t CAN_Sim_Get_Us(void)
+{
+	return Sim_Us;
+}
+
+/**
+  * @brief 	Getting the bus statistic
+	* @return	Pointer to the CAN_Sim_StatTypeDef structure
+  */
+CAN_Sim_StatTypeDef *CAN_Sim_Get_Stat(void)
+{
+	return &Sim_Stat;
+}
+
+/** @brief    Library and HAL stand-in function
+  ==============================================================================
+								##### Library And HAL Stand-in Functions #####
+  ==============================================================================
+  [..]
+    This section provides the functions of HAL, bxCANlib and Timebase
+		the libraries under test call, working on the simulated bus.
+  */
+
+/**
+  * @brief 	Getting the microsecond time
+	* @return	Simulated time
+  */
+uint32_t Timebase_Get_Us(void)
+{
+	return Sim_Us;
+}
+
+/**
+  * @brief 	Counting free mailboxes
+  */
+uint32_t HAL_CAN_GetTxMailboxesFreeLevel(const CAN_HandleTypeDef *hcan)
+{
+	CAN_Sim_NodeTypeDef *node = CAN_Sim_Node(hcan);
+	uint32_t level = 0;
+	if (node == NULL)
+		return 0;
+	for (uint8_t m = 0; m < CAN_SIM_MAILBOX_NUM; m++)
+		level += !node->mailbox[m].pending;
+	return level;
+}
+
+/**
+  * @brief 	Checking mailboxes are pending
+  */
+uint32_t HAL_CAN_IsTxMessagePending(const CAN_HandleTypeDef *hcan, uint32_t TxMailboxes)
+{
+	CAN_Sim_NodeTypeDef *node = CAN_Sim_Node(hcan);
+	if (node == NULL)
+		return 0;
+	for (uint8_t m = 0; m < CAN_SIM_MAILBOX_NUM; m++)
+		if ((TxMailboxes & (1U << m)) && node->mailbox[m].pending)
+			return 1;
+	return 0;
+}
+
+/**
+  * @brief 	Loading a frame in the lowest free mailbox
+  */
+HAL_StatusTypeDef HAL_CAN_AddTxMessage(CAN_HandleTypeDef *hcan, const CAN_TxHeaderTypeDef *pHeader,
+																			 const uint8_t aData[], uint32_t *pTxMailbox)
+{
+	CAN_Sim_NodeTypeDef *node = CAN_Sim_Node(hcan);
+	if (node == NULL)
+		return HAL_ERROR;
+	for (uint8_t m = 0; m < CAN_SIM_MAILBOX_NUM; m++)
+	{
+		CAN_Sim_MailboxTypeDef *mailbox = &node->mailbox[m];
+		if (mailbox->pending)
+			continue;
+		mailbox->TxHeader = *pHeader;
+		memcpy(mailbox->data, aData, pHeader->DLC);
+		mailbox->pending = 1;
+		*pTxMailbox = 1U << m;
+		return HAL_OK;
+	}
+	return HAL_ERROR;
+}
+
+/**
+  * @brief  Initializes a Tx header, same as bxCANlib
+  */
+void CAN_TxHeader_Init(CAN_TxHeaderTypeDef *TxHeader, uint32_t StdId, uint32_t DLC)
+{
+	TxHeader->DLC 								= DLC;
+	TxHeader->ExtId 							= 0;
+	TxHeader->IDE 								= CAN_ID_STD;
+	TxHeader->RTR 								= CAN_RTR_DATA;
+	TxHeader->StdId								= StdId;
+	TxHeader->TransmitGlobalTime	= DISABLE;
+}
+
+/**
+  * @brief  Loading a frame, same as bxCANlib without the transmit hook
+  */
+HAL_StatusTypeDef CAN_Transmit(CAN_HandleTypeDef *hcan, CAN_TxHeaderTypeDef *TxHeader, uint8_t *Data, uint32_t *Mailbox)
+{
+	return HAL_CAN_AddTxMessage(hcan, TxHeader, Data, Mailbox);
+}
@@ -0,0 +1,51 @@
+/**
+  ******************************************************************************
+  * @file    	CANBusSim.h
+  * @author  	Nguyen Vu
+  * @brief   	This file contains all the functions prototypes
+	*						for the simulated bxCAN bus used by host tests
+  *****************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef CANBUSSIM_H_
+#define CANBUSSIM_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f1xx_hal.h"
+#include "bxCANlib.h"
+
+/**
+  * @brief  Configuration Value
+  */
+#define CAN_SIM_NODE_NUM				4
+#define CAN_SIM_MAILBOX_NUM			3
+#define CAN_SIM_ERROR_BITS			20				//Error frame and delimiter before the retry
+
+/**
+  * @brief  Receive function of a node, called at the end of every frame sent by another node
+  */
+typedef void (*CAN_Sim_RxTypeDef)(CAN_HandleTypeDef *hcan, CAN_RxMessage *RxMessage);
+
+/**
+  * @brief  Bus statistic
+	* @param	frames				Frames completed
+	* @param	errors				Frames destroyed by an injected error and retried
+	* @param	busy_us				Time the bus was not idle
+  */
+typedef struct
+{
+	uint32_t	frames;
+	uint32_t	errors;
+	uint32_t	busy_us;
+}CAN_Sim_StatTypeDef;
+
+/* Initialization functions  **************************************************/
+void CAN_Sim_Init(uint32_t bitrate, uint16_t error_per_mille, uint32_t seed);
+void CAN_Sim_Attach(CAN_HandleTypeDef *hcan, CAN_Sim_RxTypeDef rx);
+
+/* Running functions  *********************************************************/
+void CAN_Sim_Step(uint32_t us);
+uint32_t CAN_Sim_Get_Us(void);
+CAN_Sim_StatTypeDef *CAN_Sim_Get_Stat(void);
+
+#endif
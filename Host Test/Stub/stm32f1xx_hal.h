@@ -0,0 +1,105 @@
+/**
+  ******************************************************************************
+  * @file    	stm32f1xx_hal.h
+  * @author  	Nguyen Vu
+  * @brief   	Host stand-in for the HAL header, only what the libraries
+	*						under test use. Interrupt lock does nothing on host.
+  *****************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef STM32F1XX_HAL_H_STUB_
+#define STM32F1XX_HAL_H_STUB_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stddef.h>
+
+#define __weak								__attribute__((weak))
+#define DISABLE								0
+#define ENABLE								1
+
+typedef enum
+{
+	HAL_OK			= 0x00,
+	HAL_ERROR		= 0x01,
+	HAL_BUSY		= 0x02,
+	HAL_TIMEOUT	= 0x03
+}HAL_StatusTypeDef;
+
+/**
+  * @brief  CAN
+  */
+#define CAN_ID_STD						0x00000000U
+#define CAN_RTR_DATA					0x00000000U
+#define CAN_RTR_REMOTE				0x00000002U
+#define CAN_TX_MAILBOX0				0x00000001U
+#define CAN_TX_MAILBOX1				0x00000002U
+#define CAN_TX_MAILBOX2				0x00000004U
+
+typedef struct
+{
+	uint32_t StdId;
+	uint32_t ExtId;
+	uint32_t IDE;
+	uint32_t RTR;
+	uint32_t DLC;
+	uint32_t TransmitGlobalTime;
+}CAN_TxHeaderTypeDef;
+
+typedef struct
+{
+	uint32_t StdId;
+	uint32_t ExtId;
+	uint32_t IDE;
+	uint32_t RTR;
+	uint32_t DLC;
+	uint32_t Timestamp;
+	uint32_t FilterMatchIndex;
+}CAN_RxHeaderTypeDef;
+
+typedef struct
+{
+	uint32_t FilterIdHigh;
+	uint32_t FilterIdLow;
+	uint32_t FilterMaskIdHigh;
+	uint32_t FilterMaskIdLow;
+	uint32_t FilterFIFOAssignment;
+	uint32_t FilterBank;
+	uint32_t FilterMode;
+	uint32_t FilterScale;
+	uint32_t FilterActivation;
+	uint32_t SlaveStartFilterBank;
+}CAN_FilterTypeDef;
+
+typedef struct
+{
+	uint8_t id;
+}CAN_HandleTypeDef;
+
+typedef struct
+{
+	uint8_t id;
+}TIM_HandleTypeDef;
+
+uint32_t HAL_CAN_GetTxMailboxesFreeLevel(const CAN_HandleTypeDef *hcan);
+uint32_t HAL_CAN_IsTxMessagePending(const CAN_HandleTypeDef *hcan, uint32_t TxMailboxes);
+HAL_StatusTypeDef HAL_CAN_AddTxMessage(CAN_HandleTypeDef *hcan, const CAN_TxHeaderTypeDef *pHeader,
+																			 const uint8_t aData[], uint32_t *pTxMailbox);
+
+/**
+  * @brief  Core
+  */
+typedef struct
+{
+	uint32_t CYCCNT;
+}DWT_Type;
+
+extern DWT_Type Host_DWT;
+extern uint32_t SystemCoreClock;
+#define DWT										(&Host_DWT)
+
+static inline uint32_t __get_PRIMASK(void) { return 0; }
+static inline void __set_PRIMASK(uint32_t primask) { (void)primask; }
+static inline void __disable_irq(void) { }
+
+#endif
@@ -0,0 +1,161 @@
+/**
+  ******************************************************************************
+  * @file    	bench_transfer.c
+  * @author  	Nguyen Vu
+  * @brief   	Segmented transfer benchmark on the simulated bus: the slave
+	*						sends payloads to the master while its sensor streams load
+	*						the bus, every payload and its completion are checked and
+	*						the throughput printed
+  *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "CANBusSim.h"
+#include "CANTransferlib.h"
+
+/**
+  * @brief  Benchmark setting
+  */
+#define BENCH_BITRATE				500000		//Bit rate of the slave (prescaler 4, 18 tq at 36 MHz)
+#define BENCH_NODE					0
+#define BENCH_LOOP_US				10				//While loop pass of both nodes
+#define BENCH_STREAM_US			1000			//Encoder and IMU stream period
+#define BENCH_TIMEOUT_US		5000000
+
+static CAN_HandleTypeDef					hcan_slave = {0};
+static CAN_HandleTypeDef					hcan_master = {1};
+static CAN_Transfer_HandleTypeDef	Slave_Link;
+static CAN_Transfer_HandleTypeDef	Master_Link;
+static uint8_t										Slave_Buf[TRANSFER_MAX_LEN];
+static uint8_t										Master_Buf[TRANSFER_MAX_LEN];
+static uint8_t										Payload[TRANSFER_MAX_LEN];
+
+static uint8_t										Rx_Done;
+static uint16_t										Rx_Len;
+static uint8_t										Tx_Done;
+static uint8_t										Tx_Failed;
+static uint32_t										Stream_Release;
+
+/**
+  * @brief  Receive function of each node, as its Rx interrupt
+  */
+static void Slave_Rx(CAN_HandleTypeDef *hcan, CAN_RxMessage *RxMessage)
+{
+	if (RxMessage->RxHeader.StdId == Slave_Link.rx_id)
+		CAN_Transfer_Rx_Handle(&Slave_Link, RxMessage);
+}
+
+static void Master_Rx(CAN_HandleTypeDef *hcan, CAN_RxMessage *RxMessage)
+{
+	if (RxMessage->RxHeader.StdId == Master_Link.rx_id)
+		CAN_Transfer_Rx_Handle(&Master_Link, RxMessage);
+}
+
+void CAN_Transfer_RxCplt_Callback(CAN_Transfer_HandleTypeDef *htp, uint8_t *data, uint16_t len)
+{
+	if (htp != &Master_Link)
+		return;
+	Rx_Len = len;
+	Rx_Done = (len <= sizeof(Payload) && memcmp(data, Payload, len) == 0) ? 1 : 2;
+}
+
+void CAN_Transfer_TxCplt_Callback(CAN_Transfer_HandleTypeDef *htp)
+{
+	if (htp == &Slave_Link)
+		Tx_Done = 1;
+}
+
+void CAN_Transfer_Error_Callback(CAN_Transfer_HandleTypeDef *htp)
+{
+	if (htp == &Slave_Link)
+		Tx_Failed = 1;
+}
+
+/**
+  * @brief  Loading the sensor stream frames of the slave, they outrank transfer frames
+	* @param 	now      Current time in microsecond.
+  */
+static void Slave_Stream(uint32_t now)
+{
+	static const uint8_t data[8] = {0};
+	CAN_TxHeaderTypeDef TxHeader;
+	uint32_t mailbox;
+
+	if ((int32_t)(now - Stream_Release) < 0)
+		return;
+	Stream_Release += BENCH_STREAM_US;
+
+	CAN_TxHeader_Init(&TxHeader, CAN_STDID(FUNC_DATA, BENCH_NODE, ENC_ID, ENC_DATA_ID), ENC_DATA_DLC);
+	CAN_Transmit(&hcan_slave, &TxHeader, (uint8_t *)data, &mailbox);
+	CAN_TxHeader_Init(&TxHeader, CAN_STDID(FUNC_DATA, BENCH_NODE, IMU_ID, IMU_DATA_ID), IMU_DATA_DLC);
+	CAN_Transmit(&hcan_slave, &TxHeader, (uint8_t *)data, &mailbox);
+}
+
+/**
+  * @brief  Sending one payload from slave to master
+	* @param 	len      		Payload length.
+	* @param 	block_size  Block size asked by the master.
+	* @param 	error       Share of frames destroyed by an error frame, per mille.
+	* @param 	stream      Sensor streams running (1) or not (0).
+	* @return	0 if the payload arrived unchanged
+  */
+static int Bench_Run(uint16_t len, uint8_t block_size, uint16_t error, uint8_t stream)
+{
+	CAN_Sim_Init(BENCH_BITRATE, error, len * 31 + block_size + 7);
+	CAN_Sim_Attach(&hcan_slave, Slave_Rx);
+	CAN_Sim_Attach(&hcan_master, Master_Rx);
+
+	uint32_t slave_id = CAN_STDID(FUNC_BULK, BENCH_NODE, SLAVE_ID, BULK_SLAVE_ID);
+	uint32_t master_id = CAN_STDID(FUNC_BULK, BENCH_NODE, SLAVE_ID, BULK_MASTER_ID);
+	CAN_Transfer_Init(&Slave_Link, &hcan_slave, slave_id, master_id, Slave_Buf, sizeof(Slave_Buf));
+	CAN_Transfer_Init(&Master_Link, &hcan_master, master_id, slave_id, Master_Buf, sizeof(Master_Buf));
+	CAN_Transfer_Config(&Master_Link, block_size, 0);
+
+	for (uint16_t i = 0; i < len; i++)
+		Payload[i] = (uint8_t)(i * 7 + len);
+	Rx_Done = Tx_Done = Tx_Failed = 0;
+	Stream_Release = 0;
+
+	uint32_t start = CAN_Sim_Get_Us();
+	if (CAN_Transfer_Send(&Slave_Link, Payload, len) != HAL_OK)
+	{
+		printf("len %4u: send refused\n", len);
+		return 1;
+	}
+
+	while ((!Rx_Done || !Tx_Done) && !Tx_Failed && CAN_Sim_Get_Us() - start < BENCH_TIMEOUT_US)
+	{
+		if (stream)
+			Slave_Stream(CAN_Sim_Get_Us());
+		CAN_Transfer_Handle(&Slave_Link);
+		CAN_Transfer_Handle(&Master_Link);
+		CAN_Sim_Step(BENCH_LOOP_US);
+	}
+	uint32_t elapsed = CAN_Sim_Get_Us() - start;
+
+	CAN_Sim_StatTypeDef *stat = CAN_Sim_Get_Stat();
+	int fail = (Rx_Done != 1 || Rx_Len != len || !Tx_Done || Slave_Link.tx_count != 1 || Tx_Failed || Master_Link.error_count);
+	printf("len %4u bs %3u err %2u%% stream %u: %s %7lu us %8.0f byte/s, frames %5lu retried %4lu bus %3lu%%\n",
+				 len, block_size, error / 10, stream, fail ? "FAIL" : "ok  ", (unsigned long)elapsed,
+				 elapsed ? len * 1e6 / elapsed : 0.0, (unsigned long)stat->frames, (unsigned long)stat->errors,
+				 elapsed ? (unsigned long)(stat->busy_us * 100ULL / elapsed) : 0UL);
+	return fail;
+}
+
+int main(void)
+{
+	static const uint16_t len[] = {1, 7, 8, 62, 63, 256, 1000, 4095};
+	static const uint8_t block_size[] = {0, 8};
+	static const uint16_t error[] = {0, 50};
+	int fail = 0;
+
+	for (uint8_t s = 0; s < 2; s++)
+		for (uint8_t e = 0; e < sizeof(error) / sizeof(error[0]); e++)
+			for (uint8_t b = 0; b < sizeof(block_size); b++)
+				for (uint8_t l = 0; l < sizeof(len) / sizeof(len[0]); l++)
+					fail |= Bench_Run(len[l], block_size[b], error[e], s);
+
+	printf("%s\n", fail ? "bench_transfer: FAIL" : "bench_transfer: all payloads received unchanged");
+	return fail;
+}
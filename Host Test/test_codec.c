@@ -0,0 +1,109 @@
+/**
+  ******************************************************************************
+  * @file    	test_codec.c
+  * @author  	Nguyen Vu
+  * @brief   	Round trip of every message of CAN_MESSAGE_TABLE: pack gives
+	*						the fields LSB first in table order, unpack gives them back
+  *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "CANCodeclib.h"
+
+/**
+  * @brief  Test setting
+  */
+#define TEST_ROUND_NUM			1000
+
+static uint32_t	Test_Seed = 1;
+static int			Test_Fail;
+
+/**
+  * @brief  Pseudo random value
+  */
+static uint32_t Test_Random(void)
+{
+	Test_Seed = Test_Seed * 1664525 + 1013904223;
+	return Test_Seed;
+}
+
+/**
+  * @brief  Storing the low bytes of a value in a field, float gets the bits
+	* @param 	dst      	Field.
+	* @param 	size      Field size.
+	* @param 	value     Value.
+  */
+static void Test_Store(void *dst, size_t size, uint32_t value)
+{
+	uint8_t u8 = value;
+	uint16_t u16 = value;
+	if (size == 1)
+		memcpy(dst, &u8, 1);
+	else if (size == 2)
+		memcpy(dst, &u16, 2);
+	else
+		memcpy(dst, &value, 4);
+}
+
+/**
+  * @brief  Field generators of the test, one F(type, field) row of a message
+	* @note		SET gives the field a value and writes the expected wire bytes,
+	*					LSB first with shifts so the check does not rely on memory order.
+  */
+#define TEST_FIELD_SET(type, field) \
+	{ \
+		uint32_t value = (round == 0) ? 0 : (round == 1) ? 0xFFFFFFFFU : Test_Random(); \
+		Test_Store(&msg.field, sizeof(type), value); \
+		for (size_t i = 0; i < sizeof(type); i++) \
+			expect[pos++] = (uint8_t)(value >> (8 * i)); \
+	}
+#define TEST_FIELD_CMP(type, field) \
+	if (memcmp(&msg.field, &back.field, sizeof(type)) != 0) \
+		field_error++;
+
+/**
+  * @brief  Test generator, one X(name) row of CAN_MESSAGE_TABLE
+  */
+#define TEST_MESSAGE(name) \
+static void Test_##name(void) \
+{ \
+	int field_error = 0, wire_error = 0, size_error = 0; \
+	for (uint32_t round = 0; round < TEST_ROUND_NUM; round++) \
+	{ \
+		CAN_Msg_##name##_TypeDef msg, back; \
+		uint8_t expect[8] = {0}, data[8] = {0}, again[8] = {0}; \
+		uint8_t pos = 0; \
+		memset(&msg, 0, sizeof(msg)); \
+		memset(&back, 0, sizeof(back)); \
+		CAN_MSG_##name(TEST_FIELD_SET) \
+		\
+		if (pos != name##_DLC || CAN_Msg_##name##_Pack(&msg, data) != name##_DLC) \
+			size_error++; \
+		if (memcmp(data, expect, 8) != 0) \
+			wire_error++; \
+		if (CAN_Msg_##name##_Unpack(&back, expect) != name##_DLC) \
+			size_error++; \
+		CAN_MSG_##name(TEST_FIELD_CMP) \
+		CAN_Msg_##name##_Pack(&back, again); \
+		if (memcmp(again, expect, 8) != 0) \
+			wire_error++; \
+	} \
+	printf("%-12s DLC %u: %s", #name, (unsigned)name##_DLC, \
+				 (field_error || wire_error || size_error) ? "FAIL" : "ok"); \
+	if (field_error || wire_error || size_error) \
+		printf(" (field %d, wire %d, size %d)", field_error, wire_error, size_error); \
+	printf("\n"); \
+	Test_Fail |= (field_error || wire_error || size_error); \
+}
+
+CAN_MESSAGE_TABLE(TEST_MESSAGE)
+
+#define TEST_CALL(name)		Test_##name();
+
+int main(void)
+{
+	CAN_MESSAGE_TABLE(TEST_CALL)
+	printf("%s\n", Test_Fail ? "test_codec: FAIL" : "test_codec: every message round-trips");
+	return Test_Fail;
+}
@@ -16,9 +16,11 @@
   [..]
     This section provides functions allowing to:
     (+) Initialize Encoder.
+    (+) Configure resolution and wheel diameter.
     (+) Counting CNT value and handling overflow / breakdown.
     (+) Converting CNT value to encoder's pulse.
     (+) Calculating position.
+    (+) Latching position without changing encoder state.
   */
 
 
@@ -34,9 +36,22 @@ void Encoder_Init(Encoder_HandleTypeDef *encoder, TIM_HandleTypeDef *htim, uint1
 {
 	encoder->htim = htim;
 	encoder->Z_Pin = Z_Pin;
-	encoder->resolution = resolution;
 	encoder->CNT_value = 0;
 	encoder->last_CNT_value = encoder->pulse = 0;
+	Encoder_Config(encoder, resolution, WHEEL_DIAMETER);
+}
+
+/**
+  * @brief  Configure resolution and wheel diameter
+	* @note		Position scale is computed here once, not in every position update
+	* @param	encoder   		Pointer to the Encoder_HandleTypeDef structure.
+	* @param 	resolution 		Resolution of the encoder (number of pulses per revolution).
+	* @param	wheel_diameter
+  */
+void Encoder_Config(Encoder_HandleTypeDef *encoder, uint16_t resolution, float wheel_diameter)
+{
+	encoder->resolution = resolution;
+	encoder->scale = (float)(PI*wheel_diameter/resolution);
 }
 
 /**
@@ -49,6 +64,26 @@ void Encoder_CNT_Counter(Encoder_HandleTypeDef *encoder)
 	//update current CNT value
 	uint16_t current_CNT_value = encoder->htim->Instance->CNT;
 	
+	//difference between CNT current value and last CNT value
+	int16_t diff = Encoder_CNT_Diff(encoder, current_CNT_value);
+	
+	//update total CNT and last CNT value together, Encoder_Latch_Position may read them in interrupt
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	encoder->CNT_value += diff;
+	encoder->last_CNT_value = current_CNT_value;
+	__set_PRIMASK(primask);
+}
+
+/**
+  * @brief 	Difference between a CNT value and last CNT value
+	*					handling CNT overflow / breakdown
+  * @param 	encoder		Pointer to the Encoder_HandleTypeDef structure.
+	* @param	current_CNT_value	CNT value read from timer.
+	* @return	CNT difference
+  */
+int16_t Encoder_CNT_Diff(Encoder_HandleTypeDef *encoder, uint16_t current_CNT_value)
+{
 	//difference between CNT current value and last CNT value
 	int16_t diff;
 	
@@ -74,11 +109,7 @@ void Encoder_CNT_Counter(Encoder_HandleTypeDef *encoder)
 			diff = current_CNT_value + (TIMER_MAX_CNT - encoder->last_CNT_value);
 	}
 	
-	//update total CNT
-	encoder->CNT_value += diff;
-	
-	//update last CNT value
-	encoder->last_CNT_value = current_CNT_value;
+	return diff;
 }
 
 /**
@@ -95,15 +126,26 @@ void Encoder_Pulse_Counter(Encoder_HandleTypeDef *encoder)
 /**
   * @brief 	Counting encoder's pulse
 	* @note 	Placing in the while loop to update all CNT value
-	*					postition = wheel_circumference*pulse/resolution
+	*					postition = wheel_circumference*pulse/resolution = scale*pulse
 	* @param	encoder		Pointer to the Encoder_HandleTypeDef structure.
-	* @param	wheel_diameter
   */
-void Encoder_Position_Handle(Encoder_HandleTypeDef *encoder, float wheel_diameter)
+void Encoder_Position_Handle(Encoder_HandleTypeDef *encoder)
 {
 	Encoder_CNT_Calibration(encoder);
 	Encoder_Pulse_Counter(encoder);
-	encoder->position = encoder->asign_position + PI*wheel_diameter*encoder->pulse/encoder->resolution;
+	encoder->position = encoder->asign_position + encoder->scale*encoder->pulse;
+}
+
+/**
+  * @brief 	Latching current position
+	* @note 	Safe to call in interupt (SYNC), encoder state is not changed
+	* @param	encoder		Pointer to the Encoder_HandleTypeDef structure.
+	* @return	Position at the moment of calling
+  */
+float Encoder_Latch_Position(Encoder_HandleTypeDef *encoder)
+{
+	int32_t CNT_value = encoder->CNT_value + Encoder_CNT_Diff(encoder, encoder->htim->Instance->CNT);
+	return encoder->asign_position + encoder->scale*(CNT_value/4);
 }
 
 /** @brief    Encoder calibration funtion using Z pulse and GPIO interupt
@@ -19,6 +19,7 @@
 #define ZX_PIN					GPIO_PIN_3
 #define ZY_PIN					GPIO_PIN_4
 #define WHEEL_DIAMETER	50.0
+#define ENCODER_RESOLUTION	1000
 
 /**
   * @brief  Constant Value
@@ -45,13 +46,17 @@ typedef struct
 	uint8_t						last_direction		;
 	int16_t						round_counter			;
 	
+	float							scale							;
 	float							asign_position		;
 	float							position					;
 }Encoder_HandleTypeDef;
 
 /* Initialization and basic handling functions  *******************************/
 void Encoder_Init(Encoder_HandleTypeDef *encoder, TIM_HandleTypeDef *htim, uint16_t resolution, uint16_t Z_Pin);
-void Encoder_Position_Handle(Encoder_HandleTypeDef *encoder, float wheel_diameter);	
+void Encoder_Config(Encoder_HandleTypeDef *encoder, uint16_t resolution, float wheel_diameter);
+void Encoder_Position_Handle(Encoder_HandleTypeDef *encoder);	
+int16_t Encoder_CNT_Diff(Encoder_HandleTypeDef *encoder, uint16_t current_CNT_value);
+float Encoder_Latch_Position(Encoder_HandleTypeDef *encoder);
 
 /* Calibration using z pulse functions  ***************************************/
 void Encoder_Zpulse_Dectect(Encoder_HandleTypeDef *encoder, uint16_t GPIO_Pin);
@@ -43,9 +43,13 @@ static uint8_t checksum;
   * @brief  IMU data in handling
 	*	@param	data	Saving data in value
 	*	@note		Place this function in UART interupt
+	*	@return	1 when the byte completes a frame for IMU_Data_Process
   */
-void IMU_Data_In(uint8_t data)
+uint8_t IMU_Data_In(uint8_t data)
 {
+	//Frame is waiting for IMU_Data_Process, drop bytes instead of overflowing buff
+	if (uart_flag)
+		return 0;
 	//wait for IMU address
 	if (data == 0x55 && data_len == 0)
 		recieve_flag = 1;
@@ -57,7 +61,11 @@ void IMU_Data_In(uint8_t data)
 	}
 	//Set flag after data buff is full
 	if (data_len > 10)
+	{
 		uart_flag = 1;
+		return 1;
+	}
+	return 0;
 }
 
 
@@ -81,13 +89,16 @@ void IMU_Data_Process(Angle_ReadTypeDef *angle, uint8_t aData[])
 			  angle->x = ((float)((short)buff[3] << 8| buff[2])/32768.0)*180.0;
 			  angle->y = ((float)((short)buff[5] << 8| buff[4])/32768.0)*180.0;
 			  angle->z = ((float)((short)buff[7] << 8| buff[6])/32768.0)*180.0;
-				//Saving HEX value
+				//Saving HEX value, SYNC interupt may latch it
+				uint32_t primask = __get_PRIMASK();
+				__disable_irq();
 				aData[0] = buff[2];
 				aData[1] = buff[3];
 				aData[2] = buff[4];
 				aData[3] = buff[5];
 				aData[4] = buff[6];
 				aData[5] = buff[7];
+				__set_PRIMASK(primask);
 		  }
 			//Reset flag
 		  uart_flag = 0;
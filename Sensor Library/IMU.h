@@ -22,7 +22,7 @@ typedef struct
 }Angle_ReadTypeDef;
 
 /* Basic handling functions  **************************************************/
-void IMU_Data_In(uint8_t data);
+uint8_t IMU_Data_In(uint8_t data);
 void IMU_Data_Process(Angle_ReadTypeDef *angle, uint8_t aData[]);
 
 /* IMU controlling functions  *************************************************/
@@ -0,0 +1,293 @@
+/**
+  ******************************************************************************
+  * @file    	FlashConfig.c
+  * @author  	Nguyen Vu
+	*	@version 	1.1.0
+  * @brief   	This file provides function to keep configuration
+	*						in the last two flash pages over power cycle
+  *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "FlashConfig.h"
+#include "string.h"
+
+#define FLASH_CONFIG_RECORD_SIZE		sizeof(Flash_Config_TypeDef)
+#define FLASH_CONFIG_RECORD_NUM			((FLASH_CONFIG_PAGE_SIZE - FLASH_CONFIG_HEADER_SIZE) / FLASH_CONFIG_RECORD_SIZE)
+
+//A new field must not silently cut the saves between two page erases
+typedef char Flash_Config_RecordCheck[(FLASH_CONFIG_RECORD_NUM >= FLASH_CONFIG_RECORD_MIN) ? 1 : -1];
+
+/** @brief    Flash page function
+  ==============================================================================
+											##### Flash Page Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Finding the active page from the page headers.
+    (+) Finding the newest valid record and the first free slot of a page.
+    (+) Programming and erasing.
+  */
+
+/**
+  * @brief  Checking a flash area is erased
+	* @param 	address     Start address.
+	* @param 	size      	Size in byte, multiple of 4.
+	* @return	Erased (1) or not (0)
+  */
+static uint8_t Flash_Config_isErased(uint32_t address, uint32_t size)
+{
+	for (uint32_t i = 0; i < size; i += 4)
+		if (*(const uint32_t *)(address + i) != 0xFFFFFFFF)
+			return 0;
+	return 1;
+}
+
+/**
+  * @brief  Getting sequence of a page
+	* @param 	page     Page address.
+	* @return	Sequence, 0 if the page has no valid header
+  */
+static uint32_t Flash_Config_Page_Seq(uint32_t page)
+{
+	const uint32_t *header = (const uint32_t *)page;
+
+	if (header[1] != FLASH_CONFIG_PAGE_MAGIC || header[0] == 0 || header[0] == 0xFFFFFFFF)
+		return 0;
+	return header[0];
+}
+
+/**
+  * @brief  Finding the active page
+	* @return	Page address, 0 if no page has a valid header
+  */
+static uint32_t Flash_Config_Active_Page(void)
+{
+	uint32_t seq0 = Flash_Config_Page_Seq(FLASH_CONFIG_PAGE0);
+	uint32_t seq1 = Flash_Config_Page_Seq(FLASH_CONFIG_PAGE1);
+
+	if (!seq0 && !seq1)
+		return 0;
+	return (seq0 > seq1) ? FLASH_CONFIG_PAGE0 : FLASH_CONFIG_PAGE1;
+}
+
+/**
+  * @brief  Finding the newest valid record of a page
+	* @note		A record torn by a reset fails CRC and is skipped
+	* @param 	page     		Page address.
+	* @param 	free     		Pointer to store the first free slot, page end if full.
+	* @param 	records     Pointer to store the number of used slots.
+	* @return	Newest valid record, NULL if none
+  */
+static const Flash_Config_TypeDef *Flash_Config_Last_Record(uint32_t page, uint32_t *free, uint16_t *records)
+{
+	const Flash_Config_TypeDef *last = NULL;
+	uint32_t address = page + FLASH_CONFIG_HEADER_SIZE;
+
+	*records = 0;
+	for (; address + FLASH_CONFIG_RECORD_SIZE <= page + FLASH_CONFIG_PAGE_SIZE; address += FLASH_CONFIG_RECORD_SIZE)
+	{
+		const Flash_Config_TypeDef *record = (const Flash_Config_TypeDef *)address;
+
+		if (Flash_Config_isErased(address, FLASH_CONFIG_RECORD_SIZE))
+			break;
+
+		(*records)++;
+		if (record->magic == FLASH_CONFIG_MAGIC &&
+				record->crc == Flash_Config_CRC32((const uint8_t *)record, FLASH_CONFIG_RECORD_SIZE - sizeof(uint32_t)))
+			last = record;
+	}
+
+	*free = address;
+	return last;
+}
+
+/**
+  * @brief  Programming and verifying data
+	* @note		Flash must be unlocked
+	* @param 	address     Start address, half word aligned.
+	* @param 	data      	Data array.
+	* @param 	size      	Size in byte, multiple of 2.
+	* @return	HAL status, HAL_ERROR if read back differs
+  */
+static HAL_StatusTypeDef Flash_Config_Program(uint32_t address, const void *data, uint32_t size)
+{
+	HAL_StatusTypeDef status = HAL_OK;
+	const uint16_t *half = (const uint16_t *)data;
+
+	//Program half word by half word
+	for (uint32_t i = 0; i < size / 2 && status == HAL_OK; i++)
+		status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, address + 2 * i, half[i]);
+
+	if (status == HAL_OK && memcmp((const void *)address, data, size))
+		status = HAL_ERROR;
+	return status;
+}
+
+/**
+  * @brief  Erasing a page if it is not erased yet
+	* @note		Flash must be unlocked
+	* @param 	page     Page address.
+	* @return	HAL status
+  */
+static HAL_StatusTypeDef Flash_Config_Erase(uint32_t page)
+{
+	FLASH_EraseInitTypeDef erase;
+	uint32_t page_error;
+
+	if (Flash_Config_isErased(page, FLASH_CONFIG_PAGE_SIZE))
+		return HAL_OK;
+
+	erase.TypeErase = FLASH_TYPEERASE_PAGES;
+	erase.PageAddress = page;
+	erase.NbPages = 1;
+	return HAL_FLASHEx_Erase(&erase, &page_error);
+}
+
+/** @brief    Flash configuration function
+  ==============================================================================
+									##### Flash Configuration Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Filling default configuration.
+    (+) Loading configuration, default if no valid record is found.
+    (+) Saving configuration as a new record.
+    (+) Counting records of the active page.
+	[..]
+		Saving programs one record (about 2 ms), a page swap also erases a page
+		(about 20 ms), do not call it from interrupt or while streaming at high rate.
+  */
+
+/**
+  * @brief  Filling default configuration
+	* @param 	config      Pointer to the Flash_Config_TypeDef structure.
+  */
+void Flash_Config_Default(Flash_Config_TypeDef *config)
+{
+	config->magic = FLASH_CONFIG_MAGIC;
+	config->bitrate = FLASH_CONFIG_BITRATE;
+	config->sample_point = FLASH_CONFIG_SAMPLE;
+	config->node_id = FLASH_CONFIG_NODE;
+	config->node_valid = 0;
+	config->param_num = 0;
+	for (uint8_t i = 0; i < FLASH_CONFIG_PARAM_NUM; i++)
+		config->param[i] = 0;
+	for (uint8_t i = 0; i < FLASH_CONFIG_STREAM_NUM; i++)
+	{
+		config->stream_mode[i] = FLASH_CONFIG_STREAM_OFF;
+		config->stream_period_us[i] = 0;
+	}
+	config->enc_position[0] = 0;
+	config->enc_position[1] = 0;
+	for (uint8_t i = 0; i < FLASH_CONFIG_MAP_NUM; i++)
+	{
+		config->map_num[i] = 0;
+		for (uint8_t j = 0; j < FLASH_CONFIG_MAP_ENTRY; j++)
+			config->map[i][j] = 0;
+	}
+	config->crc = 0;
+}
+
+/**
+  * @brief  Loading configuration
+	* @param 	config      Pointer to store the configuration.
+	* @return	HAL_OK if flash holds a valid configuration, HAL_ERROR and default if not
+  */
+HAL_StatusTypeDef Flash_Config_Load(Flash_Config_TypeDef *config)
+{
+	uint32_t page = Flash_Config_Active_Page();
+	const Flash_Config_TypeDef *stored = NULL;
+	uint32_t free;
+	uint16_t records;
+
+	if (page)
+		stored = Flash_Config_Last_Record(page, &free, &records);
+
+	if (stored == NULL)
+	{
+		Flash_Config_Default(config);
+		return HAL_ERROR;
+	}
+
+	*config = *stored;
+	return HAL_OK;
+}
+
+/**
+  * @brief  Saving configuration
+	* @param 	config      Pointer to the Flash_Config_TypeDef structure, crc is updated.
+	* @return	HAL status
+  */
+HAL_StatusTypeDef Flash_Config_Save(Flash_Config_TypeDef *config)
+{
+	uint32_t page = Flash_Config_Active_Page();
+	const Flash_Config_TypeDef *stored = NULL;
+	uint32_t free = 0;
+	uint16_t records;
+	HAL_StatusTypeDef status = HAL_ERROR;
+
+	config->magic = FLASH_CONFIG_MAGIC;
+	config->crc = Flash_Config_CRC32((const uint8_t *)config, FLASH_CONFIG_RECORD_SIZE - sizeof(uint32_t));
+
+	//Nothing changed, save a record
+	if (page)
+		stored = Flash_Config_Last_Record(page, &free, &records);
+	if (stored != NULL && !memcmp(stored, config, FLASH_CONFIG_RECORD_SIZE))
+		return HAL_OK;
+
+	HAL_FLASH_Unlock();
+
+	//Append to the active page
+	if (page && free + FLASH_CONFIG_RECORD_SIZE <= page + FLASH_CONFIG_PAGE_SIZE)
+		status = Flash_Config_Program(free, config, FLASH_CONFIG_RECORD_SIZE);
+
+	//Page full, no page yet or a bad slot: swap to the other page, header is written last
+	if (status != HAL_OK)
+	{
+		uint32_t next = (page == FLASH_CONFIG_PAGE0) ? FLASH_CONFIG_PAGE1 : FLASH_CONFIG_PAGE0;
+		uint32_t header[2] = {page ? Flash_Config_Page_Seq(page) + 1 : 1, FLASH_CONFIG_PAGE_MAGIC};
+
+		status = Flash_Config_Erase(next);
+		if (status == HAL_OK)
+			status = Flash_Config_Program(next + FLASH_CONFIG_HEADER_SIZE, config, FLASH_CONFIG_RECORD_SIZE);
+		if (status == HAL_OK)
+			status = Flash_Config_Program(next, header, sizeof(header));
+	}
+
+	HAL_FLASH_Lock();
+	return status;
+}
+
+/**
+  * @brief  Counting records of the active page
+	* @return	Used record slots, 0 if no page is active
+  */
+uint16_t Flash_Config_Get_Records(void)
+{
+	uint32_t page = Flash_Config_Active_Page();
+	uint32_t free;
+	uint16_t records = 0;
+
+	if (page)
+		Flash_Config_Last_Record(page, &free, &records);
+	return records;
+}
+
+/**
+  * @brief  Computing CRC32 (IEEE 802.3, bitwise)
+	* @param 	data      Data array.
+	* @param 	length    Data length in byte.
+	* @return	CRC32
+  */
+uint32_t Flash_Config_CRC32(const uint8_t *data, uint32_t length)
+{
+	uint32_t crc = 0xFFFFFFFF;
+
+	for (uint32_t i = 0; i < length; i++)
+	{
+		crc ^= data[i];
+		for (uint8_t bit = 0; bit < 8; bit++)
+			crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+	}
+	return ~crc;
+}
@@ -0,0 +1,89 @@
+/**
+  ******************************************************************************
+  * @file    	FlashConfig.h
+  * @author  	Nguyen Vu
+  * @brief   	This file contains all the functions prototypes
+	*						for the persistent configuration in flash
+  *****************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef FLASHCONFIG_H_
+#define FLASHCONFIG_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f1xx_hal.h"
+
+/**
+  * @brief  Configuration Value
+	* @note		Last two 1 KB pages of the 64 KB flash, keep them out of the linker IROM region.
+	*					Configuration is appended as a record to the active page, the newest
+	*					valid record wins. A full page is swapped: the record is written to
+	*					the other page, then its header, so a reset during swap keeps the old page.
+	*					Page header: [sequence (32 bit)][FLASH_CONFIG_PAGE_MAGIC], higher sequence is active.
+	*					A page holds 6 records of 148 bytes after its header, so a page is
+	*					erased once every 6 saves that change the configuration. A build
+	*					fails if the record grows past FLASH_CONFIG_RECORD_MIN per page.
+  */
+#define FLASH_CONFIG_PAGE0				0x0800F800U
+#define FLASH_CONFIG_PAGE1				0x0800FC00U
+#define FLASH_CONFIG_PAGE_SIZE		0x400U
+#define FLASH_CONFIG_HEADER_SIZE	8
+#define FLASH_CONFIG_PAGE_MAGIC		0x50414745U		//"EGAP"
+#define FLASH_CONFIG_RECORD_MIN		6							//Records a page must hold, saves between two erases
+#define FLASH_CONFIG_MAGIC				0x34474643U		//"CFG4"
+#define FLASH_CONFIG_PARAM_NUM		8							//Runtime parameter slots
+#define FLASH_CONFIG_STREAM_NUM		4							//Stream slots, by sensor ID
+#define FLASH_CONFIG_STREAM_OFF		0xFF					//Stream mode of a sensor not started
+#define FLASH_CONFIG_MAP_NUM			2							//Signal mapping slots, by sensor ID
+#define FLASH_CONFIG_MAP_ENTRY		8							//Entries of a signal mapping
+
+/**
+  * @brief  Default value
+  */
+#define FLASH_CONFIG_BITRATE		500000U
+#define FLASH_CONFIG_SAMPLE			875				//Sample point in per mille
+#define FLASH_CONFIG_NODE				0
+
+/**
+  * @brief  Persistent configuration struct
+	* @param	magic					FLASH_CONFIG_MAGIC when the page holds a configuration
+	* @param	bitrate				CAN bit rate in bit/s
+	* @param	sample_point	CAN sample point in per mille
+	* @param	node_id				CAN node ID
+	* @param	node_valid		node_id was claimed or set by master (1), default (0)
+	* @param	param_num			Runtime parameters saved, the others use their default
+	* @param	param					Raw value of runtime parameters, by index
+	* @param	stream_mode		Stream mode of each sensor, FLASH_CONFIG_STREAM_OFF if not started
+	* @param	stream_period_us	Stream period of each sensor in microsecond
+	* @param	enc_position	Last assigned encoder position (x, y)
+	* @param	map_num				Entries of each signal mapping, 0 is the default mapping
+	* @param	map						Signal mapping entries: [signal][bit position][width][0]
+	* @param	crc						CRC32 of every field before it
+  */
+typedef struct
+{
+	uint32_t	magic;
+	uint32_t	bitrate;
+	uint16_t	sample_point;
+	uint8_t		node_id;
+	uint8_t		node_valid;
+	uint32_t	param_num;
+	uint32_t	param[FLASH_CONFIG_PARAM_NUM];
+	uint8_t		stream_mode[FLASH_CONFIG_STREAM_NUM];
+	uint32_t	stream_period_us[FLASH_CONFIG_STREAM_NUM];
+	float			enc_position[2];
+	uint16_t	map_num[FLASH_CONFIG_MAP_NUM];
+	uint32_t	map[FLASH_CONFIG_MAP_NUM][FLASH_CONFIG_MAP_ENTRY];
+	uint32_t	crc;
+}Flash_Config_TypeDef;
+
+/* Configuration functions  ***************************************************/
+void Flash_Config_Default(Flash_Config_TypeDef *config);
+HAL_StatusTypeDef Flash_Config_Load(Flash_Config_TypeDef *config);
+HAL_StatusTypeDef Flash_Config_Save(Flash_Config_TypeDef *config);
+uint16_t Flash_Config_Get_Records(void);
+
+/* Support functions  *********************************************************/
+uint32_t Flash_Config_CRC32(const uint8_t *data, uint32_t length);
+
+#endif
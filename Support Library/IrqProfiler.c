@@ -0,0 +1,201 @@
+/**
+  ******************************************************************************
+  * @file    	IrqProfiler.c
+  * @author  	Nguyen Vu
+	*	@version 	1.0.0
+  * @brief   	This file provides function to measure the entries, run time
+	*						and nesting of every interrupt handler with the cycle counter
+  *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "IrqProfiler.h"
+
+#if IRQ_PROFILER_ENABLE
+
+/**
+  * @brief  Running handler, one per nesting level
+	* @param	start		Cycle counter at entry
+	* @param	nested	Cycles spent in handlers nested in this one
+  */
+typedef struct
+{
+	uint32_t	start;
+	uint32_t	nested;
+}Irq_Profiler_FrameTypeDef;
+
+static Irq_Profiler_HandleTypeDef	Irq_Profiler;
+static Irq_Profiler_FrameTypeDef	Irq_Frame[IRQ_PROFILER_DEPTH];
+static volatile uint8_t						Irq_Depth;
+
+/** @brief    Interrupt profiler basic function
+  ==============================================================================
+									##### Interrupt Profiler Basic Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Initialize the cycle counter and the statistic.
+    (+) Stamping handler entry and exit.
+    (+) Closing the CPU load window.
+	[..]
+		Place IRQ_PROFILE_ENTER first and IRQ_PROFILE_EXIT last in each handler
+		with the same ID. Bookkeeping runs with interrupt locked for a few cycles.
+  */
+
+/**
+  * @brief  Initializes the profiler
+	* @note		Call before while loop, handlers entered before are not counted
+  */
+void Irq_Profiler_Init(void)
+{
+	Timebase_Cycle_Init();
+	Irq_Profiler_Reset();
+}
+
+/**
+  * @brief  Resetting every statistic
+  */
+void Irq_Profiler_Reset(void)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	Irq_Profiler = (Irq_Profiler_HandleTypeDef){0};
+	Irq_Profiler.window_start_us = Timebase_Get_Us();
+	__set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Stamping a handler entry
+	* @param 	irq      IRQ ID.
+  */
+void Irq_Profiler_Enter(uint8_t irq)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint8_t depth = Irq_Depth++;
+	if (depth < IRQ_PROFILER_DEPTH)
+	{
+		Irq_Frame[depth].nested = 0;
+		Irq_Frame[depth].start = Timebase_Get_Cycle();
+	}
+
+	if (irq < IRQ_PROFILER_NUM)
+	{
+		Irq_Profiler.irq[irq].entries++;
+		if (Irq_Depth > Irq_Profiler.irq[irq].nest_max)
+			Irq_Profiler.irq[irq].nest_max = Irq_Depth;
+	}
+	Irq_Profiler.all.entries++;
+	if (Irq_Depth > Irq_Profiler.all.nest_max)
+		Irq_Profiler.all.nest_max = Irq_Depth;
+	__set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Stamping a handler exit
+	* @param 	irq      IRQ ID.
+  */
+void Irq_Profiler_Exit(uint8_t irq)
+{
+	//Stamp taken with interrupts off, a handler preempting between the
+	//stamp and the lock would add nested time the stamp does not cover
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint32_t now = Timebase_Get_Cycle();
+	if (!Irq_Depth)
+	{
+		__set_PRIMASK(primask);
+		return;
+	}
+
+	uint8_t depth = --Irq_Depth;
+	if (depth < IRQ_PROFILER_DEPTH)
+	{
+		uint32_t total = now - Irq_Frame[depth].start;
+		uint32_t nested = Irq_Frame[depth].nested;
+		uint32_t self = total - (nested < total ? nested : total);
+
+		//Handler below only keeps its own time
+		if (depth && depth - 1 < IRQ_PROFILER_DEPTH)
+			Irq_Frame[depth - 1].nested += total;
+
+		if (irq < IRQ_PROFILER_NUM)
+		{
+			Irq_Profiler_StatTypeDef *stat = &Irq_Profiler.irq[irq];
+			stat->cycles += self;
+			if (self > stat->max)
+				stat->max = self;
+			if (total > stat->max_total)
+				stat->max_total = total;
+		}
+		Irq_Profiler.all.cycles += self;
+		Irq_Profiler.window_cycles += self;
+		if (self > Irq_Profiler.all.max)
+			Irq_Profiler.all.max = self;
+		if (total > Irq_Profiler.all.max_total)
+			Irq_Profiler.all.max_total = total;
+	}
+	__set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Closing the CPU load window
+	* @note		Call this function in while loop
+  */
+void Irq_Profiler_Update(void)
+{
+	uint32_t now = Timebase_Get_Us();
+	uint32_t elapsed = now - Irq_Profiler.window_start_us;
+	if (elapsed < IRQ_PROFILER_WINDOW_US)
+		return;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint64_t cycles = Irq_Profiler.window_cycles;
+	Irq_Profiler.window_cycles = 0;
+	__set_PRIMASK(primask);
+	Irq_Profiler.window_start_us = now;
+
+	//Interrupt cycles / window cycles, in per mille
+	uint64_t load = (cycles * 1000) / ((uint64_t)elapsed * (SystemCoreClock / TIMEBASE_TICK_HZ));
+	if (load > 1000)
+		load = 1000;
+
+	Irq_Profiler.load_last = (uint16_t)load;
+	if (load > Irq_Profiler.load_peak)
+		Irq_Profiler.load_peak = (uint16_t)load;
+}
+
+/** @brief    Interrupt profiler reading function
+  ==============================================================================
+									##### Interrupt Profiler Reading Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Getting the profiler.
+    (+) Getting the statistic of a handler or of every handler.
+  */
+
+/**
+  * @brief 	Getting the profiler
+	* @return	Pointer to the Irq_Profiler_HandleTypeDef structure
+  */
+Irq_Profiler_HandleTypeDef *Irq_Profiler_Get(void)
+{
+	return &Irq_Profiler;
+}
+
+/**
+  * @brief 	Getting the statistic of a handler
+	* @param 	irq      IRQ ID, IRQ_PROFILER_ALL for every handler.
+	* @return	Pointer to the statistic, NULL if irq is out of range
+  */
+Irq_Profiler_StatTypeDef *Irq_Profiler_Get_Stat(uint8_t irq)
+{
+	if (irq == IRQ_PROFILER_ALL)
+		return &Irq_Profiler.all;
+	if (irq >= IRQ_PROFILER_NUM)
+		return NULL;
+	return &Irq_Profiler.irq[irq];
+}
+
+#endif
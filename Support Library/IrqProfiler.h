@@ -0,0 +1,93 @@
+/**
+  ******************************************************************************
+  * @file    	IrqProfiler.h
+  * @author  	Nguyen Vu
+  * @brief   	This file contains all the functions prototypes
+	*						for the interrupt handler profiler
+  *****************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef IRQPROFILER_H_
+#define IRQPROFILER_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f1xx_hal.h"
+#include "Timebase.h"
+
+/**
+  * @brief  Configuration Value
+	* @note		IRQ_PROFILER_ENABLE 0 removes the profiler, IRQ_PROFILE_ENTER and
+	*					IRQ_PROFILE_EXIT become empty so handlers cost nothing more.
+	*					Time is counted from IRQ_PROFILE_ENTER to IRQ_PROFILE_EXIT, the
+	*					exception entry and return (about 24 cycles) are not included.
+	*					Time of a nested handler is only counted for the nested one.
+  */
+#define IRQ_PROFILER_ENABLE				1
+#define IRQ_PROFILER_NUM					15				//IRQ ID is 0 to IRQ_PROFILER_NUM-1
+#define IRQ_PROFILER_ALL					0x0F			//ID of the statistic of every interrupt
+#define IRQ_PROFILER_DEPTH				8					//Nesting depth followed, deeper is not timed
+#define IRQ_PROFILER_WINDOW_US		1000000		//CPU load window
+
+/**
+  * @brief  Interrupt statistic struct
+	* @param	entries				Handler entry count
+	* @param	cycles				Cycles spent in the handler, nested handlers excluded
+	* @param	max						Longest run, nested handlers excluded
+	* @param	max_total			Longest run, nested handlers included
+	* @param	nest_max			Deepest nesting the handler ran at, 1 is not nested
+  */
+typedef struct
+{
+	uint32_t	entries;
+	uint64_t	cycles;
+	uint32_t	max;
+	uint32_t	max_total;
+	uint8_t		nest_max;
+}Irq_Profiler_StatTypeDef;
+
+/**
+  * @brief  Profiler struct
+	* @param	irq						Statistic of each handler
+	* @param	all						Statistic of every handler together
+	* @param	window_xxx		CPU load window
+	* @param	load_last			Share of the last window spent in interrupt, per mille
+	* @param	load_peak			Highest window share, per mille
+  */
+typedef struct
+{
+	Irq_Profiler_StatTypeDef	irq[IRQ_PROFILER_NUM];
+	Irq_Profiler_StatTypeDef	all;
+
+	uint32_t									window_start_us;
+	uint64_t									window_cycles;
+	uint16_t									load_last;
+	uint16_t									load_peak;
+}Irq_Profiler_HandleTypeDef;
+
+#if IRQ_PROFILER_ENABLE
+
+/* Initialization and handling functions  *************************************/
+void Irq_Profiler_Init(void);
+void Irq_Profiler_Reset(void);
+void Irq_Profiler_Enter(uint8_t irq);
+void Irq_Profiler_Exit(uint8_t irq);
+void Irq_Profiler_Update(void);
+
+/* Reading functions  *********************************************************/
+Irq_Profiler_HandleTypeDef *Irq_Profiler_Get(void);
+Irq_Profiler_StatTypeDef *Irq_Profiler_Get_Stat(uint8_t irq);
+
+#define IRQ_PROFILE_ENTER(irq)			Irq_Profiler_Enter(irq)
+#define IRQ_PROFILE_EXIT(irq)				Irq_Profiler_Exit(irq)
+
+#else
+
+#define Irq_Profiler_Init()
+#define Irq_Profiler_Reset()
+#define Irq_Profiler_Update()
+#define IRQ_PROFILE_ENTER(irq)
+#define IRQ_PROFILE_EXIT(irq)
+
+#endif
+
+#endif
@@ -0,0 +1,152 @@
+/**
+  ******************************************************************************
+  * @file    	LoopProfiler.c
+  * @author  	Nguyen Vu
+	*	@version 	1.0.0
+  * @brief   	This file provides function to measure the run time of every
+	*						task of the while loop and the loop period with the cycle counter
+  *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "LoopProfiler.h"
+
+#if LOOP_PROFILER_ENABLE
+
+static Loop_Profiler_HandleTypeDef	Loop_Profiler;
+
+/** @brief    Loop profiler basic function
+  ==============================================================================
+										##### Loop Profiler Basic Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Initialize the cycle counter and the statistic.
+    (+) Marking the start of a loop.
+    (+) Adding the run time of a task.
+	[..]
+		Wrap each call of the while loop in LOOP_PROFILE with its task ID and
+		call Loop_Profiler_Mark once per loop. A measure costs two reads of
+		the cycle counter and a few compares.
+  */
+
+/**
+  * @brief  Adding a sample
+	* @param 	stat      Pointer to the Loop_Profiler_StatTypeDef structure.
+	* @param 	cycle     Sample in cycle.
+  */
+static void Loop_Profiler_Add(Loop_Profiler_StatTypeDef *stat, uint32_t cycle)
+{
+	if (!stat->calls || cycle < stat->min)
+		stat->min = cycle;
+	if (cycle > stat->max)
+		stat->max = cycle;
+	stat->sum += cycle;
+	stat->calls++;
+}
+
+/**
+  * @brief  Initializes the profiler
+	* @note		Call before while loop
+  */
+void Loop_Profiler_Init(void)
+{
+	Timebase_Cycle_Init();
+	Loop_Profiler_Reset();
+}
+
+/**
+  * @brief  Resetting every statistic
+	* @note		The next loop period starts from the next mark
+  */
+void Loop_Profiler_Reset(void)
+{
+	Loop_Profiler = (Loop_Profiler_HandleTypeDef){0};
+}
+
+/**
+  * @brief  Marking the start of a loop
+	* @note		Call once at the top of while loop
+  */
+void Loop_Profiler_Mark(void)
+{
+	uint32_t now = Timebase_Get_Cycle();
+	uint32_t period = now - Loop_Profiler.mark_cycle;
+
+	//First mark after reset only starts the period
+	if (Loop_Profiler.mark_cycle)
+	{
+		if (Loop_Profiler.period.calls)
+		{
+			uint32_t jitter = (period > Loop_Profiler.last_period) ? period - Loop_Profiler.last_period :
+																															 Loop_Profiler.last_period - period;
+			if (jitter > Loop_Profiler.jitter_max)
+				Loop_Profiler.jitter_max = jitter;
+			Loop_Profiler.jitter_sum += jitter;
+		}
+		Loop_Profiler_Add(&Loop_Profiler.period, period);
+		Loop_Profiler.last_period = period;
+	}
+	Loop_Profiler.mark_cycle = now ? now : 1;
+}
+
+/**
+  * @brief  Adding the run time of a task
+	* @note		Called by LOOP_PROFILE
+	* @param 	task      Task ID.
+	* @param 	start     Cycle counter before the call.
+  */
+void Loop_Profiler_Task_End(uint8_t task, uint32_t start)
+{
+	uint32_t cycle = Timebase_Get_Cycle() - start;
+
+	if (task < LOOP_PROFILER_TASK_NUM)
+		Loop_Profiler_Add(&Loop_Profiler.task[task], cycle);
+}
+
+/** @brief    Loop profiler reading function
+  ==============================================================================
+										##### Loop Profiler Reading Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Getting the profiler.
+    (+) Getting the statistic of a task or of the loop period.
+    (+) Getting an average.
+  */
+
+/**
+  * @brief 	Getting the profiler
+	* @return	Pointer to the Loop_Profiler_HandleTypeDef structure
+  */
+Loop_Profiler_HandleTypeDef *Loop_Profiler_Get(void)
+{
+	return &Loop_Profiler;
+}
+
+/**
+  * @brief 	Getting the statistic of a task
+	* @param 	task      Task ID, LOOP_PROFILER_LOOP for the loop period.
+	* @return	Pointer to the statistic, NULL if task is out of range
+  */
+Loop_Profiler_StatTypeDef *Loop_Profiler_Get_Stat(uint8_t task)
+{
+	if (task == LOOP_PROFILER_LOOP)
+		return &Loop_Profiler.period;
+	if (task >= LOOP_PROFILER_TASK_NUM)
+		return NULL;
+	return &Loop_Profiler.task[task];
+}
+
+/**
+  * @brief 	Getting an average
+	* @param 	stat      Pointer to the Loop_Profiler_StatTypeDef structure.
+	* @return	Average in cycle, 0 if no sample
+  */
+uint32_t Loop_Profiler_Get_Avg(Loop_Profiler_StatTypeDef *stat)
+{
+	if (!stat->calls)
+		return 0;
+	return (uint32_t)(stat->sum / stat->calls);
+}
+
+#endif
@@ -0,0 +1,90 @@
+/**
+  ******************************************************************************
+  * @file    	LoopProfiler.h
+  * @author  	Nguyen Vu
+  * @brief   	This file contains all the functions prototypes
+	*						for the while loop task profiler
+  *****************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef LOOPPROFILER_H_
+#define LOOPPROFILER_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f1xx_hal.h"
+#include "Timebase.h"
+
+/**
+  * @brief  Configuration Value
+	* @note		LOOP_PROFILER_ENABLE 0 removes the profiler, LOOP_PROFILE only
+	*					runs the call and every function becomes empty.
+	*					Task time includes the interrupts served while it runs.
+  */
+#define LOOP_PROFILER_ENABLE		1
+#define LOOP_PROFILER_TASK_NUM	15				//Task ID is 0 to LOOP_PROFILER_TASK_NUM-1
+#define LOOP_PROFILER_LOOP			0x0F			//ID of the loop period statistic
+
+/**
+  * @brief  Statistic struct, time in cycle
+	* @param	calls		Sample count
+	* @param	min			Shortest sample
+	* @param	max			Longest sample
+	* @param	sum			Sum of every sample, average is sum / calls
+  */
+typedef struct
+{
+	uint32_t	calls;
+	uint32_t	min;
+	uint32_t	max;
+	uint64_t	sum;
+}Loop_Profiler_StatTypeDef;
+
+/**
+  * @brief  Profiler struct
+	* @param	task						Run time of each task
+	* @param	period					Loop period, from one Loop_Profiler_Mark to the next
+	* @param	mark_cycle			Cycle counter of the last mark
+	* @param	last_period			Previous loop period
+	* @param	jitter_xxx			Cycle to cycle jitter, |period - previous period|
+  */
+typedef struct
+{
+	Loop_Profiler_StatTypeDef	task[LOOP_PROFILER_TASK_NUM];
+	Loop_Profiler_StatTypeDef	period;
+	uint32_t									mark_cycle;
+	uint32_t									last_period;
+	uint32_t									jitter_max;
+	uint64_t									jitter_sum;
+}Loop_Profiler_HandleTypeDef;
+
+#if LOOP_PROFILER_ENABLE
+
+/* Initialization and handling functions  *************************************/
+void Loop_Profiler_Init(void);
+void Loop_Profiler_Reset(void);
+void Loop_Profiler_Mark(void);
+void Loop_Profiler_Task_End(uint8_t task, uint32_t start);
+
+/* Reading functions  *********************************************************/
+Loop_Profiler_HandleTypeDef *Loop_Profiler_Get(void);
+Loop_Profiler_StatTypeDef *Loop_Profiler_Get_Stat(uint8_t task);
+uint32_t Loop_Profiler_Get_Avg(Loop_Profiler_StatTypeDef *stat);
+
+/**
+  * @brief  Running a call as a profiled task
+	* @param	task		Task ID.
+	* @param	call		Statement to run.
+  */
+#define LOOP_PROFILE(task, call) \
+	do { uint32_t profile_start = Timebase_Get_Cycle(); call; Loop_Profiler_Task_End((task), profile_start); } while (0)
+
+#else
+
+#define Loop_Profiler_Init()
+#define Loop_Profiler_Reset()
+#define Loop_Profiler_Mark()
+#define LOOP_PROFILE(task, call)		do { call; } while (0)
+
+#endif
+
+#endif
@@ -0,0 +1,326 @@
+/**
+  ******************************************************************************
+  * @file    	StreamScheduler.c
+  * @author  	Nguyen Vu
+	*	@version 	1.0.0
+  * @brief   	This file provides function to release periodic streams
+	*						with microsecond resolution using a timer compare interrupt
+  *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "StreamScheduler.h"
+
+/**
+  * @brief  Minimum distance between now and the compare value
+  */
+#define STREAM_ALARM_MARGIN_US	3
+
+/**
+  * @brief  Some variables for stream scheduler
+  */
+static TIM_HandleTypeDef 		*Stream_htim;
+static Stream_HandleTypeDef *Stream_List[STREAM_MAX_NUM];
+static uint8_t 							Stream_Num;
+
+/** @brief    Stream scheduler basic function
+  ==============================================================================
+									##### Stream Scheduler Basic Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Initialize the scheduler on the timebase timer.
+    (+) Releasing due streams in timer compare interrupt.
+    (+) Arming the compare for the earliest release.
+	[..]
+		The scheduler shares the timer of Timebase, channel 1 compare is used
+		as alarm. Release time is kept in 32 bit, the 16 bit compare matches
+		every 65.536 ms so far releases simply re-arm the same compare. The
+		counter is read back after arming, a compare it already passed is
+		fired by software.
+  */
+
+/**
+  * @brief  Initializes the stream scheduler
+	* @note		Call Timebase_Init before this function
+	* @param 	htim      Pointer to the TIM_HandleTypeDef structure used by Timebase.
+  */
+void Stream_Scheduler_Init(TIM_HandleTypeDef *htim)
+{
+	Stream_htim = htim;
+	Stream_Num = 0;
+	__HAL_TIM_DISABLE_IT(htim, TIM_IT_CC1);
+}
+
+/**
+  * @brief 	Arming compare for the earliest release
+	* @note 	Call with interrupt locked or from timer interrupt
+	* @param 	now      Current time in microsecond.
+  */
+static void Stream_Alarm_Update(uint32_t now)
+{
+	uint8_t found = 0;
+	uint32_t next = 0;
+
+	//Find the earliest release
+	for (uint8_t i = 0; i < Stream_Num; i++)
+	{
+		if (!Stream_List[i]->enable)
+			continue;
+		if (!found || (int32_t)(Stream_List[i]->release_us - next) < 0)
+		{
+			next = Stream_List[i]->release_us;
+			found = 1;
+		}
+	}
+
+	if (!found)
+	{
+		__HAL_TIM_DISABLE_IT(Stream_htim, TIM_IT_CC1);
+		return;
+	}
+
+	//Release already passed, fire as soon as possible
+	if ((int32_t)(next - now) < STREAM_ALARM_MARGIN_US)
+		next = now + STREAM_ALARM_MARGIN_US;
+
+	__HAL_TIM_SET_COMPARE(Stream_htim, TIM_CHANNEL_1, (uint16_t)next);
+	__HAL_TIM_CLEAR_FLAG(Stream_htim, TIM_FLAG_CC1);
+	__HAL_TIM_ENABLE_IT(Stream_htim, TIM_IT_CC1);
+
+	//Counter passed the compare while it was written (a higher interrupt or a
+	//slow path ate the margin), the match is gone until the next 65.5 ms wrap.
+	//EGR is written directly, HAL_TIM_GenerateEvent takes the handle lock.
+	if ((int32_t)(next - Timebase_Get_Us()) <= 0)
+		Stream_htim->Instance->EGR = TIM_EGR_CC1G;
+}
+
+/**
+  * @brief 	Releasing due streams
+	* @note 	Place this function in HAL_TIM_OC_DelayElapsedCallback
+	* @param 	htim      Pointer to the TIM_HandleTypeDef structure.
+  */
+void Stream_Alarm_Handle(TIM_HandleTypeDef *htim)
+{
+	if (htim != Stream_htim || htim->Channel != HAL_TIM_ACTIVE_CHANNEL_1)
+		return;
+
+	uint32_t now = Timebase_Get_Us();
+	for (uint8_t i = 0; i < Stream_Num; i++)
+	{
+		Stream_HandleTypeDef *stream = Stream_List[i];
+		if (!stream->enable || (int32_t)(now - stream->release_us) < 0)
+			continue;
+
+		//Previous release has not been served yet
+		if (stream->due)
+			stream->missed++;
+		stream->due = 1;
+
+		//Skip releases lost while interrupt was blocked, keep phase
+		uint32_t late_periods = (now - stream->release_us) / stream->period_us;
+		stream->missed += late_periods;
+		stream->release_us += (late_periods + 1) * stream->period_us;
+	}
+	Stream_Alarm_Update(now);
+}
+
+/** @brief    Stream control function
+  ==============================================================================
+										##### Stream Control Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Registering a stream with priority and phase.
+    (+) Starting a stream with a period.
+    (+) Stopping a stream.
+    (+) Changing period of a running stream.
+    (+) Changing phase used from the next start.
+  */
+
+/**
+  * @brief  Registering a stream
+	* @note		Register every stream in the main function and before while loop
+	* @param 	stream      Pointer to the Stream_HandleTypeDef structure.
+	* @param 	priority    Priority class (STREAM_PRIORITY_x).
+	* @param 	phase_us    Release offset, use it to spread streams with same period.
+	* @return	HAL_OK, HAL_ERROR if STREAM_MAX_NUM streams are already registered
+  */
+HAL_StatusTypeDef Stream_Register(Stream_HandleTypeDef *stream, uint8_t priority, uint32_t phase_us)
+{
+	stream->priority = priority;
+	stream->phase_us = phase_us;
+	stream->enable = 0;
+	stream->due = 0;
+	Stream_Reset_Statistic(stream);
+
+	//Already registered, only update setting
+	for (uint8_t i = 0; i < Stream_Num; i++)
+		if (Stream_List[i] == stream)
+			return HAL_OK;
+
+	//Stream not in the list would never be released
+	if (Stream_Num >= STREAM_MAX_NUM)
+		return HAL_ERROR;
+	Stream_List[Stream_Num++] = stream;
+	return HAL_OK;
+}
+
+/**
+  * @brief  Starting a stream
+	* @note		First release is aligned on phase + k*period
+	* @param 	stream      Pointer to the Stream_HandleTypeDef structure.
+	* @param 	period_us   Release period in microsecond.
+  */
+void Stream_Start(Stream_HandleTypeDef *stream, uint32_t period_us)
+{
+	if (period_us < STREAM_MIN_PERIOD_US)
+		period_us = STREAM_MIN_PERIOD_US;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	uint32_t now = Timebase_Get_Us();
+	stream->period_us = period_us;
+	if ((int32_t)(now - stream->phase_us) < 0)
+		stream->release_us = stream->phase_us;
+	else
+		stream->release_us = stream->phase_us + ((now - stream->phase_us) / period_us + 1) * period_us;
+	stream->due = 0;
+	stream->enable = 1;
+	Stream_Reset_Statistic(stream);
+
+	if (Stream_htim != NULL)
+		Stream_Alarm_Update(now);
+
+	__set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Stopping a stream
+	* @param 	stream      Pointer to the Stream_HandleTypeDef structure.
+  */
+void Stream_Stop(Stream_HandleTypeDef *stream)
+{
+	stream->enable = 0;
+	stream->due = 0;
+}
+
+/**
+  * @brief  Changing period of a running stream
+	* @note		Next release is kept, new period is used from the release after,
+	*					statistic is not reset
+	* @param 	stream      Pointer to the Stream_HandleTypeDef structure.
+	* @param 	period_us   Release period in microsecond.
+  */
+void Stream_Set_Period(Stream_HandleTypeDef *stream, uint32_t period_us)
+{
+	if (period_us < STREAM_MIN_PERIOD_US)
+		period_us = STREAM_MIN_PERIOD_US;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	stream->period_us = period_us;
+	__set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Changing phase of a stream
+	* @note		Used from the next Stream_Start, a running stream keeps its release
+	* @param 	stream      Pointer to the Stream_HandleTypeDef structure.
+	* @param 	phase_us    Release offset from timebase zero in microsecond.
+  */
+void Stream_Set_Phase(Stream_HandleTypeDef *stream, uint32_t phase_us)
+{
+	stream->phase_us = phase_us;
+}
+
+/** @brief    Stream running function
+  ==============================================================================
+										##### Stream Running Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Checking a stream is due and has the highest due priority.
+    (+) Completing a release and updating period statistic.
+  */
+
+/**
+  * @brief  Checking a stream should run now
+	* @param 	stream      Pointer to the Stream_HandleTypeDef structure.
+	* @return	Run (1) or wait (0), a due stream waits for due streams of higher priority
+  */
+uint8_t Stream_isDue(Stream_HandleTypeDef *stream)
+{
+	if (!stream->enable || !stream->due)
+		return 0;
+
+	for (uint8_t i = 0; i < Stream_Num; i++)
+	{
+		if (Stream_List[i] != stream && Stream_List[i]->enable && Stream_List[i]->due
+				&& Stream_List[i]->priority < stream->priority)
+			return 0;
+	}
+	return 1;
+}
+
+/**
+  * @brief  Completing a release
+	* @note		Call this function after the stream data was sent
+	* @param 	stream      Pointer to the Stream_HandleTypeDef structure.
+  */
+void Stream_Complete(Stream_HandleTypeDef *stream)
+{
+	uint32_t now = Timebase_Get_Us();
+
+	//Achieved period statistic
+	if (stream->run_count)
+	{
+		uint32_t period = now - stream->last_run_us;
+		if (period < stream->period_min_us)
+			stream->period_min_us = period;
+		if (period > stream->period_max_us)
+			stream->period_max_us = period;
+		stream->period_sum_us += period;
+	}
+	stream->run_count++;
+	stream->last_run_us = now;
+	stream->due = 0;
+}
+
+/** @brief    Stream statistic function
+  ==============================================================================
+										##### Stream Statistic Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Getting average achieved period.
+    (+) Resetting statistic.
+	[..]
+		Jitter is period_max_us - period_min_us.
+  */
+
+/**
+  * @brief  Getting average achieved period
+	* @param 	stream      Pointer to the Stream_HandleTypeDef structure.
+	* @return	Average period in microsecond, 0 if less than 2 runs
+  */
+uint32_t Stream_Get_Period_Avg(Stream_HandleTypeDef *stream)
+{
+	if (stream->run_count < 2)
+		return 0;
+	return (uint32_t)(stream->period_sum_us / (stream->run_count - 1));
+}
+
+/**
+  * @brief  Resetting statistic
+	* @param 	stream      Pointer to the Stream_HandleTypeDef structure.
+  */
+void Stream_Reset_Statistic(Stream_HandleTypeDef *stream)
+{
+	stream->last_run_us = 0;
+	stream->period_min_us = 0xFFFFFFFF;
+	stream->period_max_us = 0;
+	stream->period_sum_us = 0;
+	stream->run_count = 0;
+	stream->missed = 0;
+}
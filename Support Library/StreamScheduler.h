@@ -0,0 +1,75 @@
+/**
+  ******************************************************************************
+  * @file    	StreamScheduler.h
+  * @author  	Nguyen Vu
+  * @brief   	This file contains all the functions prototypes
+	*						for the microsecond stream scheduler
+  *****************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef STREAMSCHEDULER_H_
+#define STREAMSCHEDULER_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f1xx_hal.h"
+#include "Timebase.h"
+
+/**
+  * @brief  Configuration Value
+  */
+#define STREAM_MAX_NUM				4
+#define STREAM_MIN_PERIOD_US	100
+
+/**
+  * @brief  Stream priority class, lower value is served first
+  */
+#define STREAM_PRIORITY_HIGH		0
+#define STREAM_PRIORITY_NORMAL	1
+#define STREAM_PRIORITY_LOW			2
+
+/**
+  * @brief  Stream struct
+	* @param	period_us		Release period in microsecond
+	* @param	phase_us		Release offset from timebase zero in microsecond
+	* @param	priority		Priority class
+	* @param	due					Set by timer interrupt, clear by Stream_Complete
+	* @param	release_us	Next release time
+	* @param	missed			Release while the previous one is still due
+  */
+typedef struct
+{
+	uint32_t					period_us;
+	uint32_t					phase_us;
+	uint8_t						priority;
+	volatile uint8_t	enable;
+	volatile uint8_t	due;
+	uint32_t					release_us;
+
+	uint32_t					last_run_us;
+	uint32_t					period_min_us;
+	uint32_t					period_max_us;
+	uint64_t					period_sum_us;
+	uint32_t					run_count;
+	uint32_t					missed;
+}Stream_HandleTypeDef;
+
+/* Initialization and handling functions  *************************************/
+void Stream_Scheduler_Init(TIM_HandleTypeDef *htim);
+void Stream_Alarm_Handle(TIM_HandleTypeDef *htim);
+
+/* Stream control functions  **************************************************/
+HAL_StatusTypeDef Stream_Register(Stream_HandleTypeDef *stream, uint8_t priority, uint32_t phase_us);
+void Stream_Start(Stream_HandleTypeDef *stream, uint32_t period_us);
+void Stream_Stop(Stream_HandleTypeDef *stream);
+void Stream_Set_Period(Stream_HandleTypeDef *stream, uint32_t period_us);
+void Stream_Set_Phase(Stream_HandleTypeDef *stream, uint32_t phase_us);
+
+/* Stream running functions  **************************************************/
+uint8_t Stream_isDue(Stream_HandleTypeDef *stream);
+void Stream_Complete(Stream_HandleTypeDef *stream);
+
+/* Statistic functions  *******************************************************/
+uint32_t Stream_Get_Period_Avg(Stream_HandleTypeDef *stream);
+void Stream_Reset_Statistic(Stream_HandleTypeDef *stream);
+
+#endif
@@ -0,0 +1,241 @@
+/**
+  ******************************************************************************
+  * @file    	TaskScheduler.c
+  * @author  	Nguyen Vu
+	*	@version 	1.0.0
+  * @brief   	This file provides function to run the while loop work as
+	*						periodic and event triggered tasks by priority and deadline
+  *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "TaskScheduler.h"
+
+static Task_HandleTypeDef	Task_List[TASK_NUM_MAX];
+static volatile uint32_t	Task_Event;
+static uint32_t						Task_Event_us[TASK_NUM_MAX];
+
+/** @brief    Task scheduler basic function
+  ==============================================================================
+									##### Task Scheduler Basic Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Initialize the scheduler.
+    (+) Releasing periodic tasks and collecting signaled events.
+    (+) Running the most urgent ready task.
+	[..]
+		Tasks are run to completion, one per Task_Scheduler_Run, so a high
+		priority event waits at most for the task already running. The ready
+		task with the lowest priority value runs first, earliest deadline
+		breaks the tie.
+  */
+
+/**
+  * @brief  Initializes the scheduler
+	* @note		Call after Timebase_Init, before Task_Create
+  */
+void Task_Scheduler_Init(void)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	for (uint8_t i = 0; i < TASK_NUM_MAX; i++)
+		Task_List[i] = (Task_HandleTypeDef){0};
+	Task_Event = 0;
+	__set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Releasing due periodic tasks
+	* @param 	now      Current time in microsecond.
+  */
+static void Task_Release(uint32_t now)
+{
+	for (uint8_t i = 0; i < TASK_NUM_MAX; i++)
+	{
+		Task_HandleTypeDef *task = &Task_List[i];
+		if (task->func == NULL || !task->period_us || (int32_t)(now - task->release_us) < 0)
+			continue;
+
+		//Previous release has not run yet
+		if (task->ready)
+			task->overrun++;
+		else
+		{
+			task->ready = 1;
+			task->ready_us = task->release_us;
+		}
+
+		//Skip releases lost while a long task was running, keep phase
+		uint32_t late_periods = (now - task->release_us) / task->period_us;
+		task->overrun += late_periods;
+		task->release_us += (late_periods + 1) * task->period_us;
+	}
+}
+
+/**
+  * @brief  Collecting the events signaled by interrupts
+  */
+static void Task_Collect(void)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint32_t event = Task_Event;
+	Task_Event = 0;
+	for (uint8_t i = 0; event; i++, event >>= 1)
+	{
+		if (!(event & 1) || Task_List[i].func == NULL || Task_List[i].ready)
+			continue;
+		Task_List[i].ready = 1;
+		Task_List[i].ready_us = Task_Event_us[i];
+	}
+	__set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Picking the most urgent ready task
+	* @param 	now      Current time in microsecond.
+	* @return	Task ID, TASK_NUM_MAX if no task is ready
+  */
+static uint8_t Task_Pick(uint32_t now)
+{
+	uint8_t pick = TASK_NUM_MAX;
+	int32_t pick_slack = 0;
+
+	for (uint8_t i = 0; i < TASK_NUM_MAX; i++)
+	{
+		Task_HandleTypeDef *task = &Task_List[i];
+		if (!task->ready)
+			continue;
+
+		//Time left before deadline, task without deadline is the least urgent
+		int32_t slack = task->deadline_us ? (int32_t)(task->ready_us + task->deadline_us - now) : INT32_MAX;
+		if (pick == TASK_NUM_MAX || task->priority < Task_List[pick].priority ||
+				(task->priority == Task_List[pick].priority && slack < pick_slack))
+		{
+			pick = i;
+			pick_slack = slack;
+		}
+	}
+	return pick;
+}
+
+/**
+  * @brief  Running the most urgent ready task
+	* @note		Call this function in while loop
+	* @return	1 if a task has run, 0 if no task is ready
+  */
+uint8_t Task_Scheduler_Run(void)
+{
+	uint32_t now = Timebase_Get_Us();
+	Task_Release(now);
+	Task_Collect();
+
+	uint8_t id = Task_Pick(now);
+	if (id == TASK_NUM_MAX)
+		return 0;
+
+	//Clear before running so a signal during the run releases it again
+	Task_HandleTypeDef *task = &Task_List[id];
+	uint32_t ready_us = task->ready_us;
+	task->ready = 0;
+
+	LOOP_PROFILE(id, task->func());
+
+	uint32_t response = Timebase_Get_Us() - ready_us;
+	task->runs++;
+	if (response > task->response_max_us)
+		task->response_max_us = response;
+	if (task->deadline_us && response > task->deadline_us)
+		task->missed++;
+	return 1;
+}
+
+/** @brief    Task control function
+  ==============================================================================
+										##### Task Control Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Creating a periodic, event triggered or mixed task.
+    (+) Signaling an event from interrupt.
+  */
+
+/**
+  * @brief  Creating a task
+	* @note		A task with a period is also released by Task_Signal. Periodic
+	*					task is released first at the next Task_Scheduler_Run.
+	* @param 	id      		Task ID.
+	* @param 	func      	Task function.
+	* @param 	period_us   Release period in microsecond, 0 for event only task.
+	* @param 	deadline_us Longest time from release to completion, TASK_NO_DEADLINE if none.
+	* @param 	priority    Priority class (TASK_PRIORITY_x).
+  */
+void Task_Create(uint8_t id, Task_FuncTypeDef func, uint32_t period_us, uint32_t deadline_us, uint8_t priority)
+{
+	if (id >= TASK_NUM_MAX)
+		return;
+
+	Task_HandleTypeDef *task = &Task_List[id];
+	*task = (Task_HandleTypeDef){0};
+	task->period_us = period_us;
+	task->deadline_us = deadline_us;
+	task->priority = priority;
+	task->release_us = Timebase_Get_Us();
+	task->func = func;
+}
+
+/**
+  * @brief  Signaling an event to a task
+	* @note		Safe to call in interupt, signals before the task runs are merged
+	* @param 	id      Task ID.
+  */
+void Task_Signal(uint8_t id)
+{
+	if (id >= TASK_NUM_MAX)
+		return;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if (!(Task_Event & (1UL << id)))
+	{
+		Task_Event |= 1UL << id;
+		Task_Event_us[id] = Timebase_Get_Us();
+	}
+	__set_PRIMASK(primask);
+}
+
+/** @brief    Task statistic function
+  ==============================================================================
+									##### Task Statistic Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Getting a task.
+    (+) Resetting the counters of every task.
+  */
+
+/**
+  * @brief 	Getting a task
+	* @param 	id      Task ID.
+	* @return	Pointer to the Task_HandleTypeDef structure, NULL if the task is not created
+  */
+Task_HandleTypeDef *Task_Get(uint8_t id)
+{
+	if (id >= TASK_NUM_MAX || Task_List[id].func == NULL)
+		return NULL;
+	return &Task_List[id];
+}
+
+/**
+  * @brief  Resetting the counters of every task
+  */
+void Task_Reset_Statistic(void)
+{
+	for (uint8_t i = 0; i < TASK_NUM_MAX; i++)
+	{
+		Task_List[i].runs = 0;
+		Task_List[i].missed = 0;
+		Task_List[i].overrun = 0;
+		Task_List[i].response_max_us = 0;
+	}
+}
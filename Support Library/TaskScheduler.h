@@ -0,0 +1,81 @@
+/**
+  ******************************************************************************
+  * @file    	TaskScheduler.h
+  * @author  	Nguyen Vu
+  * @brief   	This file contains all the functions prototypes
+	*						for the cooperative task scheduler
+  *****************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef TASKSCHEDULER_H_
+#define TASKSCHEDULER_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f1xx_hal.h"
+#include "Timebase.h"
+#include "LoopProfiler.h"
+
+/**
+  * @brief  Configuration Value
+	* @note		Task ID is shared with the loop profiler, every run is profiled
+	*					with LOOP_PROFILE under the same ID.
+  */
+#define TASK_NUM_MAX						15				//Task ID is 0 to TASK_NUM_MAX-1
+#define TASK_NO_DEADLINE				0
+
+/**
+  * @brief  Task priority class, lower value is served first
+  */
+#define TASK_PRIORITY_HIGH			0
+#define TASK_PRIORITY_NORMAL		1
+#define TASK_PRIORITY_LOW				2
+#define TASK_PRIORITY_IDLE			3
+
+/**
+  * @brief  Task function, runs to completion
+  */
+typedef void (*Task_FuncTypeDef)(void);
+
+/**
+  * @brief  Task struct
+	* @param	func					Task function, NULL if the ID is not created
+	* @param	period_us			Release period in microsecond, 0 for event only task
+	* @param	deadline_us		Longest time from release to completion, TASK_NO_DEADLINE if none
+	* @param	priority			Priority class
+	* @param	release_us		Next periodic release time
+	* @param	ready					Released or signaled, clear when the task starts
+	* @param	ready_us			Time of the release or of the first signal
+	* @param	runs					Run count
+	* @param	missed				Run completed after its deadline
+	* @param	overrun				Release while the previous one has not run yet
+	* @param	response_max_us		Longest time from release to completion
+  */
+typedef struct
+{
+	Task_FuncTypeDef	func;
+	uint32_t					period_us;
+	uint32_t					deadline_us;
+	uint8_t						priority;
+	uint32_t					release_us;
+	uint8_t						ready;
+	uint32_t					ready_us;
+
+	uint32_t					runs;
+	uint32_t					missed;
+	uint32_t					overrun;
+	uint32_t					response_max_us;
+}Task_HandleTypeDef;
+
+/* Initialization and handling functions  *************************************/
+void Task_Scheduler_Init(void);
+uint8_t Task_Scheduler_Run(void);
+
+/* Task control functions  ****************************************************/
+void Task_Create(uint8_t id, Task_FuncTypeDef func, uint32_t period_us, uint32_t deadline_us, uint8_t priority);
+void Task_Signal(uint8_t id);
+
+/* Statistic functions  *******************************************************/
+Task_HandleTypeDef *Task_Get(uint8_t id);
+void Task_Reset_Statistic(void);
+
+#endif
@@ -0,0 +1,115 @@
+/**
+  ******************************************************************************
+  * @file    	Timebase.c
+  * @author  	Nguyen Vu
+	*	@version 	1.1.0
+  * @brief   	This file provides a free running 32 bit microsecond timebase
+	*						using a 16 bit hardware timer and its update interrupt,
+	*						and the DWT cycle counter for fine measurement
+  *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "Timebase.h"
+
+/**
+  * @brief  Some variables for timebase
+  */
+static TIM_HandleTypeDef 	*Timebase_htim;
+static volatile uint32_t 	overflow_counter;
+
+/** @brief    Timebase basic function
+  ==============================================================================
+										##### Timebase Basic Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Starting the timebase timer.
+    (+) Extending the 16 bit counter to 32 bit on overflow.
+    (+) Reading the current time in microsecond.
+  */
+
+/**
+  * @brief  Initializes and start the timebase
+	* @note		Initializes the timebase in the main function and before while loop
+	* @param 	htim      Pointer to the TIM_HandleTypeDef structure (1 MHz, period 65535).
+  */
+void Timebase_Init(TIM_HandleTypeDef *htim)
+{
+	Timebase_htim = htim;
+	overflow_counter = 0;
+	htim->Instance->CNT = 0;
+	HAL_TIM_Base_Start_IT(htim);
+}
+
+/**
+  * @brief 	Counting timer overflow
+	* @note 	Place this function in HAL_TIM_PeriodElapsedCallback
+	* @param 	htim      Pointer to the TIM_HandleTypeDef structure.
+  */
+void Timebase_Overflow_Handle(TIM_HandleTypeDef *htim)
+{
+	if (htim == Timebase_htim)
+		overflow_counter++;
+}
+
+/**
+  * @brief 	Reading current time
+	* @note 	Safe to call from interrupt and from while loop,
+	*					wrap around after 71 minutes
+	* @return	Time since Timebase_Init in microsecond
+  */
+uint32_t Timebase_Get_Us(void)
+{
+	if (Timebase_htim == NULL)
+		return 0;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	uint32_t high = overflow_counter;
+	uint16_t cnt = Timebase_htim->Instance->CNT;
+
+	//Overflow happened but has not been handled yet
+	if (__HAL_TIM_GET_FLAG(Timebase_htim, TIM_FLAG_UPDATE) && cnt < 0x8000)
+		high++;
+
+	__set_PRIMASK(primask);
+	return (high << 16) | cnt;
+}
+
+/** @brief    Cycle counter function
+  ==============================================================================
+										##### Cycle Counter Functions #####
+  ==============================================================================
+  [..]
+    This section provides functions allowing to:
+    (+) Starting the DWT cycle counter.
+    (+) Converting cycles to microsecond.
+	[..]
+		Read the counter with Timebase_Get_Cycle, it is inlined so a measure
+		costs one load. Difference of two reads is right across one wrap around.
+  */
+
+/**
+  * @brief  Starting the DWT cycle counter
+	* @note		Safe to call more than once, the counter keeps running
+  */
+void Timebase_Cycle_Init(void)
+{
+	if (DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)
+		return;
+
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+  * @brief 	Converting cycles to microsecond
+	* @param 	cycle      Cycle count.
+	* @return	Time in microsecond at SystemCoreClock, rounded down
+  */
+uint32_t Timebase_Cycle_To_Us(uint32_t cycle)
+{
+	return cycle / (SystemCoreClock / TIMEBASE_TICK_HZ);
+}
@@ -0,0 +1,41 @@
+/**
+  ******************************************************************************
+  * @file    	Timebase.h
+  * @author  	Nguyen Vu
+  * @brief   	This file contains all the functions prototypes
+	*						for the microsecond timebase
+  *****************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef TIMEBASE_H_
+#define TIMEBASE_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f1xx_hal.h"
+
+/**
+  * @brief  Configuration Value
+	* @note		Timer clock must be divided down to 1 MHz (1 tick = 1 us)
+  */
+#define TIMEBASE_TICK_HZ		1000000U
+
+/**
+  * @brief  Reading the DWT cycle counter
+	* @note		Counts core clock cycles after Timebase_Cycle_Init,
+	*					wrap around after 59 s at 72 MHz
+  */
+static inline uint32_t Timebase_Get_Cycle(void)
+{
+	return DWT->CYCCNT;
+}
+
+/* Initialization and handling functions  *************************************/
+void Timebase_Init(TIM_HandleTypeDef *htim);
+void Timebase_Overflow_Handle(TIM_HandleTypeDef *htim);
+void Timebase_Cycle_Init(void);
+
+/* Reading functions  *********************************************************/
+uint32_t Timebase_Get_Us(void);
+uint32_t Timebase_Cycle_To_Us(uint32_t cycle);
+
+#endif